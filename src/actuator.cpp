@@ -0,0 +1,82 @@
+#include "actuator.h"
+
+const uint16_t PWM_RANGE = 255;
+
+static uint8_t actuatorPin = 0;
+static const ActuatorStep* volatile profile = nullptr; // cleared by actuatorRelease() from an ISR
+static uint8_t profileSteps = 0;
+static uint8_t stepIndex = 0;
+static unsigned long stepStart = 0;
+
+static void applyDuty(uint8_t dutyPercent) {
+  if (dutyPercent >= 100)
+    digitalWrite(actuatorPin, HIGH);
+  else if (dutyPercent == 0)
+    digitalWrite(actuatorPin, LOW);
+  else
+    analogWrite(actuatorPin, dutyPercent * PWM_RANGE / 100);
+}
+
+static void startStep() {
+  stepStart = millis();
+  applyDuty(profile[stepIndex].dutyPercent);
+}
+
+/**
+ * @brief Sets up the actuator output, released.
+ *
+ * @param pwmFrequency PWM frequency for the hold steps, in Hz.
+ */
+void actuatorBegin(uint8_t pin, uint32_t pwmFrequency) {
+  actuatorPin = pin;
+  pinMode(actuatorPin, OUTPUT);
+  digitalWrite(actuatorPin, LOW);
+  analogWriteRange(PWM_RANGE);
+  analogWriteFreq(pwmFrequency);
+}
+
+/**
+ * @brief Starts driving the actuator through a profile. Returns immediately.
+ *
+ * The profile is not copied and must outlive the drive (e.g. a const table).
+ * The last step is held until @ref actuatorRelease().
+ */
+void actuatorEngage(const ActuatorStep* steps, uint8_t count) {
+  if (count == 0)
+    return;
+  profile = steps;
+  profileSteps = count;
+  stepIndex = 0;
+  startStep();
+}
+
+/**
+ * @brief Switches the actuator off at once. Safe to call from an interrupt.
+ */
+void IRAM_ATTR actuatorRelease() {
+  profile = nullptr;
+  digitalWrite(actuatorPin, LOW); // also stops PWM on the pin
+}
+
+/**
+ * @brief Advances the profile to its next step when due; call from every loop() pass.
+ *
+ * The step change runs with interrupts off, so a release from an interrupt
+ * cannot land between the check and the pin write and be undone by it.
+ */
+void actuatorUpdate() {
+  const ActuatorStep* steps = profile;
+  if (steps == nullptr || stepIndex + 1 >= profileSteps)
+    return;
+
+  uint16_t duration = steps[stepIndex].durationMs;
+  if (duration == 0 || millis() - stepStart < duration)
+    return;
+
+  noInterrupts();
+  if (profile == steps) {
+    stepIndex++;
+    startStep();
+  }
+  interrupts();
+}
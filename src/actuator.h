@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * One step of an actuator drive profile: a duty cycle held for a time.
+ * A duration of 0 holds the step until the actuator is released.
+ */
+struct ActuatorStep {
+  uint8_t dutyPercent;
+  uint16_t durationMs;
+};
+
+void actuatorBegin(uint8_t pin, uint32_t pwmFrequency);
+void actuatorEngage(const ActuatorStep* profile, uint8_t steps);
+void actuatorRelease();
+void actuatorUpdate();
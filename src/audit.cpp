@@ -0,0 +1,206 @@
+#include "audit.h"
+
+#include <LittleFS.h>
+
+#include "timekeeper.h"
+
+const uint8_t AUDIT_CLOCK_SET = 0x80;
+
+static AuditRecord buffer[AUDIT_BUFFER_RECORDS];
+static uint8_t buffered = 0;
+static unsigned long oldestBuffered = 0;
+static uint32_t dropped = 0; // records that found the buffer full
+
+// files are /audit/<sequence>.bin; the highest sequence is being appended to
+static uint32_t firstSequence = 0;
+static uint32_t currentSequence = 0;
+static uint16_t currentRecords = 0;
+
+static const char* const REASON_NAMES[] = {"granted", "unknown", "schedule", "auth"};
+
+static void auditPath(uint32_t sequence, char* path) {
+  snprintf(path, 24, "/audit/%lu.bin", (unsigned long)sequence);
+}
+
+// cuts a record left partly written by a power loss off the end of the current file, so the
+// next append starts on a record boundary; if it cannot, appends go to a fresh file
+static void dropPartialRecord(size_t fileSize) {
+  char path[24];
+  auditPath(currentSequence, path);
+  size_t whole = currentRecords * sizeof(AuditRecord);
+  Serial.printf("Audit log: dropping %u bytes of a partial record at the end of %s\n",
+                (unsigned)(fileSize - whole), path);
+
+  File file = LittleFS.open(path, "r+");
+  bool cut = file && file.truncate(whole);
+  if (file)
+    file.close();
+  if (!cut) {
+    Serial.println("Failed to truncate the audit log, starting a new file");
+    currentSequence++;
+    currentRecords = 0;
+  }
+}
+
+/**
+ * @brief Finds the audit files left from before the last reboot.
+ *
+ * Only the file being appended to can end in a partial record (power lost
+ * mid-append); it is cut back to its last whole record.
+ *
+ * @return true If the log is usable.
+ */
+bool auditBegin() {
+  if (!LittleFS.exists("/audit") && !LittleFS.mkdir("/audit")) {
+    Serial.println("Failed to create the audit log directory");
+    return false;
+  }
+
+  bool any = false;
+  size_t currentSize = 0;
+  firstSequence = 0;
+  currentSequence = 0;
+  currentRecords = 0;
+  Dir dir = LittleFS.openDir("/audit");
+  while (dir.next()) {
+    uint32_t sequence = strtoul(dir.fileName().c_str(), nullptr, 10);
+    if (!any || sequence < firstSequence)
+      firstSequence = sequence;
+    if (!any || sequence >= currentSequence) {
+      currentSequence = sequence;
+      currentSize = dir.fileSize();
+      currentRecords = currentSize / sizeof(AuditRecord);
+    }
+    any = true;
+  }
+  if (currentSize % sizeof(AuditRecord) != 0)
+    dropPartialRecord(currentSize);
+
+  Serial.printf("Audit log: %lu files, %u records in the current one\n",
+                (unsigned long)(any ? currentSequence - firstSequence + 1 : 0), currentRecords);
+  return true;
+}
+
+// writes the buffer as one append, rotating to a new file (and dropping the oldest) when full
+static void flushBuffer() {
+  char path[24];
+  uint8_t written = 0;
+  while (written < buffered) {
+    if (currentRecords == AUDIT_FILE_RECORDS) {
+      currentSequence++;
+      currentRecords = 0;
+      while (currentSequence - firstSequence >= AUDIT_FILES) {
+        auditPath(firstSequence++, path);
+        LittleFS.remove(path);
+      }
+    }
+
+    auditPath(currentSequence, path);
+    File file = LittleFS.open(path, "a");
+    if (!file) {
+      Serial.println("Failed to open audit log for writing");
+      break;
+    }
+    uint8_t count = min<uint16_t>(buffered - written, AUDIT_FILE_RECORDS - currentRecords);
+    file.write((const uint8_t*)&buffer[written], count * sizeof(AuditRecord));
+    file.close();
+    currentRecords += count;
+    written += count;
+  }
+
+  buffered = 0;
+}
+
+/**
+ * @brief Queues one access decision for the log. Never touches flash.
+ *
+ * If the RAM buffer is still full (a burst of cards kept @ref auditService()
+ * from running), the record is dropped and counted instead.
+ */
+void auditAppend(const UidKey& uid, uint8_t reader, AccessReason reason) {
+  if (buffered == AUDIT_BUFFER_RECORDS) {
+    dropped++;
+    return;
+  }
+  if (buffered == 0)
+    oldestBuffered = millis();
+
+  AuditRecord& record = buffer[buffered++];
+  record.time = clockNow();
+  record.uidLength = uidKeyLength(uid);
+  record.info = (reason & 0x07) | ((reader & 0x03) << 3) | (clockIsSet() ? AUDIT_CLOCK_SET : 0);
+  memset(record.uid, 0, sizeof(record.uid));
+  uidKeyBytes(uid, record.uid);
+}
+
+/**
+ * @brief Writes buffered records once a full page is ready or they have waited long enough.
+ *
+ * Call from loop() when no card is being handled, so flash writes stay off the unlock path.
+ */
+void auditService() {
+  if (buffered == AUDIT_BUFFER_RECORDS ||
+      (buffered > 0 && millis() - oldestBuffered >= AUDIT_FLUSH_MS))
+    flushBuffer();
+}
+
+/**
+ * @brief Records dropped because the buffer was full, since boot.
+ */
+uint32_t auditDropped() {
+  return dropped;
+}
+
+/**
+ * @brief Carries the flush deadline over a light sleep, during which millis() stands still.
+ */
+void auditSlept(unsigned long ms) {
+  if (buffered > 0)
+    oldestBuffered -= ms;
+}
+
+static void emitRecord(const AuditRecord& record, uint32_t from, uint32_t to,
+                       void (*emit)(const char*, size_t)) {
+  if (record.time < from || record.time > to || record.uidLength == 0 ||
+      record.uidLength > UID_MAX_BYTES)
+    return;
+
+  char uidText[UID_TEXT_SIZE];
+  formatUidKey(makeUidKey(record.uid, record.uidLength), uidText);
+  uint8_t reason = record.info & 0x07;
+  char line[64];
+  int length = snprintf(line, sizeof(line), "%lu%s,%s,%u,%s\n", (unsigned long)record.time,
+                        record.info & AUDIT_CLOCK_SET ? "" : "+boot", uidText,
+                        (record.info >> 3) & 0x03,
+                        reason < 4 ? REASON_NAMES[reason] : "?");
+  emit(line, min<size_t>(length, sizeof(line) - 1));
+}
+
+/**
+ * @brief Streams the log, oldest first, as CSV lines: `time,uid,reader,decision`.
+ *
+ * Times of records taken before the clock was set are seconds since boot and
+ * are marked `+boot`. Both filters are inclusive and compare raw times.
+ *
+ * @param emit Receives one line at a time.
+ */
+void auditStream(uint32_t from, uint32_t to, void (*emit)(const char* line, size_t length)) {
+  AuditRecord chunk[AUDIT_BUFFER_RECORDS];
+  for (uint32_t sequence = firstSequence; sequence <= currentSequence; sequence++) {
+    char path[24];
+    auditPath(sequence, path);
+    File file = LittleFS.open(path, "r");
+    if (!file)
+      continue;
+
+    int bytes;
+    while ((bytes = file.read((uint8_t*)chunk, sizeof(chunk))) > 0) {
+      for (int i = 0; i < bytes / (int)sizeof(AuditRecord); i++)
+        emitRecord(chunk[i], from, to, emit);
+    }
+    file.close();
+  }
+
+  for (uint8_t i = 0; i < buffered; i++)
+    emitRecord(buffer[i], from, to, emit);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "pipeline.h"
+#include "uidkey.h"
+
+// access audit log: 16-byte records in a ring of fixed-size files under /audit
+const uint8_t AUDIT_FILES = 4;
+const uint16_t AUDIT_FILE_RECORDS = 256;  // 4 KiB per file, one flash block
+const uint8_t AUDIT_BUFFER_RECORDS = 16;  // one 256-byte flash page per write
+const unsigned long AUDIT_FLUSH_MS = 30000UL; // records wait in RAM at most this long
+
+struct AuditRecord {
+  uint32_t time;     // local epoch seconds, or seconds since boot if the clock was not set
+  uint8_t uidLength;
+  uint8_t info;      // bits 0-2 AccessReason, bits 3-4 reader, bit 7 clock set
+  uint8_t uid[UID_MAX_BYTES];
+};
+
+static_assert(sizeof(AuditRecord) == 16, "audit records must stay 16 bytes");
+
+bool auditBegin();
+void auditAppend(const UidKey& uid, uint8_t reader, AccessReason reason);
+void auditService();
+uint32_t auditDropped();
+void auditSlept(unsigned long ms);
+void auditStream(uint32_t from, uint32_t to, void (*emit)(const char* line, size_t length));
@@ -0,0 +1,241 @@
+#include "bench.h"
+
+#ifdef ENABLE_BENCH
+
+#include <LittleFS.h>
+
+#include "credstore.h"
+#include "csvreader.h"
+#include "perfecthash.h"
+
+static const uint16_t TABLE_SIZES[] = {16, 128, 512};
+static const uint8_t UID_LENGTHS[] = {4, 7};
+static const uint16_t TAP_TABLE_SIZE = 128;
+
+enum BenchCase : uint8_t { CASE_HIT, CASE_MISS, CASE_NEAR_MISS };
+static const char* const CASE_NAMES[] = {"hit", "miss", "near_miss"};
+
+struct BenchTiming {
+  uint32_t count;
+  uint64_t totalCycles;
+  uint32_t maxCycles;
+
+  void record(uint32_t cycles) {
+    count++;
+    totalCycles += cycles;
+    maxCycles = max(maxCycles, cycles);
+  }
+};
+
+static uint8_t syntheticLength = 4;
+static bool firstResult = true;
+static volatile uint32_t sink; // keeps the measured calls from being optimized out
+
+static uint32_t xorshift(uint32_t x) {
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+// the index-th generated card; indices past the table size give cards that are not in it
+static UidKey syntheticKey(size_t index) {
+  uint8_t bytes[UID_MAX_BYTES];
+  uint32_t state = xorshift(index * 2654435761UL + 1);
+  for (uint8_t i = 0; i < syntheticLength; i++) {
+    state = xorshift(state);
+    bytes[i] = state;
+  }
+  return makeUidKey(bytes, syntheticLength);
+}
+
+// a registered card with the lowest bit of its last byte flipped
+static UidKey nearMiss(const UidKey& key) {
+  uint8_t bytes[UID_MAX_BYTES];
+  uint8_t length = uidKeyLength(key);
+  uidKeyBytes(key, bytes);
+  bytes[length - 1] ^= 0x01;
+  return makeUidKey(bytes, length);
+}
+
+static void printResult(Print& out, const char* fields, const BenchTiming& timing) {
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  uint32_t meanNs = timing.count ? timing.totalCycles * 1000 / mhz / timing.count : 0;
+  out.printf("%s\n    {%s,\"n\":%lu,\"mean_ns\":%lu,\"max_ns\":%lu}", firstResult ? "" : ",",
+             fields, (unsigned long)timing.count, (unsigned long)meanNs,
+             (unsigned long)((uint64_t)timing.maxCycles * 1000 / mhz));
+  firstResult = false;
+}
+
+static void benchFormat(Print& out) {
+  char text[UID_TEXT_SIZE];
+  char fields[64];
+  for (uint8_t length : UID_LENGTHS) {
+    syntheticLength = length;
+    BenchTiming format = {};
+    BenchTiming parse = {};
+    for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      UidKey key = syntheticKey(i);
+      uint32_t start = ESP.getCycleCount();
+      sink = formatUidKey(key, text);
+      format.record(ESP.getCycleCount() - start);
+
+      start = ESP.getCycleCount();
+      sink = parseUidKey(text, &key);
+      parse.record(ESP.getCycleCount() - start);
+    }
+    snprintf(fields, sizeof(fields), "\"name\":\"format\",\"uid_bytes\":%u", length);
+    printResult(out, fields, format);
+    snprintf(fields, sizeof(fields), "\"name\":\"parse\",\"uid_bytes\":%u", length);
+    printResult(out, fields, parse);
+  }
+}
+
+// times findCredential() for the three cases, hits cycling over `hits`
+static void benchLookup(Print& out, const char* layout, UidKey (*hitAt)(size_t index),
+                        size_t hits, size_t cards) {
+  char fields[112];
+  for (uint8_t which = CASE_HIT; which <= CASE_NEAR_MISS; which++) {
+    BenchTiming timing = {};
+    for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      UidKey key = which == CASE_MISS ? syntheticKey(TABLE_SIZES[2] + i) : hitAt(i % hits);
+      if (which == CASE_NEAR_MISS)
+        key = nearMiss(key);
+      uint32_t start = ESP.getCycleCount();
+      sink = findCredential(key) != nullptr;
+      timing.record(ESP.getCycleCount() - start);
+    }
+    snprintf(fields, sizeof(fields),
+             "\"name\":\"lookup\",\"layout\":\"%s\",\"cards\":%u,\"uid_bytes\":%u,\"case\":\"%s\"",
+             layout, (unsigned)cards, uidKeyLength(hitAt(0)), CASE_NAMES[which]);
+    printResult(out, fields, timing);
+    yield();
+  }
+}
+
+static UidKey loadedKeys[BENCH_LOADED_KEYS];
+
+static UidKey loadedKey(size_t index) {
+  return loadedKeys[index];
+}
+
+// lookups against the cards actually registered, in whatever layout they were loaded
+static void benchLoadedLookup(Print& out) {
+  File file = LittleFS.open("/uids.txt", "r");
+  if (!file)
+    return;
+
+  uint8_t count = 0;
+  CsvReader reader(file);
+  while (count < BENCH_LOADED_KEYS && reader.next()) {
+    if (reader.fieldCount() == 3 && parseUidKey(reader.field(0), &loadedKeys[count]))
+      count++;
+  }
+  file.close();
+  if (count == 0)
+    return;
+
+  syntheticLength = uidKeyLength(loadedKeys[0]); // for the miss keys
+  benchLookup(out, perfectHashCount() > 0 ? "image" : "sorted", loadedKey, count,
+              credentialCount() + perfectHashCount());
+}
+
+// generated tables of several sizes, plus end-to-end taps against one of them
+static void benchSynthetic(Print& out, BenchTap tap) {
+  char fields[96];
+  for (uint8_t length : UID_LENGTHS) {
+    syntheticLength = length;
+    for (uint16_t size : TABLE_SIZES) {
+      loadSyntheticCredentials(size, syntheticKey);
+      benchLookup(out, "synthetic", syntheticKey, size, size);
+      if (length != 4 || size != TAP_TABLE_SIZE)
+        continue;
+
+      for (uint8_t which = CASE_HIT; which <= CASE_NEAR_MISS; which++) {
+        BenchTiming timing = {};
+        uint16_t granted = 0;
+        for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+          UidKey key = which == CASE_MISS ? syntheticKey(size + i) : syntheticKey(i % size);
+          if (which == CASE_NEAR_MISS)
+            key = nearMiss(key);
+          uint32_t start = ESP.getCycleCount();
+          granted += tap(key);
+          timing.record(ESP.getCycleCount() - start);
+        }
+        snprintf(fields, sizeof(fields),
+                 "\"name\":\"tap\",\"cards\":%u,\"case\":\"%s\",\"granted\":%u", size,
+                 CASE_NAMES[which], granted);
+        printResult(out, fields, timing);
+        yield();
+      }
+    }
+  }
+
+  loadSyntheticCredentials(0, nullptr);
+}
+
+// the flash side of registerUID(): one CSV line appended to a scratch file
+static void benchAppend(Print& out) {
+  BenchTiming timing = {};
+  for (uint8_t i = 0; i < BENCH_APPENDS; i++) {
+    uint32_t start = ESP.getCycleCount();
+    File file = LittleFS.open("/bench.txt", "a");
+    if (!file)
+      break;
+    file.printf("%02X:%02X:%02X:%02X,Bench User %u,U\n", i, i, i, i, i);
+    file.close();
+    timing.record(ESP.getCycleCount() - start);
+    yield();
+  }
+  LittleFS.remove("/bench.txt");
+  printResult(out, "\"name\":\"register_append\"", timing);
+}
+
+/**
+ * @brief Reads command lines from the serial port.
+ *
+ * @return const char* The command once a whole line has arrived, else nullptr.
+ */
+const char* benchCommand() {
+  static char line[16];
+  static uint8_t length = 0;
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c == '\r')
+      continue;
+    if (c != '\n') {
+      if (length < sizeof(line) - 1)
+        line[length++] = c;
+      continue;
+    }
+
+    line[length] = '\0';
+    length = 0;
+    return line;
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Runs every benchmark and prints the results as JSON.
+ *
+ * Times are per operation, measured with the CPU cycle counter. The registered
+ * cards are swapped out of RAM for generated tables while it runs and reloaded
+ * after the document, whose lines nothing else is printed between; `/uids.txt`
+ * is never written.
+ *
+ * @param tap Runs one simulated tap through the decision stage (see main.cpp).
+ */
+void runBenchmarks(Print& out, BenchTap tap) {
+  firstResult = true;
+  out.printf("{\"build\":\"%s %s\",\"cpu_mhz\":%u,\"free_heap\":%lu,\"results\":[", __DATE__,
+             __TIME__, ESP.getCpuFreqMHz(), (unsigned long)ESP.getFreeHeap());
+  benchFormat(out);
+  benchLoadedLookup(out);
+  benchSynthetic(out, tap);
+  benchAppend(out);
+  out.println("\n]}");
+  loadCredentials();
+}
+
+#endif
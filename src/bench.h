@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "uidkey.h"
+
+// On-device benchmarks of the access decision path, only built with
+// -D ENABLE_BENCH (the nodemcuv2_bench environment). Send "bench" over serial
+// to run them; the results come back as one JSON document. The same build
+// takes "replay" for the trace replay in replay.h.
+const uint16_t BENCH_ITERATIONS = 1000;
+const uint8_t BENCH_APPENDS = 32;     // flash appends are slow and wear the flash
+const uint8_t BENCH_LOADED_KEYS = 64; // registered cards sampled for the hit case
+
+// one simulated tap through the decision stage; true if the door would unlock
+typedef bool (*BenchTap)(const UidKey& key);
+
+const char* benchCommand();
+void runBenchmarks(Print& out, BenchTap tap);
@@ -0,0 +1,135 @@
+#include "button.h"
+
+#include "spscqueue.h"
+
+// one debounced level change of an active-low button
+struct ButtonEdge {
+  unsigned long time;
+  bool pressed;
+};
+
+static uint8_t buttonPin = 0;
+static unsigned long debounceWindow = 30;
+static unsigned long longPress = 1500;
+static unsigned long doublePress = 400;
+
+// written by the ISR only (or by loop() with interrupts off)
+static SpscQueue<ButtonEdge, 8> edges;
+static volatile bool lastPressed = false;
+static volatile unsigned long lastEdge = 0;
+
+// gesture state, loop() only
+static bool held = false;
+static unsigned long pressStart = 0;
+static bool longReported = false;
+static bool awaitingSecond = false; // a short press ended, a second one would make it double
+static bool secondPress = false;
+static unsigned long releaseTime = 0;
+
+/**
+ * Edge interrupt: an edge counts if the level really changed and the previous
+ * counted edge is at least the debounce window old; bounces inside the window
+ * are dropped here, so loop() only ever sees clean press/release pairs.
+ */
+static void IRAM_ATTR buttonIsr() {
+  bool pressed = digitalRead(buttonPin) == LOW;
+  unsigned long now = millis();
+  if (pressed == lastPressed || now - lastEdge < debounceWindow)
+    return;
+
+  lastPressed = pressed;
+  lastEdge = now;
+  edges.push({now, pressed});
+}
+
+/**
+ * @brief Attaches the debouncing edge interrupt to an active-low button.
+ *
+ * @param debounceMs    Edges closer than this to the previous one are bounces.
+ * @param longPressMs   Holding this long is a long press (reported while still held).
+ * @param doublePressMs A second press starting this soon after a release makes a double press.
+ */
+void buttonBegin(uint8_t pin, unsigned long debounceMs, unsigned long longPressMs,
+                 unsigned long doublePressMs) {
+  buttonPin = pin;
+  debounceWindow = debounceMs;
+  longPress = longPressMs;
+  doublePress = doublePressMs;
+  pinMode(buttonPin, INPUT_PULLUP);
+  buttonResume();
+}
+
+/**
+ * @brief Re-arms the interrupt, e.g. after light sleep reconfigured the pin for wake-up.
+ *
+ * An edge the interrupt could not see meanwhile is caught up by @ref buttonPoll().
+ */
+void buttonResume() {
+  attachInterrupt(digitalPinToInterrupt(buttonPin), buttonIsr, CHANGE);
+}
+
+// queues the current level if an edge was missed (e.g. the release came inside the window)
+static void catchUpLevel() {
+  bool pressed = digitalRead(buttonPin) == LOW;
+  noInterrupts(); // the ISR is the only other producer
+  if (pressed != lastPressed && millis() - lastEdge >= debounceWindow) {
+    lastPressed = pressed;
+    lastEdge = millis();
+    edges.push({lastEdge, pressed});
+  }
+  interrupts();
+}
+
+/**
+ * @brief Turns queued edges into gestures; call from every loop() pass.
+ *
+ * A short press is only reported once the double-press window has passed
+ * without a second press, so it arrives `doublePressMs` after the release.
+ *
+ * @return ButtonGesture The gesture completed by now, GESTURE_NONE if none.
+ */
+ButtonGesture buttonPoll() {
+  if (edges.empty())
+    catchUpLevel();
+
+  ButtonEdge edge;
+  while (edges.pop(&edge)) {
+    if (edge.pressed) {
+      held = true;
+      pressStart = edge.time;
+      longReported = false;
+      secondPress = awaitingSecond && edge.time - releaseTime < doublePress;
+      awaitingSecond = false;
+      continue;
+    }
+
+    held = false;
+    if (longReported)
+      continue;
+    if (secondPress) {
+      secondPress = false;
+      return GESTURE_DOUBLE;
+    }
+    awaitingSecond = true;
+    releaseTime = edge.time;
+  }
+
+  if (held && !longReported && millis() - pressStart >= longPress) {
+    longReported = true;
+    secondPress = false;
+    return GESTURE_LONG;
+  }
+
+  if (awaitingSecond && millis() - releaseTime >= doublePress) {
+    awaitingSecond = false;
+    return GESTURE_SHORT;
+  }
+  return GESTURE_NONE;
+}
+
+/**
+ * @brief Whether a gesture is in progress (held, or waiting for a possible second press).
+ */
+bool buttonBusy() {
+  return held || awaitingSecond || !edges.empty() || digitalRead(buttonPin) == LOW;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum ButtonGesture : uint8_t { GESTURE_NONE, GESTURE_SHORT, GESTURE_LONG, GESTURE_DOUBLE };
+
+void buttonBegin(uint8_t pin, unsigned long debounceMs, unsigned long longPressMs,
+                 unsigned long doublePressMs);
+void buttonResume();
+ButtonGesture buttonPoll();
+bool buttonBusy();
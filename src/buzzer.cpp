@@ -0,0 +1,68 @@
+#include "buzzer.h"
+
+struct BuzzerNote {
+  uint16_t frequency; // Hz, 0 = silence
+  uint16_t duration;  // ms
+};
+
+const uint8_t MAX_PATTERN_NOTES = 2;
+
+struct BuzzerMelody {
+  uint8_t length;
+  BuzzerNote notes[MAX_PATTERN_NOTES];
+};
+
+// indexed by BuzzerPattern
+static const BuzzerMelody MELODIES[] = {
+    {2, {{1000, 100}, {1500, 100}}}, // BUZZ_SUCCESS: rising chirp
+    {2, {{400, 120}, {400, 120}}},   // BUZZ_DENIED: low buzz
+};
+
+static uint8_t buzzerPin = 0;
+static const BuzzerMelody* playing = nullptr;
+static uint8_t noteIndex = 0;
+static unsigned long noteStart = 0;
+
+static void startNote() {
+  const BuzzerNote& note = playing->notes[noteIndex];
+  noteStart = millis();
+  if (note.frequency == 0)
+    noTone(buzzerPin);
+  else
+    tone(buzzerPin, note.frequency);
+}
+
+void buzzerBegin(uint8_t pin) {
+  buzzerPin = pin;
+  pinMode(buzzerPin, OUTPUT);
+  digitalWrite(buzzerPin, LOW);
+}
+
+/**
+ * @brief Starts a feedback pattern, replacing whatever is playing. Returns immediately.
+ */
+void buzzerPlay(BuzzerPattern pattern) {
+  playing = &MELODIES[pattern];
+  noteIndex = 0;
+  startNote();
+}
+
+/**
+ * @brief Advances the playing pattern; call from every loop() pass.
+ */
+void buzzerUpdate() {
+  if (playing == nullptr || millis() - noteStart < playing->notes[noteIndex].duration)
+    return;
+
+  if (++noteIndex < playing->length) {
+    startNote();
+    return;
+  }
+
+  noTone(buzzerPin);
+  playing = nullptr;
+}
+
+bool buzzerBusy() {
+  return playing != nullptr;
+}
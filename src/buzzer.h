@@ -0,0 +1,10 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum BuzzerPattern : uint8_t { BUZZ_SUCCESS, BUZZ_DENIED };
+
+void buzzerBegin(uint8_t pin);
+void buzzerPlay(BuzzerPattern pattern);
+void buzzerUpdate();
+bool buzzerBusy();
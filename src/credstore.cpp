@@ -0,0 +1,507 @@
+#include "credstore.h"
+
+#include <LittleFS.h>
+#include <algorithm>
+#include <vector>
+
+#include "csvreader.h"
+#include "perfecthash.h"
+#include "schedule.h"
+
+// 4-byte UIDs (by far the most common) take 8 bytes per card, 7/10-byte UIDs 24.
+// Both tables are kept sorted by key for binary search.
+struct ShortEntry {
+  uint32_t uid;
+  Credential cred;
+};
+
+struct LongEntry {
+  UidKey uid;
+  Credential cred;
+};
+
+static std::vector<ShortEntry> shortEntries;
+static std::vector<LongEntry> longEntries;
+
+static UidKey shortKey(uint32_t uid) {
+  return {uid, (uint64_t)4 << 56};
+}
+
+static bool operator<(const ShortEntry& a, const ShortEntry& b) {
+  return a.uid < b.uid;
+}
+
+static bool operator<(const LongEntry& a, const LongEntry& b) {
+  return a.uid < b.uid;
+}
+
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+
+// 64-bit FNV-1a, continuing from `hash`
+static uint64_t fnv1a(uint64_t hash, const char* bytes, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * Open-addressing set of the names in the string table, keyed by their 64-bit
+ * hash and only alive while the table is loaded. Names are told apart by hash
+ * alone: among 10,000 distinct names the chance of any two sharing a 64-bit
+ * hash is below 1e-11.
+ */
+class NameIndex {
+public:
+  // offset of the name if it was added before; otherwise adds it at `offset` and returns -1
+  int32_t findOrAdd(uint64_t hash, uint32_t offset) {
+    if ((used + 1) * 2 > slots.size())
+      grow();
+    hash = hash == 0 ? 1 : hash; // 0 marks an empty slot
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      if (slots[i].hash == hash)
+        return slots[i].offset;
+      if (slots[i].hash == 0) {
+        slots[i] = {hash, offset};
+        used++;
+        return -1;
+      }
+    }
+  }
+
+  size_t size() const {
+    return used;
+  }
+
+private:
+  struct Slot {
+    uint64_t hash;
+    uint32_t offset;
+  };
+
+  void grow() {
+    std::vector<Slot> old(slots.size() ? slots.size() * 2 : 64);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+      if (slot.hash == 0)
+        continue;
+      size_t i = slot.hash & mask;
+      while (slots[i].hash != 0)
+        i = (i + 1) & mask;
+      slots[i] = slot;
+    }
+  }
+
+  std::vector<Slot> slots;
+  size_t used = 0;
+};
+
+// what /names.txt must hold for the cards loaded: its size and 64-bit FNV-1a of its bytes
+struct NameTableStamp {
+  uint32_t size;
+  uint64_t hash;
+};
+
+// reads the newline-terminated name at offset into a caller buffer of CSV_MAX_LINE bytes
+static bool readName(File& names, uint32_t offset, char* name) {
+  if (!names.seek(offset))
+    return false;
+  size_t length = names.readBytesUntil('\n', name, CSV_MAX_LINE - 1);
+  name[length] = '\0';
+  return true;
+}
+
+// streams the string table looking for an existing copy of the name
+static int32_t findName(File& names, const char* name) {
+  char stored[CSV_MAX_LINE];
+  names.seek(0);
+  while (names.available()) {
+    uint32_t offset = names.position();
+    size_t length = names.readBytesUntil('\n', stored, sizeof(stored) - 1);
+    stored[length] = '\0';
+    if (strcmp(stored, name) == 0)
+      return offset;
+  }
+  return -1;
+}
+
+static uint32_t appendName(File& names, const char* name) {
+  names.seek(0, SeekEnd);
+  uint32_t offset = names.position();
+  names.printf("%s\n", name);
+  return offset;
+}
+
+// a role is one letter (A = admin); anything else, e.g. "Auditor", is stored as '?', no role
+static char roleLetter(const char* role) {
+  if (!isalpha((unsigned char)role[0]) || role[1] != '\0')
+    return '?';
+  return toupper((unsigned char)role[0]);
+}
+
+// appends without sorting; callers sort once they are done adding
+static void addToTable(const UidKey& uid, char role, uint32_t nameOffset) {
+  Credential cred = {};
+  cred.nameOffset = nameOffset;
+  cred.flags = hasUserSchedule(uid) ? CRED_OWN_SCHEDULE : 0;
+  cred.role = role;
+
+  if (uidKeyLength(uid) == 4)
+    shortEntries.push_back({(uint32_t)uid.lo, cred});
+  else
+    longEntries.push_back({uid, cred});
+}
+
+// stable so that, like the old line-by-line scan, the first line for a UID wins
+static void sortTables() {
+  std::stable_sort(shortEntries.begin(), shortEntries.end());
+  std::stable_sort(longEntries.begin(), longEntries.end());
+}
+
+/**
+ * @brief Walks the valid lines of `/uids.txt`, giving each distinct name its
+ * string table offset.
+ *
+ * Names are laid out in order of first appearance, so the offsets (and the
+ * whole string table) follow from `/uids.txt` alone. `visit` gets every valid
+ * line with its name's offset and whether the name is new at that offset.
+ *
+ * @return NameTableStamp What `/names.txt` holds when it matches the file.
+ */
+template <typename Visit> static NameTableStamp walkCredentials(File& file, Visit visit) {
+  NameIndex index;
+  NameTableStamp stamp = {0, FNV_OFFSET};
+
+  // parse the csv lines in place: UID,Name,Role
+  CsvReader reader(file);
+  while (reader.next()) {
+    UidKey uid;
+    if (reader.fieldCount() != 3 || !parseUidKey(reader.field(0), &uid)) {
+      Serial.printf("Ignoring bad UID line: %s\n", reader.field(0));
+      continue;
+    }
+
+    const char* name = reader.field(1);
+    size_t length = strlen(name);
+    int32_t nameOffset = index.findOrAdd(fnv1a(FNV_OFFSET, name, length), stamp.size);
+    bool added = nameOffset == -1;
+    if (added) {
+      nameOffset = stamp.size;
+      stamp.size += length + 1;
+      stamp.hash = fnv1a(fnv1a(stamp.hash, name, length), "\n", 1);
+    }
+    visit(uid, name, reader.field(2), nameOffset, added);
+  }
+
+  if (reader.skippedLines() > 0)
+    Serial.printf("Skipped %u overlong UID lines\n", (unsigned)reader.skippedLines());
+  return stamp;
+}
+
+// whether /names.txt already holds exactly the expected bytes
+static bool nameTableMatches(const NameTableStamp& expected) {
+  File names = LittleFS.open("/names.txt", "r");
+  if (!names || names.size() != expected.size)
+    return false;
+
+  char chunk[CSV_CHUNK];
+  uint64_t hash = FNV_OFFSET;
+  size_t bytes;
+  while ((bytes = names.read((uint8_t*)chunk, sizeof(chunk))) > 0)
+    hash = fnv1a(hash, chunk, bytes);
+  names.close();
+  return hash == expected.hash;
+}
+
+// rewrites /names.txt from /uids.txt (absent: empty)
+static bool rebuildNameTable() {
+  File names = LittleFS.open("/names.txt", "w");
+  if (!names) {
+    Serial.println("Failed to open name table for writing");
+    return false;
+  }
+
+  File file = LittleFS.open("/uids.txt", "r");
+  if (file) {
+    walkCredentials(file, [&](const UidKey&, const char* name, const char*, uint32_t, bool added) {
+      if (added)
+        names.printf("%s\n", name);
+    });
+    file.close();
+  }
+  names.close();
+  Serial.println("Name table rebuilt");
+  return true;
+}
+
+/**
+ * @brief Loads `/uids.txt` into the in-RAM credential table.
+ *
+ * `/uids.txt` stays the source of truth (`UID,Name,Role`, one card per line).
+ * Each distinct name is stored once in the `/names.txt` string table and each
+ * card keeps only the offset of its name, so the table in RAM holds fixed-size
+ * entries only. The string table is only rewritten when it no longer matches
+ * `/uids.txt` (edited by hand, or a registration that did not finish), so a
+ * normal boot reads both files and writes nothing.
+ *
+ * @return true  If the table was loaded (an absent `/uids.txt` loads an empty table).
+ * @return false If one of the files could not be opened.
+ */
+bool loadCredentials() {
+  shortEntries.clear();
+  longEntries.clear();
+
+  NameTableStamp expected = {0, FNV_OFFSET};
+  size_t distinctNames = 0;
+  if (LittleFS.exists("/uids.txt")) {
+    File file = LittleFS.open("/uids.txt", "r");
+    if (!file) {
+      Serial.println("Failed to open uid file for reading");
+      return false;
+    }
+    expected = walkCredentials(file, [&](const UidKey& uid, const char*, const char* role,
+                                         uint32_t nameOffset, bool added) {
+      char letter = roleLetter(role);
+      if (letter == '?' && role[0] != '\0') {
+        char uidText[UID_TEXT_SIZE];
+        formatUidKey(uid, uidText);
+        Serial.printf("Role \"%s\" of %s is not one letter, loaded without a role\n", role,
+                      uidText);
+      }
+      addToTable(uid, letter, nameOffset);
+      distinctNames += added;
+    });
+    file.close();
+    sortTables();
+  } else {
+    Serial.println("No UID file found.");
+  }
+
+  if (!nameTableMatches(expected) && !rebuildNameTable())
+    return false;
+
+  Serial.printf("Loaded %u UIDs (%u distinct names)\n", (unsigned)credentialCount(),
+                (unsigned)distinctNames);
+  return true;
+}
+
+/**
+ * @brief Looks up a UID in the perfect hash image, then in the in-RAM credential table.
+ *
+ * The table lookup is a binary search over packed keys: each probe is one integer compare for 4-byte
+ * UIDs and at most two for 7/10-byte UIDs.
+ *
+ * @param uid The packed UID.
+ *
+ * @return const Credential* The matching entry, or nullptr if the UID is not registered.
+ */
+const Credential* findCredential(const UidKey& uid) {
+  const Credential* cred = findInPerfectHash(uid);
+  if (cred != nullptr)
+    return cred;
+
+  if (uidKeyLength(uid) == 4) {
+    ShortEntry probe = {(uint32_t)uid.lo, {}};
+    auto it = std::lower_bound(shortEntries.begin(), shortEntries.end(), probe);
+    return it != shortEntries.end() && it->uid == probe.uid ? &it->cred : nullptr;
+  }
+
+  LongEntry probe = {uid, {}};
+  auto it = std::lower_bound(longEntries.begin(), longEntries.end(), probe);
+  return it != longEntries.end() && it->uid == uid ? &it->cred : nullptr;
+}
+
+/**
+ * @brief Reads a credential's name from the `/names.txt` string table or the image.
+ *
+ * @param name Receives the name; at least @ref CSV_MAX_LINE bytes. Left empty
+ *             if the name cannot be read.
+ */
+bool credentialName(const Credential& cred, char* name) {
+  name[0] = '\0';
+  bool fromImage = cred.flags & CRED_FROM_IMAGE;
+  File names = LittleFS.open(fromImage ? "/creds.phf" : "/names.txt", "r");
+  if (!names) {
+    Serial.println("Failed to open name table for reading");
+    return false;
+  }
+
+  bool found = readName(names, cred.nameOffset + (fromImage ? perfectHashNamesOffset() : 0), name);
+  names.close();
+  if (!found)
+    name[0] = '\0';
+  return found;
+}
+
+// trims leading and trailing whitespace in place
+static char* trimInPlace(char* text) {
+  while (isspace((unsigned char)*text))
+    text++;
+  char* end = text + strlen(text);
+  while (end > text && isspace((unsigned char)end[-1]))
+    end--;
+  *end = '\0';
+  return text;
+}
+
+/**
+ * @brief Recomputes per-credential flags after `/schedules.txt` has been reloaded.
+ */
+void refreshCredentialFlags() {
+  for (ShortEntry& entry : shortEntries)
+    entry.cred.flags = hasUserSchedule(shortKey(entry.uid)) ? CRED_OWN_SCHEDULE : 0;
+  for (LongEntry& entry : longEntries)
+    entry.cred.flags = hasUserSchedule(entry.uid) ? CRED_OWN_SCHEDULE : 0;
+}
+
+size_t credentialCount() {
+  return shortEntries.size() + longEntries.size();
+}
+
+#ifdef ENABLE_BENCH
+/**
+ * @brief Benchmarks only: replaces the in-RAM table with `count` generated cards.
+ *
+ * Nothing is written to flash. Call with a count of 0 to give the memory back,
+ * then @ref loadCredentials() to restore the registered cards.
+ */
+void loadSyntheticCredentials(size_t count, UidKey (*keyAt)(size_t index)) {
+  std::vector<ShortEntry>().swap(shortEntries);
+  std::vector<LongEntry>().swap(longEntries);
+  // the generated cards all have the same length: size that table up front
+  if (count > 0 && uidKeyLength(keyAt(0)) == 4)
+    shortEntries.reserve(count);
+  else if (count > 0)
+    longEntries.reserve(count);
+  for (size_t i = 0; i < count; i++)
+    addToTable(keyAt(i), 'U', 0);
+  sortTables();
+}
+
+/**
+ * @brief Benchmarks only: adds one card to the in-RAM table, without a name and
+ * without touching flash.
+ */
+void addSyntheticCredential(const UidKey& uid, char role) {
+  addToTable(uid, role, 0);
+  sortTables();
+}
+#endif
+
+/**
+ * @brief Registers (saves) a new RFID UID entry to the LittleFS storage.
+ *
+ * This function appends a new record to `/uids.txt` in CSV format: `UID,Name,Role`,
+ * adds the name to the `/names.txt` string table unless it is already there, and
+ * inserts the card into the in-RAM table.
+ * UID and Role parameters are cleaned and converted to uppercase for consistency;
+ * `name` and `role` are trimmed in place, so they must be writable.
+ * The function does not perform duplicate checks; you must verify that the
+ * UID does not already exist using @ref checkUID() before calling this function.
+ *
+ * Example usage:
+ * ```cpp
+ * if (!checkUID(uid)) {
+ *   registerUID(uid, name, role);
+ * }
+ * ```
+ *
+ * @param uid  The RFID card's UID string (e.g., "AA:BB:CC:DD").
+ * @param name The user's name associated with the UID.
+ * @param role The user's role, one letter (e.g., "A" for admin, "U" for user").
+ *
+ * @return true  If the entry was successfully written to the file.
+ * @return false If the role is not one letter, or file open or write failed.
+ */
+bool registerUID(const char* uid, char* name, char* role) {
+  UidKey key;
+  if (!parseUidKey(uid, &key)) {
+    Serial.printf("Invalid UID: %s\n", uid);
+    return false;
+  }
+  char uidText[UID_TEXT_SIZE];
+  uint8_t uidLength = formatUidKey(key, uidText);
+  name = trimInPlace(name);
+  role = trimInPlace(role);
+  for (char* c = role; *c != '\0'; c++)
+    *c = toupper((unsigned char)*c);
+  if (roleLetter(role) == '?') {
+    Serial.printf("Invalid role: %s (one letter, e.g. A or U)\n", role);
+    return false;
+  }
+
+  // the line has to fit the loader's buffer to be read back at boot
+  if (uidLength + strlen(name) + strlen(role) + 3 > CSV_MAX_LINE - 1) {
+    Serial.printf("Name too long: %s\n", name);
+    return false;
+  }
+
+  File names = LittleFS.open("/names.txt", "r+");
+  if (!names) {
+    Serial.println("Failed to open name table for writing");
+    return false;
+  }
+
+  int32_t nameOffset = findName(names, name);
+  if (nameOffset == -1)
+    nameOffset = appendName(names, name);
+  names.close();
+
+  File file = LittleFS.open("/uids.txt", "a");
+  if (!file) {
+    Serial.println("Failed to open uid file for writing");
+    return false;
+  }
+
+  file.printf("%s,%s,%s\n", uidText, name, role);
+  file.close();
+
+  addToTable(key, role[0], nameOffset);
+  sortTables();
+
+  Serial.printf("Added new UID: %s | Name: %s | Role: %s\n", uidText, name, role);
+  return true;
+}
+
+/**
+ * @brief Checks if a given UID is registered.
+ *
+ * Looks the UID up in the in-RAM credential table. The name is only read from
+ * the `/names.txt` string table when the caller asks for it.
+ *
+ * Example usage:
+ * ```cpp
+ * char name[CSV_MAX_LINE], role[2];
+ * if (checkUID("AA:BB:CC:DD", name, role)) {
+ *   Serial.printf("Welcome %s (%s)\n", name, role);
+ * }
+ * ```
+ *
+ * @param uid   The UID string to check (e.g., "AA:BB:CC:DD").
+ * @param name  Optional buffer of @ref CSV_MAX_LINE bytes to receive the user's name (nullable).
+ * @param role  Optional buffer of 2 bytes to receive the user's role (nullable).
+ *
+ * @return true  If the UID was found.
+ * @return false If the UID was not found.
+ */
+bool checkUID(const char* uid, char* name, char* role) {
+  UidKey key;
+  const Credential* cred = parseUidKey(uid, &key) ? findCredential(key) : nullptr;
+  if (cred == nullptr) {
+    Serial.println("UID not found");
+    return false;
+  }
+
+  if (name != nullptr)
+    credentialName(*cred, name);
+  if (role != nullptr) {
+    role[0] = (char)cred->role;
+    role[1] = '\0';
+  }
+
+  Serial.println("UID found");
+  return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "csvreader.h"
+#include "uidkey.h"
+
+// credential flags
+const uint8_t CRED_OWN_SCHEDULE = 0x01; // the UID has its own lines in /schedules.txt
+const uint8_t CRED_FROM_IMAGE = 0x02;   // entry comes from the /creds.phf perfect hash image
+
+/**
+ * Fixed-size in-RAM data for one registered card, stored next to its packed UID.
+ * Names are not kept in RAM: `nameOffset` points into the `/names.txt` string
+ * table (or the name section of `/creds.phf`) and is only read when a name is
+ * actually displayed.
+ */
+struct Credential {
+  uint32_t nameOffset : 20; // string table is limited to 1 MB
+  uint32_t flags : 4;
+  uint32_t role : 8; // 'A' = admin, 'U' = user
+};
+
+bool loadCredentials();
+const Credential* findCredential(const UidKey& uid);
+bool credentialName(const Credential& cred, char* name);
+void refreshCredentialFlags();
+size_t credentialCount();
+#ifdef ENABLE_BENCH
+void loadSyntheticCredentials(size_t count, UidKey (*keyAt)(size_t index));
+void addSyntheticCredential(const UidKey& uid, char role);
+#endif
+
+bool registerUID(const char* uid, char* name, char* role);
+bool checkUID(const char* uid, char* name = nullptr, char* role = nullptr);
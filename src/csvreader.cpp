@@ -0,0 +1,81 @@
+#include "csvreader.h"
+
+int CsvReader::readChar() {
+  if (chunkPos == chunkLength) {
+    chunkLength = in.readBytes(chunk, sizeof(chunk));
+    chunkPos = 0;
+    if (chunkLength == 0)
+      return -1;
+  }
+  consumed++;
+  return (uint8_t)chunk[chunkPos++];
+}
+
+static char* trimInPlace(char* start, char* end) {
+  while (start < end && isspace((uint8_t)*start))
+    start++;
+  while (end > start && isspace((uint8_t)end[-1]))
+    end--;
+  *end = '\0';
+  return start;
+}
+
+void CsvReader::split() {
+  char* end = buffer + strlen(buffer);
+  char* firstComma = strchr(buffer, ',');
+  char* lastComma = strrchr(buffer, ',');
+
+  if (firstComma == nullptr) {
+    fields[0] = trimInPlace(buffer, end);
+    count = 1;
+  } else if (firstComma == lastComma) {
+    fields[0] = trimInPlace(buffer, firstComma);
+    fields[1] = trimInPlace(firstComma + 1, end);
+    count = 2;
+  } else {
+    fields[0] = trimInPlace(buffer, firstComma);
+    fields[1] = trimInPlace(firstComma + 1, lastComma);
+    fields[2] = trimInPlace(lastComma + 1, end);
+    count = 3;
+  }
+}
+
+/**
+ * @brief Advances to the next non-blank line and splits it into fields.
+ *
+ * Lines longer than @ref CSV_MAX_LINE are skipped (and counted in skippedLines())
+ * rather than split at an arbitrary point.
+ *
+ * @return true  If a line is available through field().
+ * @return false At end of input.
+ */
+bool CsvReader::next() {
+  while (true) {
+    size_t length = 0;
+    bool tooLong = false;
+    int c;
+
+    while ((c = readChar()) != -1 && c != '\n') {
+      if (length < sizeof(buffer) - 1)
+        buffer[length++] = c;
+      else
+        tooLong = true;
+    }
+    buffer[length] = '\0';
+
+    if (tooLong) {
+      skipped++;
+      continue;
+    }
+
+    char* start = trimInPlace(buffer, buffer + length);
+    if (*start != '\0') {
+      memmove(buffer, start, strlen(start) + 1);
+      split();
+      return true;
+    }
+
+    if (c == -1)
+      return false;
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+
+const size_t CSV_MAX_LINE = 96;
+const size_t CSV_CHUNK = 64;
+
+/**
+ * Streaming reader for the lock's `KEY,MIDDLE,LAST` files (`/uids.txt`,
+ * `/schedules.txt`).
+ *
+ * Reads through fixed buffers held in the object (put it on the stack) and
+ * splits each line in place at its first and last comma, so the middle field may
+ * itself contain commas, as names can. Fields are trimmed, NUL-terminated
+ * pointers into the line buffer and stay valid until the next call to next().
+ * Nothing is allocated on the heap.
+ */
+class CsvReader {
+public:
+  explicit CsvReader(Stream& in) : in(in) {}
+
+  bool next();
+
+  uint8_t fieldCount() const {
+    return count;
+  }
+
+  const char* field(uint8_t index) const {
+    return index < count ? fields[index] : "";
+  }
+
+  size_t skippedLines() const {
+    return skipped;
+  }
+
+  uint32_t bytesRead() const {
+    return consumed;
+  }
+
+private:
+  int readChar();
+  void split();
+
+  Stream& in;
+  char chunk[CSV_CHUNK];
+  size_t chunkLength = 0;
+  size_t chunkPos = 0;
+  char buffer[CSV_MAX_LINE];
+  char* fields[3];
+  uint8_t count = 0;
+  size_t skipped = 0;
+  uint32_t consumed = 0;
+};
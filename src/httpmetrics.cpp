@@ -0,0 +1,203 @@
+#include "httpmetrics.h"
+
+#include <stdarg.h>
+
+#include "requestarena.h"
+
+// upper bounds of the latency histogram buckets in ms; one more bucket catches the rest
+static const uint16_t LATENCY_BOUNDS_MS[METRICS_LATENCY_BUCKETS] = {1,   2,   5,   10,  20,
+                                                                    50,  100, 200, 500, 1000};
+
+struct RouteMetrics {
+  const char* path;
+  const char* method;
+  uint32_t requests;
+  uint32_t requestBytes;
+  uint32_t latencySumUs;
+  uint32_t buckets[METRICS_LATENCY_BUCKETS + 1];
+  int32_t maxHeapDelta; // bytes of heap a request kept (or freed, if negative)
+};
+
+static RouteMetrics routes[METRICS_MAX_ROUTES];
+static uint8_t routeCount = 0;
+
+// heap gauges
+static unsigned long lastHeapSample = 0;
+static uint32_t freeHeap = 0;
+static uint32_t minFreeHeap = UINT32_MAX;
+static uint32_t maxFreeBlock = 0;
+static uint8_t fragmentation = 0;
+
+static void recordRequest(RouteMetrics& route, uint32_t us, int32_t heapDelta, size_t bytes) {
+  if (route.requests == 0 || heapDelta > route.maxHeapDelta)
+    route.maxHeapDelta = heapDelta;
+  route.requests++;
+  route.requestBytes += bytes;
+  route.latencySumUs += us;
+
+  uint8_t bucket = 0;
+  while (bucket < METRICS_LATENCY_BUCKETS && us > LATENCY_BOUNDS_MS[bucket] * 1000UL)
+    bucket++;
+  route.buckets[bucket]++;
+}
+
+/**
+ * @brief Registers a portal route whose requests are counted, timed and heap-checked.
+ *
+ * Same as `server.on()`, with the handler wrapped. Routes beyond
+ * @ref METRICS_MAX_ROUTES are registered without metrics. Either way the
+ * request arena is reset once the handler returns.
+ */
+void meteredOn(ESP8266WebServer& server, const char* path, HTTPMethod method,
+               void (*handler)()) {
+  if (routeCount == METRICS_MAX_ROUTES) {
+    server.on(path, method, [handler]() {
+      handler();
+      arenaReset();
+    });
+    return;
+  }
+
+  RouteMetrics& route = routes[routeCount++];
+  route = {};
+  route.path = path;
+  route.method = method == HTTP_GET ? "GET" : method == HTTP_POST ? "POST" : "ANY";
+  server.on(path, method, [&server, &route, handler]() {
+    uint32_t heapBefore = ESP.getFreeHeap();
+    unsigned long start = micros();
+    handler();
+    arenaReset();
+    recordRequest(route, micros() - start, (int32_t)(heapBefore - ESP.getFreeHeap()),
+                  max(server.clientContentLength(), 0));
+  });
+}
+
+/**
+ * @brief Samples the heap gauges; call from every loop() pass.
+ */
+void sampleHeap() {
+  if (millis() - lastHeapSample < HEAP_SAMPLE_INTERVAL)
+    return;
+  lastHeapSample = millis();
+
+  freeHeap = ESP.getFreeHeap();
+  maxFreeBlock = ESP.getMaxFreeBlockSize();
+  fragmentation = ESP.getHeapFragmentation();
+  if (freeHeap < minFreeHeap)
+    minFreeHeap = freeHeap;
+}
+
+// upper bound of the bucket holding the given quantile, in ms
+static uint32_t latencyQuantile(const RouteMetrics& route, uint32_t permille) {
+  uint32_t rank = (route.requests * permille + 999) / 1000;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+    seen += route.buckets[i];
+    if (seen >= rank)
+      return LATENCY_BOUNDS_MS[i];
+  }
+  return LATENCY_BOUNDS_MS[METRICS_LATENCY_BUCKETS - 1] * 2;
+}
+
+// formats one line of the exposition into a stack buffer and hands it to emit
+static void emitLine(void (*emit)(const char*, size_t), const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void emitLine(void (*emit)(const char*, size_t), const char* format, ...) {
+  char line[128];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length > 0)
+    emit(line, min<size_t>(length, sizeof(line) - 1));
+}
+
+// the per-route samples that are one value each
+enum RouteSample : uint8_t {
+  SAMPLE_REQUESTS,
+  SAMPLE_BYTES,
+  SAMPLE_P50,
+  SAMPLE_P99,
+  SAMPLE_HEAP_DELTA,
+};
+
+/**
+ * @brief Writes one metric family: its TYPE line, then the sample of every route.
+ *
+ * Quantiles and the heap delta are left out for routes with no requests yet.
+ */
+static void writeRouteFamily(void (*emit)(const char*, size_t), const char* name,
+                             const char* type, RouteSample sample) {
+  emitLine(emit, "# TYPE %s %s\n", name, type);
+  for (uint8_t r = 0; r < routeCount; r++) {
+    const RouteMetrics& route = routes[r];
+    if (sample >= SAMPLE_P50 && route.requests == 0)
+      continue;
+
+    if (sample == SAMPLE_HEAP_DELTA) {
+      emitLine(emit, "%s{route=\"%s\",method=\"%s\"} %ld\n", name, route.path, route.method,
+               (long)route.maxHeapDelta);
+      continue;
+    }
+    uint32_t value = sample == SAMPLE_REQUESTS ? route.requests
+                     : sample == SAMPLE_BYTES  ? route.requestBytes
+                     : sample == SAMPLE_P50    ? latencyQuantile(route, 500)
+                                               : latencyQuantile(route, 990);
+    emitLine(emit, "%s{route=\"%s\",method=\"%s\"} %lu\n", name, route.path, route.method,
+             (unsigned long)value);
+  }
+}
+
+// the latency histogram: buckets, sum and count of every route, under one TYPE line
+static void writeDurationHistogram(void (*emit)(const char*, size_t)) {
+  emitLine(emit, "# TYPE rfid_http_request_duration_ms histogram\n");
+  for (uint8_t r = 0; r < routeCount; r++) {
+    const RouteMetrics& route = routes[r];
+    const char* path = route.path;
+    const char* method = route.method;
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+      cumulative += route.buckets[i];
+      emitLine(emit,
+               "rfid_http_request_duration_ms_bucket{route=\"%s\",method=\"%s\",le=\"%u\"} %lu\n",
+               path, method, (unsigned)LATENCY_BOUNDS_MS[i], (unsigned long)cumulative);
+    }
+    emitLine(emit,
+             "rfid_http_request_duration_ms_bucket{route=\"%s\",method=\"%s\",le=\"+Inf\"} %lu\n",
+             path, method, (unsigned long)route.requests);
+    emitLine(emit, "rfid_http_request_duration_ms_sum{route=\"%s\",method=\"%s\"} %lu\n", path,
+             method, (unsigned long)(route.latencySumUs / 1000));
+    emitLine(emit, "rfid_http_request_duration_ms_count{route=\"%s\",method=\"%s\"} %lu\n", path,
+             method, (unsigned long)route.requests);
+  }
+}
+
+/**
+ * @brief Writes every metric in Prometheus text format, one line at a time.
+ *
+ * Each family is one contiguous group after its TYPE line, as the exposition
+ * format requires. p50/p99 are estimated as the upper bound of the histogram
+ * bucket they fall in.
+ */
+void writeMetrics(void (*emit)(const char* line, size_t length)) {
+  writeRouteFamily(emit, "rfid_http_requests_total", "counter", SAMPLE_REQUESTS);
+  writeRouteFamily(emit, "rfid_http_request_bytes_total", "counter", SAMPLE_BYTES);
+  writeDurationHistogram(emit);
+  writeRouteFamily(emit, "rfid_http_request_latency_p50_ms", "gauge", SAMPLE_P50);
+  writeRouteFamily(emit, "rfid_http_request_latency_p99_ms", "gauge", SAMPLE_P99);
+  writeRouteFamily(emit, "rfid_http_request_heap_delta_max_bytes", "gauge", SAMPLE_HEAP_DELTA);
+
+  emitLine(emit, "# TYPE rfid_heap_free_bytes gauge\nrfid_heap_free_bytes %lu\n",
+           (unsigned long)freeHeap);
+  emitLine(emit, "# TYPE rfid_heap_free_min_bytes gauge\nrfid_heap_free_min_bytes %lu\n",
+           (unsigned long)minFreeHeap);
+  emitLine(emit, "# TYPE rfid_heap_max_block_bytes gauge\nrfid_heap_max_block_bytes %lu\n",
+           (unsigned long)maxFreeBlock);
+  emitLine(emit,
+           "# TYPE rfid_heap_fragmentation_percent gauge\nrfid_heap_fragmentation_percent %u\n",
+           (unsigned)fragmentation);
+  emitLine(emit,
+           "# TYPE rfid_http_arena_high_water_bytes gauge\nrfid_http_arena_high_water_bytes %lu\n",
+           (unsigned long)arenaHighWater());
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+
+// per-route portal metrics, kept in fixed storage
+const uint8_t METRICS_MAX_ROUTES = 12;
+const uint8_t METRICS_LATENCY_BUCKETS = 10;
+const unsigned long HEAP_SAMPLE_INTERVAL = 1000; // ms between heap gauge samples
+
+void meteredOn(ESP8266WebServer& server, const char* path, HTTPMethod method,
+               void (*handler)());
+void sampleHeap();
+void writeMetrics(void (*emit)(const char* line, size_t length));
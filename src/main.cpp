@@ -2,54 +2,196 @@
 #include <ESP8266WebServer.h>
 #include <ESP8266WiFi.h>
 #include <LittleFS.h>
-#include <MFRC522.h>
 #include <SPI.h>
 
+#include "actuator.h"
+#include "audit.h"
+#include "bench.h"
+#include "button.h"
+#include "buzzer.h"
+#include "credstore.h"
+#include "csvreader.h"
+#include "httpmetrics.h"
+#include "modefsm.h"
+#include "perfecthash.h"
+#include "pipeline.h"
+#include "pn532reader.h"
+#include "powersave.h"
+#include "reader.h"
+#include "replay.h"
+#include "requestarena.h"
+#include "schedule.h"
+#include "securecard.h"
+#include "spscqueue.h"
+#include "timekeeper.h"
+
 // pinouts
 #define RST_PIN D1     // RST - 05
 #define SS_PIN D2      // SDA - 04
 #define LOCK_PIN D0    // Linear Actuator (TIP120) - 16
 #define BUZZER_PIN D8  // 15
 #define MODE_BUTTON D3 // 0
-MFRC522 scanner(SS_PIN, RST_PIN);
+// second reader (e.g. inside the door for exit tracking): build with -D PN532_SS_PIN=D4
+
 ESP8266WebServer server(80);
 
 // globals
-String lastScannedUID = "";
+char lastScannedUID[UID_TEXT_SIZE] = "";
 bool webServerActive = false;
 const char* ssid = "RFID register";
 const char* password = "robotics";
 
-// 0 = waiting for admin
-// 1 = waiting for new UID
-uint8_t addUIDStage = 0;
-
-// non-blocking door timing
+// door timing: a timer0 interrupt relocks, loop() only does the bookkeeping
 bool isUnlocked = false;
-unsigned long unlockStartTime = 0;
 const unsigned long UNLOCK_DURATION = 7000UL; // milliseconds (7 seconds)
 
+// unlock drive: full power to pull the actuator in, then a reduced duty to hold it,
+// which keeps the TIP120 cool and the supply (and the reader on it) steady
+const ActuatorStep UNLOCK_PROFILE[] = {
+    {100, 300}, // pull-in, ms
+    {40, 0},    // hold until relock
+};
+const uint32_t LOCK_PWM_FREQUENCY = 1000; // Hz
+uint32_t unlockStartUs = 0;
+volatile bool relockFired = false;
+volatile uint32_t relockFiredUs = 0;
+
+// everything the lock drives outside the firmware: the door, the relock timer and
+// the portal's radio
+struct LockOutputs {
+  void (*door)(bool locked);
+  void (*armRelock)();
+  void (*disarmRelock)();
+  void (*portal)(bool on);
+};
+
+// how late the relock callback ran, in microseconds
+uint32_t relockCount = 0;
+uint32_t relockLateTotal = 0;
+uint32_t relockLateWorst = 0;
+
 // mode timeout for ADD new uid mode
 unsigned long addModeStartTime = 0;
 const unsigned long ADD_MODE_TIMEOUT = 300000UL; // 5 minutes (300,000 ms)
 
-enum SystemMode { DOOR_LOCK_MODE, ADD_NEW_UID_MODE };
-SystemMode currentMode = DOOR_LOCK_MODE;
+// MODE button gestures: short = toggle mode, long = force-lock, double = status dump
+const unsigned long BUTTON_DEBOUNCE_MS = 30;
+const unsigned long BUTTON_LONG_PRESS_MS = 1500;
+const unsigned long BUTTON_DOUBLE_PRESS_MS = 400;
+
+// adaptive reader polling: fast after activity, backing off to the latency bound when idle
+// (a PN532 reports a card on a follow-up poll a few ms after the one that listed it)
+const unsigned long SCAN_FAST_INTERVAL = 20;   // ms between polls right after activity
+const unsigned long SCAN_FAST_WINDOW = 30000UL; // stay fast for 30 s after a card or button
+const unsigned long SCAN_MAX_INTERVAL = 250;   // worst-case card detection latency when idle
 
-// MODE button states
-bool lastButtonState = HIGH;
-unsigned long lastButtonPress = 0;
-const unsigned long MODE_DEBOUNCE_MS = 400;
+// several cards presented together (e.g. a wallet) are all read, within a time bound
+const unsigned long MULTI_CARD_BUDGET_US = 100000UL; // 100 ms
+
+// readers, polled in turn; the reader ID tags every card event
+Mfrc522Reader entryReader(0, "entry reader", SS_PIN, RST_PIN, MULTI_CARD_BUDGET_US);
+#ifdef PN532_SS_PIN
+Pn532Reader exitReader(1, "exit reader", PN532_SS_PIN);
+CardReader* readers[] = {&entryReader, &exitReader};
+#else
+CardReader* readers[] = {&entryReader};
+#endif
+const uint8_t READER_COUNT = sizeof(readers) / sizeof(readers[0]);
+uint8_t nextReader = 0;
+
+// card handling pipeline: reader -> decision -> actuator / buzzer / log
+const uint8_t CARD_QUEUE_SIZE = 2;
+SpscQueue<CardEvent, CARD_QUEUE_SIZE> cardQueue;
+SpscQueue<ActuatorRequest, 4> actuatorQueue;
+SpscQueue<BuzzerPattern, 4> buzzerQueue;
+SpscQueue<AccessRecord, 8> logQueue; // two full multi-card events
+StageLatency decisionLatency = {};
+StageLatency actuationLatency = {};
+StageLatency logLatency = {};
+
+// light sleep between polls while the door is idle; the button wakes the chip at once,
+// cards are still noticed within SCAN_MAX_INTERVAL
+#ifdef ENABLE_BENCH
+const bool IDLE_LIGHT_SLEEP = false; // the UART cannot wake the chip for a bench command
+#else
+const bool IDLE_LIGHT_SLEEP = true;
+#endif
+const unsigned long LIGHT_SLEEP_MIN_MS = 10; // shorter idle gaps are not worth the wake-up
+
+// periodic serial stats for tuning (intervals count awake time, millis() stops in light sleep)
+unsigned long lastStatsPrint = 0;
+const unsigned long STATS_INTERVAL = 60000UL; // 1 minute
 
 // forward declarations
-bool registerUID(String uid, String name, String role);
-bool checkUID(String uid, String* name, String* role);
-String scanTag();
+bool scanTags(CardEvent* event);
+bool cardAuthentic(const CardEvent& event, uint8_t index);
+void readerStage();
+void decisionStage();
+void handleAddModeCard(const CardEvent& event);
+void actuatorStage();
+void buzzerStage();
+void logStage();
+void printPipelineStats();
+void idleSleep();
+void printStatus();
+void handleGesture(ButtonGesture gesture);
+#ifdef ENABLE_BENCH
+bool benchTap(const UidKey& key);
+bool replayTap(const UidKey& key);
+ReplayOutcome replayStep();
+RegisterResult replayRegister(const UidKey& key, char role);
+extern const ReplayHooks REPLAY_HOOKS;
+extern const LockOutputs REPLAY_OUTPUTS;
+#endif
+void setupRoutes();
 void startWebServer();
 void stopWebServer();
+void portalRadio(bool on);
 void lockControl(bool locked);
-void buzzSuccess();
-void buzzDenied();
+void armRelock();
+void disarmRelock();
+void relockIsr();
+void relockCallback();
+void relocked();
+void finishRelock();
+void enterAddMode();
+void leaveAddMode();
+void expireAddMode();
+void authorizeAdmin();
+void rejectUser();
+void extendAddMode();
+bool addModeExpired();
+
+// set in setup(); a trace replay swaps in REPLAY_OUTPUTS for its run
+const LockOutputs LOCK_OUTPUTS = {lockControl, armRelock, disarmRelock, portalRadio};
+const LockOutputs* outputs;
+
+// mode handling: rows are states, columns are
+// BUTTON, ADMIN_CARD, USER_CARD, UNKNOWN_CARD, TICK, HTTP_ACTIVITY
+const ModeTable MODE_TABLE = {
+    // STATE_DOOR_LOCK: cards are access decisions there, not mode events
+    {{nullptr, enterAddMode, STATE_ADD_WAIT_ADMIN},
+     stay(STATE_DOOR_LOCK),
+     stay(STATE_DOOR_LOCK),
+     stay(STATE_DOOR_LOCK),
+     stay(STATE_DOOR_LOCK),
+     stay(STATE_DOOR_LOCK)},
+    // STATE_ADD_WAIT_ADMIN
+    {{nullptr, leaveAddMode, STATE_DOOR_LOCK},
+     {nullptr, authorizeAdmin, STATE_ADD_REGISTER},
+     {nullptr, rejectUser, STATE_ADD_WAIT_ADMIN},
+     {nullptr, extendAddMode, STATE_ADD_WAIT_ADMIN},
+     {addModeExpired, expireAddMode, STATE_DOOR_LOCK},
+     stay(STATE_ADD_WAIT_ADMIN)},
+    // STATE_ADD_REGISTER
+    {{nullptr, leaveAddMode, STATE_DOOR_LOCK},
+     {nullptr, extendAddMode, STATE_ADD_REGISTER},
+     {nullptr, extendAddMode, STATE_ADD_REGISTER},
+     {nullptr, extendAddMode, STATE_ADD_REGISTER},
+     {addModeExpired, expireAddMode, STATE_DOOR_LOCK},
+     {nullptr, extendAddMode, STATE_ADD_REGISTER}},
+};
+ModeMachine mode(MODE_TABLE, STATE_DOOR_LOCK);
 
 void setup() {
   Serial.begin(115200);
@@ -61,336 +203,618 @@ void setup() {
   }
   Serial.println("FS ready");
 
-  // initialize the MFRC522 scanner
+  loadSchedules();
+  loadPerfectHash();
+  loadCredentials();
+  loadSecureConfig();
+  auditBegin();
+
+  // initialize the card readers
   SPI.begin();
-  scanner.PCD_Init();
+  for (CardReader* reader : readers) {
+    if (!reader->begin())
+      Serial.printf("%s not responding\n", reader->label);
+    reader->cadence.begin(SCAN_FAST_INTERVAL, SCAN_FAST_WINDOW, SCAN_MAX_INTERVAL);
+  }
   Serial.println("scanner ready");
 
-  pinMode(LOCK_PIN, OUTPUT);
-  digitalWrite(LOCK_PIN, LOW); // start locked
-  pinMode(MODE_BUTTON, INPUT_PULLUP);
+  actuatorBegin(LOCK_PIN, LOCK_PWM_FREQUENCY); // start locked
+  timer0_isr_init();                           // relock timer, see armRelock()
+  buttonBegin(MODE_BUTTON, BUTTON_DEBOUNCE_MS, BUTTON_LONG_PRESS_MS, BUTTON_DOUBLE_PRESS_MS);
+
+  buzzerBegin(BUZZER_PIN);
 
-  pinMode(BUZZER_PIN, OUTPUT);
-  digitalWrite(BUZZER_PIN, LOW);
+  // the radio is only needed for the registration portal
+  powerSaveBegin(MODE_BUTTON);
+  setupRoutes();
+  outputs = &LOCK_OUTPUTS;
 }
 
 void loop() {
-  if (webServerActive)
-    server.handleClient();
+  updateClock();
+  sampleHeap();
 
-  // handling MODE button press and logic
-  bool buttonState = digitalRead(MODE_BUTTON);
-  if (buttonState == LOW && lastButtonState == HIGH &&
-      millis() - lastButtonPress > MODE_DEBOUNCE_MS) {
-    lastButtonPress = millis();
-
-    if (currentMode == DOOR_LOCK_MODE) {
-      currentMode = ADD_NEW_UID_MODE;
-      addUIDStage = 0;
-      addModeStartTime = millis(); // start the timer
-      Serial.println("Switched to ADD_NEW_UID_MODE ");
-      buzzSuccess();
-    } else {
-      currentMode = DOOR_LOCK_MODE;
-      addUIDStage = 0;
-      stopWebServer();
-      Serial.println("Switched to DOOR_LOCK_MODE");
-      buzzDenied();
+  if (millis() - lastStatsPrint >= STATS_INTERVAL) {
+    lastStatsPrint = millis();
+    for (CardReader* reader : readers) {
+      reader->printStats();
+      reader->printHealth(Serial);
     }
+    printPipelineStats();
+    printPowerStats();
+    Serial.printf("mode: %s\n", ModeMachine::stateName(mode.state()));
   }
-  lastButtonState = buttonState;
 
-  // handling door lock mode logic
-  if (currentMode == DOOR_LOCK_MODE) {
-    // Auto-lock after timeout
-    if (isUnlocked && (millis() - unlockStartTime >= UNLOCK_DURATION)) {
-      lockControl(true);
-      isUnlocked = false;
-      Serial.println("Door auto-locked after timeout");
-    }
+#ifdef ENABLE_BENCH
+  const char* command = benchCommand();
+  if (command != nullptr && strcmp(command, "bench") == 0)
+    runBenchmarks(Serial, benchTap);
+  else if (command != nullptr && strcmp(command, "replay") == 0) {
+    outputs = &REPLAY_OUTPUTS; // the door, the relock timer and the radio are left alone
+    runReplay(Serial, REPLAY_HOOKS);
+    outputs = &LOCK_OUTPUTS;
+  }
+#endif
 
-    // Scan RFID tag
-    String uid = scanTag();
-    if (!uid.isEmpty()) {
-      lastScannedUID = uid;
-      Serial.printf("Scanned UID: %s\n", uid.c_str());
-
-      String name, role;
-      if (checkUID(uid, &name, &role)) {
-        Serial.printf("Access Granted to %s (%s)\n", name.c_str(), role.c_str());
-        buzzSuccess();
-        lockControl(false);
-        isUnlocked = true;
-        unlockStartTime = millis();
-      } else {
-        Serial.println("Access Denied!");
-        buzzDenied();
-        lockControl(true);
-      }
-    }
+  if (webServerActive)
+    server.handleClient();
+
+  for (CardReader* reader : readers)
+    reader->checkHealth();
+
+  handleGesture(buttonPoll());
+
+  actuatorUpdate();
+
+  // the relock timer already locked the door, catch up on the bookkeeping
+  if (relockFired)
+    finishRelock();
+
+  // card handling, one stage after the other, each with bounded work
+  readerStage();
+  decisionStage();
+  actuatorStage();
+  buzzerStage();
+  logStage();
+  if (cardQueue.empty() && logQueue.empty())
+    auditService(); // flash writes only between cards
+
+  // add timeout check
+  mode.dispatch(EVENT_TICK);
+
+  idleSleep();
+}
+
+#ifdef ENABLE_BENCH
+/**
+ * @brief Benchmark hook: one tap of a verified card at the entry reader, up to
+ * the actuator command.
+ *
+ * The command and the buzzer and log entries are dropped, so the door, the
+ * buzzer and the audit log are left alone.
+ */
+bool benchTap(const UidKey& key) {
+  replayTap(key);
+  decisionStage();
+
+  ActuatorRequest request;
+  BuzzerPattern pattern;
+  AccessRecord record;
+  bool granted = actuatorQueue.pop(&request) && request.command == ACTUATOR_UNLOCK;
+  while (buzzerQueue.pop(&pattern))
+    ;
+  while (logQueue.pop(&record))
+    ;
+  return granted;
+}
+
+// ---- trace replay hooks, see replay.h ----
+
+// the relock during a replay: armed by REPLAY_OUTPUTS, fired by replayStep()
+bool replayRelockArmed = false;
+unsigned long replayRelockAt = 0;
+
+// queues a verified card at the entry reader, as readerStage() would
+bool replayTap(const UidKey& key) {
+  CardEvent event = {};
+  event.count = 1;
+  event.verified = 0x01;
+  event.detectedUs = micros();
+  event.keys[0] = key;
+  return cardQueue.push(event);
+}
+
+/**
+ * @brief One loop() pass of the card stages, the relock and the mode timeouts
+ * at the current trace time.
+ *
+ * Buzzer and log entries are dropped, so nothing is played or written to the
+ * audit log.
+ */
+ReplayOutcome replayStep() {
+  bool card = !cardQueue.empty();
+  bool lockMode = mode.state() == STATE_DOOR_LOCK;
+  decisionStage();
+  actuatorStage();
+  if (replayRelockArmed && (long)(logicMillis() - replayRelockAt) >= 0) {
+    replayRelockArmed = false;
+    relocked(); // not finishRelock(): no timer ran, so there is no lateness to record
   }
 
-  // add New UID mode
-  else if (currentMode == ADD_NEW_UID_MODE) {
-    String uid = scanTag();
-    if (!uid.isEmpty()) {
-      lastScannedUID = uid;
-      addModeStartTime = millis();
-      if (addUIDStage == 0) {
-        // Stage 0: waiting for admin
-        String name, role;
-        if (checkUID(uid, &name, &role)) {
-          if (role == "A") {
-            Serial.println("Autohroized Admin");
-            buzzSuccess();
-            addUIDStage = 1;
-            startWebServer();
-            addModeStartTime = millis(); // reset timeout when admin verified
-          } else {
-            Serial.println("Access denied");
-            buzzDenied();
-          }
-        }
-      }
-    }
+  ReplayOutcome outcome = !card ? OUTCOME_NONE : lockMode ? OUTCOME_DENIED : OUTCOME_MODE_EVENT;
+  AccessRecord record;
+  while (logQueue.pop(&record)) {
+    if (record.reason == ACCESS_GRANTED)
+      outcome = OUTCOME_GRANTED;
   }
+  BuzzerPattern pattern;
+  while (buzzerQueue.pop(&pattern))
+    ;
 
-  // add timeout check
-  if (currentMode == ADD_NEW_UID_MODE && millis() - addModeStartTime >= ADD_MODE_TIMEOUT) {
-    currentMode = DOOR_LOCK_MODE;
-    addUIDStage = 0;
-    stopWebServer();
-    Serial.println("⚠️ Add Mode timeout reached — returning to DOOR_LOCK_MODE");
-    buzzDenied();
+  mode.dispatch(EVENT_TICK);
+  return outcome;
+}
+
+// what a /register request would do, with the card kept in RAM only
+RegisterResult replayRegister(const UidKey& key, char role) {
+  if (!webServerActive)
+    return REGISTER_MISSED;
+  if (findCredential(key) != nullptr)
+    return REGISTER_DUPLICATE;
+
+  addSyntheticCredential(key, role);
+  mode.dispatch(EVENT_HTTP_ACTIVITY);
+  return REGISTER_OK;
+}
+
+const ReplayHooks REPLAY_HOOKS = {
+    replayTap,
+    replayStep,
+    handleGesture,
+    replayRegister,
+    []() { return mode.state(); },
+    []() { return isUnlocked; },
+};
+
+// the relock runs on the trace clock, see replayStep(); the door and the portal only
+// change state
+const LockOutputs REPLAY_OUTPUTS = {
+    [](bool) {},
+    []() {
+      replayRelockArmed = true;
+      replayRelockAt = logicMillis() + UNLOCK_DURATION;
+    },
+    []() { replayRelockArmed = false; },
+    [](bool) {},
+};
+#endif
+
+/**
+ * @brief Acts on a MODE button gesture.
+ *
+ * Short press toggles add mode, long press force-locks the door, double press
+ * prints the status.
+ */
+void handleGesture(ButtonGesture gesture) {
+  if (gesture != GESTURE_NONE) {
+    for (CardReader* reader : readers)
+      reader->cadence.activity();
+  }
+  if (gesture == GESTURE_SHORT) {
+    mode.dispatch(EVENT_BUTTON);
+  } else if (gesture == GESTURE_LONG) {
+    Serial.println("Force-lock from the MODE button");
+    actuatorQueue.push({ACTUATOR_LOCK, (uint32_t)micros()});
+    buzzerQueue.push(BUZZ_DENIED);
+  } else if (gesture == GESTURE_DOUBLE) {
+    printStatus();
   }
 }
 
 /**
- * @brief Registers (saves) a new RFID UID entry to the LittleFS storage.
+ * @brief Light-sleeps until the next reader poll is due, if the door is idle.
  *
- * This function appends a new record to `/uids.txt` in CSV format: `UID,Name,Role`.
- * UID and Role parameters are cleaned and converted to uppercase for consistency.
- * The function does not perform duplicate checks; you must verify that the
- * UID does not already exist using @ref checkUID() before calling this function.
+ * Only in door lock mode with the door locked, nothing queued and the buzzer
+ * quiet: the cycle counter behind the relock timer stops while asleep. Checking
+ * isUnlocked covers the relock: it is set before armRelock() and cleared only
+ * once the timer has fired or been disarmed. The MODE
+ * button wakes the chip early. Card detection latency stays bounded by the
+ * reader cadence, since the chip never sleeps past the next due poll.
+ */
+void idleSleep() {
+  if (!IDLE_LIGHT_SLEEP || mode.state() != STATE_DOOR_LOCK || isUnlocked || relockFired ||
+      buzzerBusy() || !cardQueue.empty() || !actuatorQueue.empty() || !buzzerQueue.empty() ||
+      !logQueue.empty() || buttonBusy())
+    return;
+
+  unsigned long wait = SCAN_MAX_INTERVAL;
+  for (CardReader* reader : readers)
+    wait = min(wait, reader->cadence.untilDue());
+  if (wait < LIGHT_SLEEP_MIN_MS)
+    return;
+
+  unsigned long slept = lightSleep(wait);
+  for (CardReader* reader : readers) {
+    reader->cadence.slept(slept);
+    reader->slept(slept);
+  }
+  clockSlept(slept);
+  auditSlept(slept);
+  buttonResume(); // the wake-up setup replaced the button's edge interrupt
+}
+
+/**
+ * @brief Dumps the current state to serial: mode, door, clock and reader health.
+ */
+void printStatus() {
+  Serial.printf("mode: %s, door %s, clock %s (%lu)\n", ModeMachine::stateName(mode.state()),
+                isUnlocked ? "unlocked" : "locked", clockIsSet() ? "set" : "not set",
+                (unsigned long)clockNow());
+  Serial.printf("%u cards registered, %u in the badge image, free heap %lu\n",
+                (unsigned)credentialCount(), (unsigned)perfectHashCount(),
+                (unsigned long)ESP.getFreeHeap());
+  for (CardReader* reader : readers)
+    reader->printHealth(Serial);
+}
+
+/**
+ * @brief Polls the next due card reader and returns the packed UIDs of every card in its field.
  *
- * Example usage:
- * ```cpp
- * if (!checkUID(uid)) {
- *   registerUID(uid, name, role);
- * }
- * ```
+ * Readers are polled in turn, at most one per call, each on its own adaptive
+ * cadence, so adding a second reader does not stretch the first one's
+ * detection latency. A reader that finds a card selects every card in its field
+ * (see @ref Mfrc522Reader::readAllCards()), so a wallet holding two cards yields
+ * both UIDs instead of whichever wins anticollision.
  *
- * @param uid  The RFID card's UID string (e.g., "AA:BB:CC:DD").
- * @param name The user's name associated with the UID.
- * @param role The user's role (e.g., "A" for admin, "U" for user").
+ * @note
+ * - This function should be called repeatedly in the main loop for continuous scanning.
+ *
+ * @param event Receives the reader ID and the cards read.
  *
- * @return true  If the entry was successfully written to the file.
- * @return false If file open or write failed.
+ * @return true  If a reader found at least one card.
+ * @return false If no reader was due or the polled field was empty.
  */
-bool registerUID(String uid, String name, String role) {
-  uid.trim();
-  uid.toUpperCase();
-  name.trim();
-  role.trim();
-  role.toUpperCase();
-
-  File file = LittleFS.open("/uids.txt", "a");
-  if (!file) {
-    Serial.println("Failed to open uid file for writing");
-    return false;
+bool scanTags(CardEvent* event) {
+  for (uint8_t i = 0; i < READER_COUNT; i++) {
+    CardReader* reader = readers[(nextReader + i) % READER_COUNT];
+    if (!reader->cadence.due())
+      continue;
+
+    nextReader = (reader->id + 1) % READER_COUNT;
+    event->reader = reader->id;
+    event->count = reader->poll(event->keys, MAX_CARDS_PER_SCAN, &event->verified);
+    event->detectedUs = micros();
+    reader->cadence.polled(event->count > 0, reader->answerDueMs());
+    if (event->count > 0)
+      reader->noteRead();
+    return event->count > 0;
   }
+  return false;
+}
 
-  file.printf("%s,%s,%s\n", uid.c_str(), name.c_str(), role.c_str());
-  file.close();
+/**
+ * @brief Reader stage: polls a due reader and queues the card event for the decision stage.
+ *
+ * Readers are not polled while the decision stage is still behind, so a card
+ * is never read only to be dropped.
+ */
+void readerStage() {
+  if (cardQueue.size() == CARD_QUEUE_SIZE)
+    return;
 
-  Serial.printf("Added new UID: %s | Name: %s | Role: %s\n", uid.c_str(), name.c_str(),
-                role.c_str());
-  return true;
+  CardEvent event;
+  if (scanTags(&event))
+    cardQueue.push(event);
 }
 
 /**
- * @brief Checks if a given UID exists in the LittleFS storage.
+ * @brief Checks a scanned card against the secure card settings.
  *
- * Opens `/uids.txt`, reads it line by line, and compares the stored UIDs
- * against the provded one. If a match is found, the function can optionally
- * return the associated name and role.
+ * With secure cards enabled (see @ref loadSecureConfig()) only cards whose
+ * credential sector passed authentication count; otherwise every UID does.
  *
- * Example line in '/uids.txt':
- * ```
- * AA:BB:CC:DD,Preetom,A
- * ```
- *
- * Example usage:
- * ```cpp
- * String name, role;
- * if (checkUID("AA:BB:CC:DD", &name, &role)) {
- *   Serial.printf("Welcome %s (%s)\n", name.c_str(), role.c_str());
- * }
- * ```
- *
- * @param uid   The UID string to check (e.g., "AA:BB:CC:DD").
- * @param name  Optional pointer to a String variable to receive the user's name (nullable).
- * @param role  Optional pointer to a String variable to receive the user's role (nullable).
+ * @return true If the card may be looked up.
+ */
+bool cardAuthentic(const CardEvent& event, uint8_t index) {
+  return !secureCardsEnabled() || event.verified & (1 << index);
+}
+
+/**
+ * @brief Decision stage: takes one card event and turns it into commands.
  *
- * @return true  If the UID was found.
- * @return false If the UID was not found or file read failed.
+ * In door mode access is granted if any card in the field is authorized. The
+ * actuator command is queued first, then the buzzer, then one log record per
+ * card examined, so the door opens before anything slow (name lookups, serial
+ * output) happens.
  */
-bool checkUID(String uid, String* name = nullptr, String* role = nullptr) {
-  uid.trim();
-  uid.toUpperCase();
+void decisionStage() {
+  CardEvent event;
+  if (!cardQueue.pop(&event))
+    return;
+  decisionLatency.record(event.detectedUs);
 
-  if (!LittleFS.exists("/uids.txt")) {
-    Serial.println("No UID file found.");
-    return false;
+  if (mode.state() != STATE_DOOR_LOCK) {
+    handleAddModeCard(event);
+    return;
   }
 
-  File file = LittleFS.open("/uids.txt", "r");
-  if (!file) {
-    Serial.println("Failed to open uid file for reading");
-    return false;
+  AccessRecord records[MAX_CARDS_PER_SCAN];
+  uint8_t recordCount = 0;
+  bool granted = false;
+  for (uint8_t i = 0; i < event.count && !granted; i++) {
+    AccessRecord& record = records[recordCount++];
+    record = {event.detectedUs, event.keys[i], {}, event.reader, DENIED_UNKNOWN, false};
+
+    bool authentic = cardAuthentic(event, i);
+    const Credential* cred = authentic ? findCredential(event.keys[i]) : nullptr;
+    if (!authentic)
+      record.reason = DENIED_AUTH;
+    else if (cred == nullptr)
+      record.reason = DENIED_UNKNOWN;
+    else if (!scheduleAllows(event.keys[i], *cred))
+      record.reason = DENIED_SCHEDULE;
+    else
+      record.reason = ACCESS_GRANTED;
+
+    if (cred != nullptr)
+      record.cred = *cred;
+    granted = record.reason == ACCESS_GRANTED;
   }
+  records[recordCount - 1].lastOfEvent = true;
 
-  // search for the UID line by line
-  while (file.available()) {
-    String line = file.readStringUntil('\n');
-    line.trim();
+  actuatorQueue.push({granted ? ACTUATOR_UNLOCK : ACTUATOR_LOCK, event.detectedUs});
+  buzzerQueue.push(granted ? BUZZ_SUCCESS : BUZZ_DENIED);
+  for (uint8_t i = 0; i < recordCount; i++)
+    logQueue.push(records[i]);
+}
 
-    if (line.isEmpty())
-      continue;
+/**
+ * @brief Add mode: shows the scanned UID and turns the cards into a mode event.
+ *
+ * Any admin card in the field counts as an admin card.
+ */
+void handleAddModeCard(const CardEvent& event) {
+  char uidText[UID_TEXT_SIZE];
+  uint8_t length = formatUidKey(event.keys[0], uidText);
+  memcpy(lastScannedUID, uidText, length + 1);
+  if (event.count > 1)
+    Serial.printf("%u cards in the field, showing %s\n", event.count, uidText);
 
-    // parse the csv line: UID,Name,Role
-    int firstComma = line.indexOf(',');
-    int secondComma = line.lastIndexOf(',');
+  bool known = false;
+  bool admin = false;
+  for (uint8_t i = 0; i < event.count; i++) {
+    const Credential* cred = findCredential(event.keys[i]);
+    known |= cred != nullptr;
+    admin |= cred != nullptr && cred->role == 'A' && cardAuthentic(event, i);
+  }
+  mode.dispatch(admin ? EVENT_ADMIN_CARD : known ? EVENT_USER_CARD : EVENT_UNKNOWN_CARD);
+}
 
-    if (firstComma == -1 || secondComma == -1 || firstComma == secondComma)
-      continue;
+// ---- mode actions and guards, see MODE_TABLE ----
+
+void enterAddMode() {
+  addModeStartTime = logicMillis(); // start the timer
+  Serial.println("Switched to ADD_NEW_UID_MODE ");
+  buzzerQueue.push(BUZZ_SUCCESS);
+}
+
+void leaveAddMode() {
+  stopWebServer();
+  Serial.println("Switched to DOOR_LOCK_MODE");
+  buzzerQueue.push(BUZZ_DENIED);
+}
+
+void expireAddMode() {
+  stopWebServer();
+  Serial.println("⚠️ Add Mode timeout reached — returning to DOOR_LOCK_MODE");
+  buzzerQueue.push(BUZZ_DENIED);
+}
+
+void authorizeAdmin() {
+  Serial.println("Autohroized Admin");
+  buzzerQueue.push(BUZZ_SUCCESS);
+  startWebServer();
+  addModeStartTime = logicMillis(); // reset timeout when admin verified
+}
 
-    String storedUID = line.substring(0, firstComma);
-    storedUID.trim();
-    storedUID.toUpperCase();
+void rejectUser() {
+  Serial.println("Access denied");
+  buzzerQueue.push(BUZZ_DENIED);
+  addModeStartTime = logicMillis();
+}
 
-    // checking if UID exists
-    if (storedUID == uid) {
-      if (name != nullptr)
-        *name = line.substring(firstComma + 1, secondComma);
-      if (role != nullptr)
-        *role = line.substring(secondComma + 1);
+// any card or portal activity keeps add mode alive
+void extendAddMode() {
+  addModeStartTime = logicMillis();
+}
+
+bool addModeExpired() {
+  return logicMillis() - addModeStartTime >= ADD_MODE_TIMEOUT;
+}
 
-      file.close();
-      Serial.println("UID found");
-      return true;
+/**
+ * @brief Actuator stage: applies every queued lock command; each is a single pin write.
+ */
+void actuatorStage() {
+  ActuatorRequest request;
+  while (actuatorQueue.pop(&request)) {
+    if (request.command == ACTUATOR_UNLOCK) {
+      outputs->disarmRelock(); // a card during the window restarts it
+      outputs->door(false);
+      isUnlocked = true;
+      relockFired = false;
+      unlockStartUs = micros();
+      outputs->armRelock();
+    } else {
+      outputs->disarmRelock();
+      relockFired = false;
+      outputs->door(true);
+      isUnlocked = false;
     }
+    actuationLatency.record(request.detectedUs);
   }
+}
 
-  file.close();
-  Serial.println("UID not found");
-  return false;
+/**
+ * @brief Buzzer stage: advances the playing pattern and starts the next queued one.
+ */
+void buzzerStage() {
+  buzzerUpdate();
+
+  BuzzerPattern pattern;
+  if (!buzzerBusy() && buzzerQueue.pop(&pattern))
+    buzzerPlay(pattern);
 }
 
 /**
- * @brief Scans for an RFID tag and returns its UID as a formatted string.
- *
- * This function checks if a new RFID tag is present using the MFRC522 scanner.
- * If a card is detected, it reads the card's serial number (UID) byte-by-byte
- * and converts it to a human-readable hexadecimal string format such as:
- * `AA:BB:CC:DD` or `04:3A:7F:92` depending on card type.
- *
- * @note
- * - If no tag is detected, an empty string is returned (`""`).
- *
- * - This function should be called repeatedly in the main loop for continuous scanning.
+ * @brief Log stage: writes at most one access record per loop() pass.
  *
- * @return String UID of the detected RFID tag (e.g., "AA:BB:CC:DD"), or an empty string if none.
+ * Names are read from flash here, after the door has already been actuated.
  */
-String scanTag() {
-  if (!scanner.PICC_IsNewCardPresent() || !scanner.PICC_ReadCardSerial())
-    return "";
-
-  // constructing the UID string from the bytes of the card
-  String uidString = "";
-  for (byte i = 0; i < scanner.uid.size; i++) {
-    // add leading zero if the byte < 0x10 (ensuring 2-digit formatting)
-    if (scanner.uid.uidByte[i] < 0x10)
-      uidString += "0";
-
-    // convert byte to hexadecimal and append
-    uidString += String(scanner.uid.uidByte[i], HEX);
-
-    // adding ':' separator except after the last byte
-    if (i < scanner.uid.size - 1)
-      uidString += ":";
-  }
+void logStage() {
+  AccessRecord record;
+  if (!logQueue.pop(&record))
+    return;
 
-  uidString.toUpperCase();
+  static char uidText[UID_TEXT_SIZE];
+  static char name[CSV_MAX_LINE];
+  formatUidKey(record.uid, uidText);
+  Serial.printf("Scanned UID: %s at %s\n", uidText, readers[record.reader]->label);
 
-  // Halt communication with the card and stop encryption
-  scanner.PICC_HaltA();
-  scanner.PCD_StopCrypto1();
+  switch (record.reason) {
+  case ACCESS_GRANTED:
+    credentialName(record.cred, name);
+    Serial.printf("Access Granted to %s (%c)\n", name, (char)record.cred.role);
+    break;
+  case DENIED_SCHEDULE:
+    credentialName(record.cred, name);
+    Serial.printf("%s (%c) is outside their schedule\n", name, (char)record.cred.role);
+    break;
+  case DENIED_AUTH:
+    Serial.printf("%s failed card authentication\n", uidText);
+    break;
+  case DENIED_UNKNOWN:
+    break;
+  }
 
-  return uidString;
+  if (record.lastOfEvent && record.reason != ACCESS_GRANTED)
+    Serial.println("Access Denied!");
+  auditAppend(record.uid, record.reader, record.reason);
+  logLatency.record(record.detectedUs);
 }
 
 /**
- * @brief Starts the Access Point and web server for the UID registration
+ * @brief Prints per-stage latency and queue drops since the last call.
  */
-void startWebServer() {
-  if (webServerActive)
-    return;
+void printPipelineStats() {
+  Serial.println("pipeline:");
+  decisionLatency.print("decision");
+  actuationLatency.print("actuator");
+  logLatency.print("log");
+  if (relockCount > 0)
+    Serial.printf("  relock: %lu x, avg %lu us late, worst %lu us late\n",
+                  (unsigned long)relockCount, (unsigned long)(relockLateTotal / relockCount),
+                  (unsigned long)relockLateWorst);
+  relockCount = 0;
+  relockLateTotal = 0;
+  relockLateWorst = 0;
+  Serial.printf("  dropped: %lu card events, %lu buzzer, %lu log records, %lu audit records\n",
+                (unsigned long)cardQueue.dropped(), (unsigned long)buzzerQueue.dropped(),
+                (unsigned long)logQueue.dropped(), (unsigned long)auditDropped());
+}
 
-  WiFi.softAP(ssid, password);
-  Serial.printf("Started AP with SSID: %s, Password: %s \n", ssid, password);
-  Serial.printf("IP address: %s \n", WiFi.softAPIP().toString().c_str());
-
-  // Serve main HTML page
-  server.on("/", HTTP_GET, []() {
-    String html = R"rawliteral(
-    <!DOCTYPE html>
-    <html>
-    <head>
-      <title>RFID Registration</title>
-      <meta charset="UTF-8">
-      <meta name="viewport" content="width=device-width, initial-scale=1">
-      <style>
-        body { font-family: Arial; text-align: center; margin-top: 40px; }
-        input { padding: 10px; margin: 5px; width: 80%%; max-width: 300px; }
-        button { padding: 10px 20px; margin-top: 15px; }
-        .uid { font-weight: bold; color: #0077cc; }
-      </style>
-      <script>
-        async function updateUID() {
-          const res = await fetch('/getuid');
-          const uid = await res.text();
-          document.getElementById('uid').value = uid || '';
-          document.getElementById('uidDisplay').innerText = uid || 'No card detected';
-        }
-        setInterval(updateUID, 1000); // auto refresh UID every second
-      </script>
-    </head>
-    <body>
-      <h2>RFID UID Registration</h2>
-      <p>Scanned UID: <span id="uidDisplay" class="uid">Waiting...</span></p>
-      <form action="/register" method="POST">
-        <input type="text" id="uid" name="uid" placeholder="UID" readonly><br>
-        <input type="text" name="name" placeholder="Enter Name" required><br>
-        <input type="text" name="role" placeholder="Enter Role (A/U)" required><br>
-        <button type="submit">Register</button>
-      </form>
-    </body>
-    </html>
-    )rawliteral";
-    server.send(200, "text/html", html);
-  });
+// registration portal page, served from flash
+static const char INDEX_HTML[] PROGMEM = R"rawliteral(
+<!DOCTYPE html>
+<html>
+<head>
+  <title>RFID Registration</title>
+  <meta charset="UTF-8">
+  <meta name="viewport" content="width=device-width, initial-scale=1">
+  <style>
+    body { font-family: Arial; text-align: center; margin-top: 40px; }
+    input { padding: 10px; margin: 5px; width: 80%; max-width: 300px; }
+    button { padding: 10px 20px; margin-top: 15px; }
+    .uid { font-weight: bold; color: #0077cc; }
+  </style>
+  <script>
+    async function updateUID() {
+      const res = await fetch('/getuid');
+      const uid = await res.text();
+      document.getElementById('uid').value = uid || '';
+      document.getElementById('provisionUid').value = uid || '';
+      document.getElementById('uidDisplay').innerText = uid || 'No card detected';
+    }
+    setInterval(updateUID, 1000); // auto refresh UID every second
+
+    // the lock has no RTC: hand it the browser's local time whenever the portal is opened
+    const now = new Date();
+    fetch('/settime', {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+      body: 'epoch=' + Math.floor(now.getTime() / 1000 - now.getTimezoneOffset() * 60)
+    });
+  </script>
+</head>
+<body>
+  <h2>RFID UID Registration</h2>
+  <p>Scanned UID: <span id="uidDisplay" class="uid">Waiting...</span></p>
+  <form action="/register" method="POST">
+    <input type="text" id="uid" name="uid" placeholder="UID" readonly><br>
+    <input type="text" name="name" placeholder="Enter Name" required><br>
+    <input type="text" name="role" placeholder="Enter Role (A/U)" required><br>
+    <button type="submit">Register</button>
+  </form>
+  <form action="/provision" method="POST">
+    <input type="hidden" id="provisionUid" name="uid">
+    <button type="submit">Write Secure Block</button>
+  </form>
+  <p>
+    <a href="/export">Export registered cards</a> |
+    <a href="/audit">Download access log</a>
+  </p>
+  <h2>Access Schedules</h2>
+  <p>One window per line: KEY,DAYS,HH:MM-HH:MM (e.g. U,MTWTF--,08:00-18:00)</p>
+  <form action="/schedules" method="POST">
+    <textarea name="rules" rows="6" cols="40" id="rules"></textarea><br>
+    <button type="submit">Save Schedules</button>
+  </form>
+  <script>
+    fetch('/schedules').then(res => res.text()).then(text => {
+      document.getElementById('rules').value = text;
+    });
+  </script>
+</body>
+</html>
+)rawliteral";
+
+/**
+ * @brief Registers the portal routes, once at boot.
+ *
+ * Registering them on every @ref startWebServer() would add a second copy of
+ * every handler (and its heap) each time add mode is entered.
+ */
+void setupRoutes() {
+  // Serve main HTML page straight from flash
+  meteredOn(server, "/", HTTP_GET, []() { server.send_P(200, "text/html", INDEX_HTML); });
 
   // for fetching UIDs
-  server.on("/getuid", HTTP_GET, []() { server.send(200, "text/plain", lastScannedUID); });
+  meteredOn(server, "/getuid", HTTP_GET,
+            []() { server.send(200, "text/plain", lastScannedUID); });
 
   // handle form submission
-  server.on("/register", HTTP_POST, []() {
-    String uid = server.arg("uid");
-    String name = server.arg("name");
-    String role = server.arg("role");
+  meteredOn(server, "/register", HTTP_POST, []() {
+    // the library holds the form as heap Strings; registerUID() trims in place, so it gets
+    // editable copies, released with the arena after the request
+    const char* uid = arenaCopy(server.arg("uid").c_str());
+    char* name = arenaCopy(server.arg("name").c_str());
+    char* role = arenaCopy(server.arg("role").c_str());
+    if (uid == nullptr || name == nullptr || role == nullptr) {
+      server.send(413, "text/plain", "Request too large!");
+      return;
+    }
 
-    if (uid.isEmpty()) {
+    if (uid[0] == '\0') {
       server.send(400, "text/plain", "No UID scanned!");
       return;
     }
@@ -402,17 +826,131 @@ void startWebServer() {
 
     if (registerUID(uid, name, role)) {
       server.send(200, "text/plain", "UID registered successfully!");
-      Serial.printf("New UID registered via web: %s | %s | %s\n", uid.c_str(), name.c_str(),
-                    role.c_str());
-      addModeStartTime = millis(); // reset timeout on successful UID addition
+      Serial.printf("New UID registered via web: %s | %s | %s\n", uid, name, role);
+      mode.dispatch(EVENT_HTTP_ACTIVITY); // reset timeout on successful UID addition
     } else {
       server.send(500, "text/plain", "Failed to save UID!");
     }
   });
 
-  server.begin();
+  // download the registered cards as cleaned-up CSV, streamed line by line
+  meteredOn(server, "/export", HTTP_GET, []() {
+    File file = LittleFS.open("/uids.txt", "r");
+    if (!file) {
+      server.send(404, "text/plain", "No UID file found.");
+      return;
+    }
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", "");
+
+    CsvReader reader(file);
+    char line[CSV_MAX_LINE + 2];
+    while (reader.next()) {
+      UidKey key;
+      if (reader.fieldCount() != 3 || !parseUidKey(reader.field(0), &key))
+        continue;
+      int length = snprintf(line, sizeof(line), "%s,%s,%s\n", reader.field(0), reader.field(1),
+                            reader.field(2));
+      server.sendContent(line, min<size_t>(length, sizeof(line) - 1));
+    }
+    file.close();
+    server.sendContent("");
+  });
+
+  // write the credential block to the scanned card the next time the entry reader sees it
+  meteredOn(server, "/provision", HTTP_POST, []() {
+    UidKey key;
+    if (!secureCardsEnabled()) {
+      server.send(400, "text/plain", "Secure cards are not configured!");
+      return;
+    }
+    if (!parseUidKey(server.arg("uid").c_str(), &key)) {
+      server.send(400, "text/plain", "No UID scanned!");
+      return;
+    }
+
+    requestProvisioning(key);
+    server.send(200, "text/plain", "Hold the card on the entry reader to write its secure block");
+    mode.dispatch(EVENT_HTTP_ACTIVITY);
+  });
+
+  // access audit log as CSV, optionally limited to a time range (epoch seconds, inclusive)
+  meteredOn(server, "/audit", HTTP_GET, []() {
+    uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), nullptr, 10) : 0;
+    uint32_t to =
+        server.hasArg("to") ? strtoul(server.arg("to").c_str(), nullptr, 10) : UINT32_MAX;
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", "");
+    auditStream(from, to,
+                [](const char* line, size_t length) { server.sendContent(line, length); });
+    server.sendContent("");
+  });
+
+  // per-route request metrics and heap gauges, Prometheus text format
+  meteredOn(server, "/metrics", HTTP_GET, []() {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain; version=0.0.4", "");
+    writeMetrics([](const char* line, size_t length) { server.sendContent(line, length); });
+    server.sendContent("");
+  });
+
+  // reader health: state, re-init count and time since the last card read
+  meteredOn(server, "/health", HTTP_GET, []() {
+    ArenaPrint body(REQUEST_ARENA_SIZE / 2);
+    for (CardReader* reader : readers)
+      reader->printHealth(body);
+    server.send(200, "text/plain", body.c_str());
+  });
+
+  // set the wall clock used by access schedules
+  meteredOn(server, "/settime", HTTP_POST, []() {
+    const String& epoch = server.arg("epoch");
+    if (epoch.isEmpty()) {
+      server.send(400, "text/plain", "No time given!");
+      return;
+    }
+
+    setClock(strtoul(epoch.c_str(), nullptr, 10));
+    server.send(200, "text/plain", "Clock set");
+  });
+
+  // view and replace the access schedule rules
+  meteredOn(server, "/schedules", HTTP_GET, []() {
+    File file = LittleFS.open("/schedules.txt", "r");
+    if (!file) {
+      server.send(200, "text/plain", "");
+      return;
+    }
+    server.streamFile(file, "text/plain");
+    file.close();
+  });
+
+  meteredOn(server, "/schedules", HTTP_POST, []() {
+    File file = LittleFS.open("/schedules.txt", "w");
+    if (!file) {
+      server.send(500, "text/plain", "Failed to save schedules!");
+      return;
+    }
+    file.print(server.arg("rules"));
+    file.close();
+
+    loadSchedules();
+    refreshCredentialFlags();
+    server.send(200, "text/plain", "Schedules saved");
+    mode.dispatch(EVENT_HTTP_ACTIVITY);
+  });
+}
+
+/**
+ * @brief Starts the Access Point and web server for the UID registration
+ */
+void startWebServer() {
+  if (webServerActive)
+    return;
+  outputs->portal(true);
   webServerActive = true;
-  Serial.println("Web server started");
 }
 
 /**
@@ -421,41 +959,101 @@ void startWebServer() {
 void stopWebServer() {
   if (!webServerActive)
     return;
-
-  server.stop();
-  WiFi.softAPdisconnect(true);
+  outputs->portal(false);
   webServerActive = false;
+}
 
-  Serial.println("Web server stopped");
+/**
+ * @brief Brings the radio, the Access Point and the web server up or down.
+ */
+void portalRadio(bool on) {
+  if (on) {
+    wifiRadioOn();
+    WiFi.softAP(ssid, password);
+    Serial.printf("Started AP with SSID: %s, Password: %s \n", ssid, password);
+    Serial.printf("IP address: %s \n", WiFi.softAPIP().toString().c_str());
+    server.begin();
+    Serial.println("Web server started");
+  } else {
+    server.stop();
+    WiFi.softAPdisconnect(true);
+    wifiRadioOff();
+    Serial.println("Web server stopped");
+  }
 }
 
 /**
  * @brief Controls the linear actuator connected via TIP120 transistor.
  *
- * @param locked true to engage lock (LOW), false to unlock (HIGH)
+ * @param locked true to engage lock (actuator off), false to unlock (driven
+ *               through @ref UNLOCK_PROFILE)
  */
 void lockControl(bool locked) {
   if (locked) {
-    digitalWrite(LOCK_PIN, LOW); // actuator off
+    actuatorRelease();
     Serial.println("🔒 Door Locked");
   } else {
-    digitalWrite(LOCK_PIN, HIGH); // actuator active
+    actuatorEngage(UNLOCK_PROFILE, sizeof(UNLOCK_PROFILE) / sizeof(UNLOCK_PROFILE[0]));
     Serial.println("🔓 Door Unlocked");
   }
 }
 
-void buzzSuccess() {
-  tone(BUZZER_PIN, 1000, 100);
-  delay(100);
-  tone(BUZZER_PIN, 1500, 150);
-  delay(100);
-  noTone(BUZZER_PIN);
+/**
+ * @brief Starts the relock timer for a fresh unlock window.
+ */
+void armRelock() {
+  // timer0 compares against the CPU cycle counter, which wraps after 53 s at 80 MHz
+  timer0_attachInterrupt(relockIsr);
+  timer0_write(ESP.getCycleCount() + UNLOCK_DURATION * 1000UL * clockCyclesPerMicrosecond());
+}
+
+void disarmRelock() {
+  timer0_detachInterrupt();
 }
 
-void buzzDenied() {
-  for (int i = 0; i < 2; i++) {
-    tone(BUZZER_PIN, 400, 120);
-    delay(120);
-  }
-  noTone(BUZZER_PIN);
-}
\ No newline at end of file
+/**
+ * @brief timer0 interrupt: fires once, at the end of the unlock window.
+ *
+ * A hardware compare interrupt preempts whatever loop() is doing, including a
+ * slow HTTP client or a blocking SDK call, which the SDK timer task behind
+ * Ticker had to wait for.
+ */
+void IRAM_ATTR relockIsr() {
+  timer0_detachInterrupt();
+  relockCallback();
+}
+
+/**
+ * @brief Locks the door the moment the unlock window ends.
+ *
+ * Runs in interrupt context, so only the pin is touched here; the bookkeeping
+ * happens in @ref finishRelock().
+ */
+void IRAM_ATTR relockCallback() {
+  actuatorRelease();
+  relockFiredUs = micros();
+  relockFired = true;
+}
+
+// the door is locked again
+void relocked() {
+  relockFired = false;
+  isUnlocked = false;
+}
+
+/**
+ * @brief Loop-side half of the relock: updates state and records how late the timer ran.
+ */
+void finishRelock() {
+  relocked();
+
+  uint32_t late = relockFiredUs - unlockStartUs - UNLOCK_DURATION * 1000UL;
+  if ((int32_t)late < 0)
+    late = 0;
+  relockCount++;
+  relockLateTotal += late;
+  if (late > relockLateWorst)
+    relockLateWorst = late;
+
+  Serial.println("🔒 Door auto-locked after timeout");
+}
@@ -0,0 +1,33 @@
+#include "modefsm.h"
+
+/**
+ * @brief Feeds one event to the machine.
+ *
+ * @return true  If a transition was taken (possibly back into the same state).
+ * @return false If the state ignores the event or its guard refused it.
+ */
+bool ModeMachine::dispatch(ModeEvent event) {
+  const ModeTransition& transition = table[current][event];
+  if (transition.action == nullptr && transition.next == current)
+    return false;
+  if (transition.guard != nullptr && !transition.guard())
+    return false;
+
+  current = transition.next;
+  if (transition.action != nullptr)
+    transition.action();
+  return true;
+}
+
+const char* ModeMachine::stateName(SystemState state) {
+  switch (state) {
+  case STATE_DOOR_LOCK:
+    return "door lock";
+  case STATE_ADD_WAIT_ADMIN:
+    return "add mode, waiting for admin";
+  case STATE_ADD_REGISTER:
+    return "add mode, registering";
+  default:
+    return "?";
+  }
+}
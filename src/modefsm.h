@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum SystemState : uint8_t {
+  STATE_DOOR_LOCK,      // normal operation, cards open the door
+  STATE_ADD_WAIT_ADMIN, // add mode, waiting for an admin card
+  STATE_ADD_REGISTER,   // add mode, portal open for registration
+  STATE_COUNT
+};
+
+enum ModeEvent : uint8_t {
+  EVENT_BUTTON,
+  EVENT_ADMIN_CARD,    // an authentic admin card was read
+  EVENT_USER_CARD,     // a registered non-admin card was read
+  EVENT_UNKNOWN_CARD,  // an unregistered card was read
+  EVENT_TICK,          // once per loop() pass, for timeouts
+  EVENT_HTTP_ACTIVITY, // the portal saved something
+  EVENT_COUNT
+};
+
+/**
+ * One cell of a transition table. The transition is taken if `guard` is null
+ * or returns true: the state becomes `next`, then `action` runs (if any).
+ */
+struct ModeTransition {
+  bool (*guard)();
+  void (*action)();
+  SystemState next;
+};
+
+typedef ModeTransition ModeTable[STATE_COUNT][EVENT_COUNT];
+
+// a cell that ignores the event
+constexpr ModeTransition stay(SystemState state) {
+  return {nullptr, nullptr, state};
+}
+
+/**
+ * Finite state machine driven by a constant transition table: dispatching an
+ * event is one table lookup, and events a state does not list are ignored.
+ */
+class ModeMachine {
+public:
+  ModeMachine(const ModeTable& table, SystemState initial) : table(table), current(initial) {}
+
+  bool dispatch(ModeEvent event);
+
+  SystemState state() const {
+    return current;
+  }
+
+  static const char* stateName(SystemState state);
+
+private:
+  const ModeTable& table;
+  SystemState current;
+};
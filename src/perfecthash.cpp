@@ -0,0 +1,137 @@
+#include "perfecthash.h"
+
+#include <LittleFS.h>
+#include <vector>
+
+#include "schedule.h"
+
+// on-flash layout is documented in tools/mkphf.py
+const uint32_t PHF_MAGIC = 0x31464850; // "PHF1"
+const size_t PHF_HEADER_SIZE = 20;
+const size_t PHF_SLOT_SIZE = 16;
+
+// only the displacements stay in RAM; slots are read from the open image per lookup
+static std::vector<uint16_t> displacements;
+static File image;
+static uint32_t slotCount = 0;
+static uint32_t hashSeed = 0;
+static uint32_t namesOffset = 0;
+static Credential found; // the last slot read, returned by findInPerfectHash()
+
+static uint32_t readLE32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Loads the offline-built perfect hash image `/creds.phf`, if present.
+ *
+ * The image holds a centrally issued card list built with `tools/mkphf.py`.
+ * Cards registered locally through the portal stay in `/uids.txt` and are
+ * looked up there whenever the image has no entry for a UID.
+ *
+ * Only the bucket displacements (2 bytes per 4 cards) are loaded; the file stays
+ * open and each lookup reads its one 16-byte slot from flash.
+ *
+ * @return true  If the image was loaded or there is none.
+ * @return false If the image is unreadable or malformed (it is then ignored).
+ */
+bool loadPerfectHash() {
+  displacements.clear();
+  displacements.shrink_to_fit();
+  image.close();
+  slotCount = 0;
+
+  if (!LittleFS.exists("/creds.phf"))
+    return true;
+
+  File file = LittleFS.open("/creds.phf", "r");
+  if (!file) {
+    Serial.println("Failed to open perfect hash image");
+    return false;
+  }
+
+  uint8_t header[PHF_HEADER_SIZE];
+  if (file.read(header, sizeof(header)) != sizeof(header) || readLE32(header) != PHF_MAGIC) {
+    file.close();
+    Serial.println("Perfect hash image is not valid, ignoring it");
+    return false;
+  }
+
+  uint32_t count = readLE32(header + 4);
+  uint32_t bucketCount = readLE32(header + 8);
+  hashSeed = readLE32(header + 12);
+  namesOffset = readLE32(header + 16);
+
+  if (bucketCount == 0 ||
+      namesOffset != PHF_HEADER_SIZE + 2 * bucketCount + PHF_SLOT_SIZE * count ||
+      namesOffset > file.size()) {
+    file.close();
+    Serial.println("Perfect hash image is truncated, ignoring it");
+    return false;
+  }
+
+  if (bucketCount * sizeof(uint16_t) > ESP.getMaxFreeBlockSize()) {
+    file.close();
+    Serial.printf("Perfect hash image needs %u bytes of RAM, only %u free, ignoring it\n",
+                  (unsigned)(bucketCount * sizeof(uint16_t)),
+                  (unsigned)ESP.getMaxFreeBlockSize());
+    return false;
+  }
+
+  displacements.resize(bucketCount);
+  uint8_t raw[2];
+  for (uint32_t i = 0; i < bucketCount; i++) {
+    file.read(raw, 2);
+    displacements[i] = raw[0] | (raw[1] << 8);
+  }
+
+  image = file;
+  slotCount = count;
+  Serial.printf("Loaded perfect hash image: %u cards, %u bytes of RAM\n", (unsigned)count,
+                (unsigned)(bucketCount * sizeof(uint16_t)));
+  return true;
+}
+
+/**
+ * @brief Looks a UID up in the perfect hash image.
+ *
+ * Two hashes pick the only slot the UID can be in; that one slot is read from
+ * flash and one compare confirms it, so the cost is the same for hits and
+ * misses and does not grow with the list.
+ *
+ * @return const Credential* The matching entry, valid until the next lookup,
+ *                           or nullptr if the UID is not in the image.
+ */
+const Credential* findInPerfectHash(const UidKey& uid) {
+  if (slotCount == 0)
+    return nullptr;
+
+  uint16_t displacement = displacements[uidKeyHash(uid, hashSeed) % displacements.size()];
+  uint32_t slot = uidKeyHash(uid, hashSeed + displacement + 1) % slotCount;
+
+  uint8_t raw[PHF_SLOT_SIZE];
+  if (!image.seek(PHF_HEADER_SIZE + 2 * displacements.size() + PHF_SLOT_SIZE * slot) ||
+      image.read(raw, sizeof(raw)) != sizeof(raw))
+    return nullptr;
+
+  uint8_t bytes[UID_MAX_BYTES];
+  uidKeyBytes(uid, bytes);
+  if (raw[10] != uidKeyLength(uid) || memcmp(raw, bytes, raw[10]) != 0)
+    return nullptr;
+
+  found.role = raw[11];
+  found.nameOffset = readLE32(raw + 12);
+  found.flags = CRED_FROM_IMAGE | (hasUserSchedule(uid) ? CRED_OWN_SCHEDULE : 0);
+  return &found;
+}
+
+/**
+ * @brief File offset of the image's name section; card name offsets are relative to it.
+ */
+uint32_t perfectHashNamesOffset() {
+  return namesOffset;
+}
+
+size_t perfectHashCount() {
+  return slotCount;
+}
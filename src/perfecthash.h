@@ -0,0 +1,11 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "credstore.h"
+#include "uidkey.h"
+
+bool loadPerfectHash();
+const Credential* findInPerfectHash(const UidKey& uid);
+uint32_t perfectHashNamesOffset();
+size_t perfectHashCount();
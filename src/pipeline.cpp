@@ -0,0 +1,20 @@
+#include "pipeline.h"
+
+void StageLatency::record(uint32_t detectedUs) {
+  uint32_t us = micros() - detectedUs;
+  count++;
+  total += us;
+  if (us > worst)
+    worst = us;
+}
+
+/**
+ * @brief Prints the latency since the last call, then resets it.
+ */
+void StageLatency::print(const char* stage) {
+  if (count == 0)
+    return;
+  Serial.printf("  card to %s: %lu x, avg %lu us, worst %lu us\n", stage, (unsigned long)count,
+                (unsigned long)(total / count), (unsigned long)worst);
+  *this = {};
+}
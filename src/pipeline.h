@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "credstore.h"
+#include "uidkey.h"
+
+// Commands and records passed between the loop() stages:
+// reader -> decision -> actuator / buzzer / log.
+
+enum ActuatorCommand : uint8_t { ACTUATOR_LOCK, ACTUATOR_UNLOCK };
+
+struct ActuatorRequest {
+  ActuatorCommand command;
+  uint32_t detectedUs; // micros() when the card was read
+};
+
+enum AccessReason : uint8_t { ACCESS_GRANTED, DENIED_UNKNOWN, DENIED_SCHEDULE, DENIED_AUTH };
+
+// the outcome for one card of a card event
+struct AccessRecord {
+  uint32_t detectedUs;
+  UidKey uid;
+  Credential cred; // valid unless DENIED_UNKNOWN or DENIED_AUTH
+  uint8_t reader;
+  AccessReason reason;
+  bool lastOfEvent;
+};
+
+/**
+ * Latency from card detection to the moment a stage handled it.
+ */
+struct StageLatency {
+  uint32_t count;
+  uint32_t total;
+  uint32_t worst;
+
+  void record(uint32_t detectedUs);
+  void print(const char* stage);
+};
@@ -0,0 +1,154 @@
+#include "pn532reader.h"
+
+// With one passive activation retry the PN532 gives up on an empty field after a
+// few ms, so the follow-up poll usually finds the answer waiting; the timeout only
+// guards against a reader that stops answering.
+const uint8_t PN532_ACTIVATION_RETRIES = 0x01;
+const unsigned long PN532_ANSWER_MS = 5;
+const unsigned long PN532_ANSWER_TIMEOUT_MS = 20;
+
+// SPI status read: the PN532 answers 0x01 once a response is waiting (UM0701-02, 6.2.5)
+const uint8_t PN532_SPI_STATREAD = 0x02;
+const uint8_t PN532_SPI_READY = 0x01;
+const uint32_t PN532_SPI_CLOCK = 1000000UL; // what Adafruit-PN532 runs the bus at
+
+Pn532Reader::Pn532Reader(uint8_t id, const char* label, uint8_t ssPin)
+    : CardReader(id, label), nfc(ssPin), chipSelect(ssPin) {}
+
+// initStep() stages, one PN532 command each
+enum InitStage : uint8_t {
+  STAGE_WAKE,
+  STAGE_VERSION,
+  STAGE_CONFIGURE,
+};
+
+/**
+ * @brief Runs the next step of bringing the PN532 up: wake it, check its
+ * firmware version, then configure short passive polls.
+ *
+ * @return INIT_DONE   Once the PN532 is configured.
+ * @return INIT_FAILED If no PN532 was found.
+ */
+InitProgress Pn532Reader::initStep(bool first) {
+  if (first)
+    initStage = STAGE_WAKE;
+
+  switch (initStage) {
+  case STAGE_WAKE:
+    listing = false; // the PN532 drops a running command when woken
+    nfc.begin();
+    initStage = STAGE_VERSION;
+    return INIT_PENDING;
+
+  case STAGE_VERSION: {
+    uint32_t version = nfc.getFirmwareVersion();
+    if (version == 0) {
+      Serial.printf("%s: no PN532 found\n", label);
+      return INIT_FAILED;
+    }
+    Serial.printf("%s: PN5%02X firmware %u.%u\n", label, (unsigned)(version >> 24) & 0xFF,
+                  (unsigned)(version >> 16) & 0xFF, (unsigned)(version >> 8) & 0xFF);
+    initStage = STAGE_CONFIGURE;
+    return INIT_PENDING;
+  }
+
+  default:
+    nfc.SAMConfig();
+    nfc.setPassiveActivationRetries(PN532_ACTIVATION_RETRIES);
+    return INIT_DONE;
+  }
+}
+
+// a running list that is not overdue shows the PN532 acknowledged a command just now
+bool Pn532Reader::probe() {
+  if (listing)
+    return millis() - listedAt < PN532_ANSWER_TIMEOUT_MS || answerReady();
+  return nfc.getFirmwareVersion() != 0;
+}
+
+// one status byte; Adafruit-PN532 keeps its own ready check private
+bool Pn532Reader::answerReady() {
+  SPI.beginTransaction(SPISettings(PN532_SPI_CLOCK, LSBFIRST, SPI_MODE0));
+  digitalWrite(chipSelect, LOW);
+  SPI.transfer(PN532_SPI_STATREAD);
+  uint8_t status = SPI.transfer(0);
+  digitalWrite(chipSelect, HIGH);
+  SPI.endTransaction();
+  return status == PN532_SPI_READY; // a bus stuck high reads 0xFF
+}
+
+unsigned long Pn532Reader::answerDueMs() const {
+  return listing ? PN532_ANSWER_MS : 0;
+}
+
+/**
+ * @brief Starts a list of one card, or reports the card the last one found.
+ *
+ * A poll never waits for the field: with no list running it sends
+ * InListPassiveTarget and returns, and answerDueMs() asks for a follow-up
+ * poll. That one reads the answer if the status byte shows it is waiting,
+ * polls again later if it is not, and gives up after
+ * @ref PN532_ANSWER_TIMEOUT_MS so the next poll lists afresh.
+ *
+ * The card is released (InRelease) right after its UID is read, so the PN532
+ * does not keep it as a listed target. A released card is found again on the
+ * next list for as long as it stays in the field. It is therefore reported
+ * only after at least one list found the field empty, the way a halted MFRC522
+ * card stays silent until it is taken away. The PN532 backend does not
+ * authenticate sectors, so its cards never count as verified.
+ *
+ * @return uint8_t 1 if a newly presented card was read, else 0.
+ */
+uint8_t Pn532Reader::poll(UidKey* keys, uint8_t maxCards, uint8_t* verified) {
+  *verified = 0;
+  if (maxCards == 0)
+    return 0;
+
+  unsigned long start = micros();
+  uint8_t count = 0;
+  if (!listing) {
+    listing = nfc.startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+    listedAt = millis();
+    if (!listing)
+      cardInField = false; // no ACK: the health check takes it from here
+  } else if (answerReady()) {
+    listing = false;
+    uint8_t uid[UID_MAX_BYTES];
+    uint8_t length = 0;
+    if (nfc.readDetectedPassiveTargetID(uid, &length) && length != 0) {
+      nfc.inRelease();
+      UidKey key = makeUidKey(uid, length);
+      if (!cardInField || !(key == lastKey)) {
+        lastKey = key;
+        keys[0] = key;
+        count = 1;
+      }
+      cardInField = true;
+    } else {
+      cardInField = false;
+    }
+  } else if (millis() - listedAt >= PN532_ANSWER_TIMEOUT_MS) {
+    listing = false;
+    lateAnswers++;
+  }
+
+  uint32_t elapsed = micros() - start;
+  pollCount++;
+  pollTotalUs += elapsed;
+  if (elapsed > pollWorstUs)
+    pollWorstUs = elapsed;
+  return count;
+}
+
+void Pn532Reader::printStats() {
+  if (pollCount > 0)
+    Serial.printf("%s (PN532): poll avg %lu us, worst %lu us, %lu lists unanswered\n", label,
+                  (unsigned long)(pollTotalUs / pollCount), (unsigned long)pollWorstUs,
+                  (unsigned long)lateAnswers);
+  cadence.printStats(label);
+
+  lateAnswers = 0;
+  pollCount = 0;
+  pollTotalUs = 0;
+  pollWorstUs = 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Adafruit_PN532.h>
+#include <Arduino.h>
+
+#include "reader.h"
+
+/**
+ * PN532 backend (Adafruit-PN532 over SPI). The PN532 lists one card per
+ * InListPassiveTarget, so a poll returns at most one UID. The command runs on
+ * the PN532 while loop() carries on: one poll starts it, the follow-up poll a
+ * few ms later reads its answer.
+ */
+class Pn532Reader : public CardReader {
+public:
+  Pn532Reader(uint8_t id, const char* label, uint8_t ssPin);
+
+  uint8_t poll(UidKey* keys, uint8_t maxCards, uint8_t* verified) override;
+  void printStats() override;
+  unsigned long answerDueMs() const override;
+
+protected:
+  bool probe() override;
+  InitProgress initStep(bool first) override;
+
+private:
+  bool answerReady();
+
+  Adafruit_PN532 nfc;
+  const uint8_t chipSelect;
+  uint8_t initStage = 0;
+  bool listing = false;       // an InListPassiveTarget is running
+  unsigned long listedAt = 0; // millis() it was sent
+  uint32_t lateAnswers = 0;
+  uint32_t pollCount = 0;
+  uint32_t pollTotalUs = 0;
+  uint32_t pollWorstUs = 0;
+  UidKey lastKey = {};      // last card reported
+  bool cardInField = false; // a card answered the previous poll
+};
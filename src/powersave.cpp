@@ -0,0 +1,124 @@
+#include "powersave.h"
+
+#include <ESP8266WiFi.h>
+#include <coredecls.h>
+#include <gpio.h>
+
+extern "C" {
+#include <user_interface.h>
+}
+
+static uint8_t wakeupPin = 0;
+static volatile bool wokenUp = false;
+
+// energy account: millis() only counts awake time, sleep is measured on the RTC
+static unsigned long statsStart = 0;
+static uint64_t sleptUs = 0;
+static uint32_t sleeps = 0;
+static bool wifiOn = false;
+static unsigned long wifiOnSince = 0;
+static unsigned long wifiOnMs = 0;
+
+static void wakeupCallback() {
+  wokenUp = true;
+  esp_schedule();
+}
+
+/**
+ * @brief Starts with the radio off and prepares light sleep.
+ *
+ * @param wakePin GPIO (0..15) that wakes the chip when pulled low, e.g. the MODE button.
+ */
+void powerSaveBegin(uint8_t wakePin) {
+  wakeupPin = wakePin;
+  WiFi.persistent(false);
+  wifiOn = true; // whatever the SDK restored from flash
+  wifiRadioOff();
+  statsStart = millis();
+}
+
+/**
+ * @brief Puts the ESP8266 into forced light sleep for up to `ms`.
+ *
+ * The CPU, timers and millis() stop; the chip wakes when the time is up or the
+ * wake pin goes low. Only call it with nothing pending. The CPU cycle counter
+ * stops too, so a timer0 compare (the relock timer) armed before the sleep
+ * fires late by the time slept: idleSleep() never sleeps while the door is
+ * unlocked, which is the whole time the relock is armed. The sleep is measured
+ * on the RTC, because millis() does not advance during it.
+ *
+ * @return unsigned long Milliseconds actually slept, 0 if the chip did not sleep.
+ */
+unsigned long lightSleep(unsigned long ms) {
+  Serial.flush();
+  uint32_t calibration = system_rtc_clock_cali_proc(); // us per RTC tick, Q12
+  uint32_t rtcStart = system_get_rtc_time();
+
+  wokenUp = false;
+  gpio_pin_wakeup_enable(GPIO_ID_PIN(wakeupPin), GPIO_PIN_INTR_LOLEVEL);
+  if (!ESP.forcedLightSleepBegin(ms * 1000UL, wakeupCallback)) {
+    gpio_pin_wakeup_disable();
+    return 0;
+  }
+  esp_delay(ms + 1, []() { return !wokenUp; }); // the SDK sleeps inside this delay
+  ESP.forcedLightSleepEnd();
+  gpio_pin_wakeup_disable();
+
+  uint64_t us = ((uint64_t)(system_get_rtc_time() - rtcStart) * calibration) >> 12;
+  sleptUs += us;
+  sleeps++;
+  return us / 1000;
+}
+
+/**
+ * @brief Wakes the radio for the access point.
+ */
+void wifiRadioOn() {
+  if (wifiOn)
+    return;
+  WiFi.forceSleepWake();
+  wifiOn = true;
+  wifiOnSince = millis();
+}
+
+/**
+ * @brief Turns the radio off; it is only needed while the registration portal is open.
+ */
+void wifiRadioOff() {
+  if (!wifiOn)
+    return;
+  WiFi.mode(WIFI_OFF);
+  WiFi.forceSleepBegin();
+  wifiOn = false;
+  wifiOnMs += millis() - wifiOnSince;
+}
+
+/**
+ * @brief Prints time awake and asleep and the estimated charge per day, then resets.
+ */
+void printPowerStats() {
+  unsigned long awakeMs = millis() - statsStart;
+  unsigned long radioMs = wifiOnMs + (wifiOn ? millis() - wifiOnSince : 0);
+  unsigned long asleepMs = sleptUs / 1000;
+  unsigned long totalMs = awakeMs + asleepMs;
+  if (totalMs == 0)
+    return;
+
+  // average current in uA, then mAh over 24 h
+  uint64_t chargeMaMs = (uint64_t)awakeMs * CURRENT_AWAKE_MA +
+                        (uint64_t)asleepMs * CURRENT_SLEEP_MA +
+                        (uint64_t)radioMs * CURRENT_WIFI_MA +
+                        (uint64_t)totalMs * CURRENT_READER_MA;
+  uint32_t averageUa = chargeMaMs * 1000 / totalMs;
+  Serial.printf("power: awake %lu ms, asleep %lu ms in %lu sleeps, radio %lu ms, "
+                "~%lu uA, ~%lu mAh/day\n",
+                awakeMs, asleepMs, (unsigned long)sleeps, radioMs, (unsigned long)averageUa,
+                (unsigned long)(averageUa * 24UL / 1000));
+
+  statsStart = millis();
+  sleptUs = 0;
+  sleeps = 0;
+  wifiOnMs = 0;
+  if (wifiOn)
+    wifiOnSince = millis();
+}
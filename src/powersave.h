@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Estimated supply currents for the energy account, in mA. Measure your own
+// board and adjust; the reader stays powered the whole time.
+const uint16_t CURRENT_AWAKE_MA = 16; // CPU running, radio off
+const uint16_t CURRENT_SLEEP_MA = 1;  // forced light sleep
+const uint16_t CURRENT_WIFI_MA = 60;  // extra while the access point is up
+const uint16_t CURRENT_READER_MA = 13;
+
+void powerSaveBegin(uint8_t wakePin);
+unsigned long lightSleep(unsigned long ms);
+void wifiRadioOn();
+void wifiRadioOff();
+void printPowerStats();
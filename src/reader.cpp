@@ -0,0 +1,565 @@
+#include "reader.h"
+
+#include "securecard.h"
+
+// The MFRC522 timer ticks at 13.56 MHz / (2 * TPrescaler + 1). With the library's
+// prescaler of 0xA9 that is ~40 kHz, i.e. 25 us per tick.
+const uint16_t TIMER_TICK_US = 25;
+// A card answers REQA ~91 us after the request (ISO 14443-3 FDT of 1236/fc), so
+// idle polls give up after 500 us instead of the library's 25 ms.
+const uint16_t REQA_TIMEOUT_US = 500;
+const uint16_t IDLE_TIMER_RELOAD = REQA_TIMEOUT_US / TIMER_TICK_US;
+const uint16_t DEFAULT_TIMER_RELOAD = 0x03E8; // 25 ms, what PCD_Init() programs
+
+// ComIrqReg bits
+const byte IRQ_RX = 0x20;
+const byte IRQ_IDLE = 0x10;
+const byte IRQ_TIMER = 0x01;
+// ErrorReg bits that mean the answer is unusable (collisions still mean a card is there)
+const byte ERR_FATAL = 0x13; // BufferOvfl | ParityErr | ProtocolErr
+
+// Stop waiting on the chip if its timer IRQ never shows up.
+const unsigned long POLL_GUARD_US = 2000;
+
+// SPI clocks tried at boot, fastest first; the MFRC522 is rated for 10 MHz
+const uint32_t SPI_CLOCKS[] = {10000000UL, 8000000UL, 5000000UL, 4000000UL, 2000000UL, 1000000UL};
+const uint8_t SPI_CLOCK_COUNT = sizeof(SPI_CLOCKS) / sizeof(SPI_CLOCKS[0]);
+const uint8_t SELF_TEST_ROUNDS = 8;
+const uint8_t SELF_TEST_BYTES = 32; // the FIFO is 64 bytes deep
+
+// initStep() stages; the self-test takes one stage per entry of SPI_CLOCKS
+enum InitStage : uint8_t {
+  STAGE_RESET,
+  STAGE_CONFIGURE,
+  STAGE_IDLE_POLLING,
+  STAGE_SELF_TEST,
+};
+// CommandReg PowerDown: reads 1 while the chip wakes from a soft reset
+const byte POWER_DOWN = 0x10;
+// PCD_Init() gives the oscillator up to three 50 ms waits before going on regardless
+const unsigned long RESET_WAIT_MS = 150;
+
+// ---- health watchdog ----
+
+/**
+ * @brief Brings the reader up, running every init step back to back.
+ *
+ * For setup(), where waiting is fine: a running loop() re-initializes
+ * through checkHealth(), one step per pass.
+ *
+ * @return true  If the chip came up.
+ * @return false If the reader does not respond.
+ */
+bool CardReader::begin() {
+  InitProgress progress = initStep(true);
+  while (progress == INIT_PENDING) {
+    delay(1);
+    progress = initStep(false);
+  }
+  return progress == INIT_DONE;
+}
+
+/**
+ * @brief Probes the reader and re-initializes it if it stopped responding.
+ *
+ * Call from every loop() pass; it only does work every @ref HEALTH_CHECK_INTERVAL.
+ * Power noise (e.g. when the actuator switches) can wedge or reset a reader,
+ * after which it silently reads nothing. A failed probe starts a re-init that
+ * runs one initStep() per call, so bringing the chip back up never holds up
+ * a loop() pass for longer than its slowest step (see printHealth()). If that
+ * does not help either, retries back off from @ref HEALTH_BACKOFF_MIN to
+ * @ref HEALTH_BACKOFF_MAX so a dead reader does not eat into loop() time.
+ */
+void CardReader::checkHealth() {
+  if ((long)(millis() - nextCheck) < 0)
+    return;
+
+  bool first = !initializing;
+  if (first) {
+    if (probe()) {
+      healthy = true;
+      backoff = HEALTH_BACKOFF_MIN;
+      nextCheck = millis() + HEALTH_CHECK_INTERVAL;
+      return;
+    }
+
+    healthy = false;
+    initializing = true;
+    resets++;
+    Serial.printf("%s not responding, re-initializing (reset #%lu)\n", label,
+                  (unsigned long)resets);
+  }
+
+  unsigned long start = micros();
+  InitProgress progress = initStep(first);
+  uint32_t elapsed = micros() - start;
+  if (elapsed > worstInitStepUs)
+    worstInitStepUs = elapsed;
+  if (progress == INIT_PENDING)
+    return; // the next step runs on the next call
+
+  initializing = false;
+  if (progress == INIT_DONE && probe()) {
+    healthy = true;
+    backoff = HEALTH_BACKOFF_MIN;
+    nextCheck = millis() + HEALTH_CHECK_INTERVAL;
+    Serial.printf("%s recovered\n", label);
+    return;
+  }
+
+  nextCheck = millis() + backoff;
+  backoff = min(backoff * 2, HEALTH_BACKOFF_MAX);
+}
+
+/**
+ * @brief Accounts for time spent in light sleep, during which millis() stands still.
+ *
+ * Keeps the health check and its backoff on wall-clock time, and the time
+ * since the last read honest.
+ */
+void CardReader::slept(unsigned long ms) {
+  nextCheck -= ms;
+  if (lastRead != 0)
+    lastRead -= ms;
+}
+
+/**
+ * @brief Writes one line of health status: state, reset count, the longest a
+ * re-init step held up loop(), and time since the last read.
+ */
+void CardReader::printHealth(Print& out) {
+  out.printf("%s: %s, %lu resets, ", label, healthy ? "ok" : "NOT RESPONDING",
+             (unsigned long)resets);
+  if (resets != 0)
+    out.printf("longest re-init step %lu us, ", (unsigned long)worstInitStepUs);
+  if (lastRead == 0)
+    out.printf("no card read since boot\n");
+  else
+    out.printf("last card read %lu s ago\n", (millis() - lastRead) / 1000);
+}
+
+// ---- MFRC522 backend ----
+
+Mfrc522Reader::Mfrc522Reader(uint8_t id, const char* label, uint8_t ssPin, uint8_t rstPin,
+                             unsigned long multiCardBudgetUs)
+    : CardReader(id, label), mfrc(ssPin, rstPin), chipSelect(ssPin),
+      multiCardBudget(multiCardBudgetUs), spiSettings(spiClock, MSBFIRST, SPI_MODE0) {}
+
+void Mfrc522Reader::recordTiming(OpTiming& timing, uint32_t us) {
+  timing.count++;
+  timing.total += us;
+  if (us > timing.worst)
+    timing.worst = us;
+}
+
+// ---- bus layer: one SPI transaction per batch, one chip-select frame per register ----
+
+void Mfrc522Reader::beginBatch() {
+  SPI.beginTransaction(spiSettings);
+  spiTransactions++;
+}
+
+void Mfrc522Reader::endBatch() {
+  SPI.endTransaction();
+}
+
+void Mfrc522Reader::frameWrite(MFRC522::PCD_Register reg, const byte* values, uint8_t count) {
+  digitalWrite(chipSelect, LOW);
+  SPI.transfer(reg & 0x7E);
+  for (uint8_t i = 0; i < count; i++)
+    SPI.transfer(values[i]);
+  digitalWrite(chipSelect, HIGH);
+  spiFrames++;
+}
+
+// writes several registers inside a single SPI transaction
+void Mfrc522Reader::writeRegs(const RegWrite* writes, uint8_t count) {
+  beginBatch();
+  for (uint8_t i = 0; i < count; i++)
+    frameWrite(writes[i].reg, &writes[i].value, 1);
+  endBatch();
+}
+
+void Mfrc522Reader::writeReg(MFRC522::PCD_Register reg, byte value) {
+  RegWrite write = {reg, value};
+  writeRegs(&write, 1);
+}
+
+// reads several registers in one frame: each address byte clocks out the previous answer
+void Mfrc522Reader::readRegs(const MFRC522::PCD_Register* regs, byte* values, uint8_t count) {
+  beginBatch();
+  digitalWrite(chipSelect, LOW);
+  SPI.transfer(0x80 | regs[0]);
+  for (uint8_t i = 1; i < count; i++)
+    values[i - 1] = SPI.transfer(0x80 | regs[i]);
+  values[count - 1] = SPI.transfer(0);
+  digitalWrite(chipSelect, HIGH);
+  spiFrames++;
+  endBatch();
+}
+
+byte Mfrc522Reader::readReg(MFRC522::PCD_Register reg) {
+  byte value;
+  readRegs(&reg, &value, 1);
+  return value;
+}
+
+// burst write into the FIFO: one address byte followed by all data bytes
+void Mfrc522Reader::writeFifo(const byte* data, uint8_t count) {
+  beginBatch();
+  frameWrite(MFRC522::FIFODataReg, data, count);
+  endBatch();
+}
+
+// burst read from the FIFO: the same address repeated, one frame
+void Mfrc522Reader::readFifo(byte* data, uint8_t count) {
+  beginBatch();
+  digitalWrite(chipSelect, LOW);
+  SPI.transfer(0x80 | MFRC522::FIFODataReg);
+  for (uint8_t i = 0; i < count; i++)
+    data[i] = SPI.transfer(i + 1 < count ? 0x80 | MFRC522::FIFODataReg : 0);
+  digitalWrite(chipSelect, HIGH);
+  spiFrames++;
+  endBatch();
+}
+
+void Mfrc522Reader::setTimerReload(uint16_t reload) {
+  RegWrite writes[] = {{MFRC522::TReloadRegH, (byte)(reload >> 8)},
+                       {MFRC522::TReloadRegL, (byte)(reload & 0xFF)}};
+  writeRegs(writes, 2);
+}
+
+// ---- clock selection ----
+
+static bool versionLooksValid(byte version) {
+  // 0x88 = FM17522 clone, 0x90..0x92 = MFRC522 v0.0..v2.0, 0x12 / 0xB2 = common clones
+  return version == 0x88 || version == 0x90 || version == 0x91 || version == 0x92 ||
+         version == 0x12 || version == 0xB2;
+}
+
+// FIFO round trip: what is written must come back byte for byte
+bool Mfrc522Reader::busSelfTest() {
+  if (!versionLooksValid(readReg(MFRC522::VersionReg)))
+    return false;
+
+  byte pattern[SELF_TEST_BYTES];
+  byte readBack[SELF_TEST_BYTES];
+  for (uint8_t round = 0; round < SELF_TEST_ROUNDS; round++) {
+    for (uint8_t i = 0; i < SELF_TEST_BYTES; i++)
+      pattern[i] = (i & 1 ? 0xAA : 0x55) ^ (round * 37 + i);
+
+    writeReg(MFRC522::FIFOLevelReg, 0x80);
+    writeFifo(pattern, SELF_TEST_BYTES);
+    if (readReg(MFRC522::FIFOLevelReg) != SELF_TEST_BYTES)
+      return false;
+    readFifo(readBack, SELF_TEST_BYTES);
+    if (memcmp(pattern, readBack, SELF_TEST_BYTES) != 0)
+      return false;
+  }
+
+  writeReg(MFRC522::FIFOLevelReg, 0x80);
+  return true;
+}
+
+void Mfrc522Reader::setSpiClock(uint32_t clock) {
+  spiClock = clock;
+  spiSettings = SPISettings(spiClock, MSBFIRST, SPI_MODE0);
+}
+
+// ---- reader operations ----
+
+/**
+ * @brief Runs the next step of initializing the chip for lightweight idle polling.
+ *
+ * The steps are what `PCD_Init()` does, split where it would wait: a soft
+ * reset, the library's register setup once the oscillator is up (polled, not
+ * slept on), then a FIFO read-back self-test at one SPI clock per step, fastest
+ * first (warning if the one that passes is below `MFRC522_SPICLOCK`, the clock
+ * the library runs select and authentication at). The last step sets once what
+ * `PICC_IsNewCardPresent()` rewrites on every call (baud rates, modulation
+ * width, collision handling) and arms the short REQA timeout.
+ *
+ * @return INIT_DONE   Once the chip answered the self-test at some clock.
+ * @return INIT_FAILED If the reader does not respond.
+ */
+InitProgress Mfrc522Reader::initStep(bool first) {
+  if (first)
+    initStage = STAGE_RESET;
+
+  switch (initStage) {
+  case STAGE_RESET:
+    pinMode(chipSelect, OUTPUT);
+    digitalWrite(chipSelect, HIGH);
+    mfrc.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_SoftReset);
+    resetAt = millis();
+    initStage = STAGE_CONFIGURE;
+    return INIT_PENDING;
+
+  case STAGE_CONFIGURE:
+    if ((mfrc.PCD_ReadRegister(MFRC522::CommandReg) & POWER_DOWN) &&
+        millis() - resetAt < RESET_WAIT_MS)
+      return INIT_PENDING; // still waking up
+    mfrc.PCD_WriteRegister(MFRC522::TxModeReg, 0x00);
+    mfrc.PCD_WriteRegister(MFRC522::RxModeReg, 0x00);
+    mfrc.PCD_WriteRegister(MFRC522::ModWidthReg, 0x26);
+    mfrc.PCD_WriteRegister(MFRC522::TModeReg, 0x80);
+    mfrc.PCD_WriteRegister(MFRC522::TPrescalerReg, 0xA9);
+    mfrc.PCD_WriteRegister(MFRC522::TReloadRegH, DEFAULT_TIMER_RELOAD >> 8);
+    mfrc.PCD_WriteRegister(MFRC522::TReloadRegL, DEFAULT_TIMER_RELOAD & 0xFF);
+    mfrc.PCD_WriteRegister(MFRC522::TxASKReg, 0x40);
+    mfrc.PCD_WriteRegister(MFRC522::ModeReg, 0x3D);
+    mfrc.PCD_AntennaOn();
+    initStage = STAGE_SELF_TEST;
+    return INIT_PENDING;
+
+  case STAGE_IDLE_POLLING:
+    break;
+
+  default: { // STAGE_SELF_TEST + the index of the clock to try
+    uint8_t index = initStage - STAGE_SELF_TEST;
+    setSpiClock(SPI_CLOCKS[index]);
+    if (busSelfTest()) {
+      Serial.printf("Reader SPI clock: %lu Hz\n", (unsigned long)spiClock);
+    } else if (index + 1 < SPI_CLOCK_COUNT) {
+      initStage++;
+      return INIT_PENDING;
+    } else {
+      setSpiClock(4000000UL);
+      Serial.println("Reader failed the SPI self-test at every clock, staying at 4 MHz");
+    }
+    initStage = STAGE_IDLE_POLLING; // a few registers more, in the same step
+    break;
+  }
+  }
+
+  bool ok = versionLooksValid(readReg(MFRC522::VersionReg));
+  if (ok && spiClock < MFRC522_SPICLOCK)
+    Serial.printf("%s passed the SPI self-test only up to %lu Hz, but the library selects "
+                  "cards at %lu Hz; lower MFRC522_SPICLOCK in platformio.ini\n",
+                  label, (unsigned long)spiClock, (unsigned long)MFRC522_SPICLOCK);
+
+  byte coll = readReg(MFRC522::CollReg);
+  RegWrite writes[] = {{MFRC522::TxModeReg, 0x00},
+                       {MFRC522::RxModeReg, 0x00},
+                       {MFRC522::ModWidthReg, 0x26},
+                       {MFRC522::CollReg, (byte)(coll & ~0x80)}, // ValuesAfterColl
+                       {MFRC522::TReloadRegH, IDLE_TIMER_RELOAD >> 8},
+                       {MFRC522::TReloadRegL, IDLE_TIMER_RELOAD & 0xFF}};
+  writeRegs(writes, sizeof(writes) / sizeof(writes[0]));
+  return ok ? INIT_DONE : INIT_FAILED;
+}
+
+// REQA transceive with whatever timeout is armed; true if a usable answer came back
+bool Mfrc522Reader::requestA() {
+  unsigned long start = micros();
+
+  static const RegWrite request[] = {
+      {MFRC522::CommandReg, MFRC522::PCD_Idle},
+      {MFRC522::ComIrqReg, 0x7F},    // clear all IRQ bits
+      {MFRC522::FIFOLevelReg, 0x80}, // flush FIFO
+      {MFRC522::FIFODataReg, MFRC522::PICC_CMD_REQA},
+      {MFRC522::CommandReg, MFRC522::PCD_Transceive},
+      {MFRC522::BitFramingReg, 0x87}, // StartSend, 7-bit short frame
+  };
+  writeRegs(request, sizeof(request) / sizeof(request[0]));
+
+  static const MFRC522::PCD_Register status[] = {MFRC522::ComIrqReg, MFRC522::ErrorReg};
+  byte values[2];
+  bool answered = false;
+  do {
+    readRegs(status, values, 2);
+    if (values[0] & IRQ_TIMER)
+      break;
+    answered = values[0] & (IRQ_RX | IRQ_IDLE);
+  } while (!answered && micros() - start < POLL_GUARD_US);
+
+  return answered && !(values[1] & ERR_FATAL);
+}
+
+/**
+ * @brief Sends a single REQA and reports whether any card answered.
+ *
+ * Replaces `PICC_IsNewCardPresent()` on the idle path: the request is written in
+ * one SPI transaction, then IRQ and error registers are read together until the
+ * card answers or the chip's timer expires after @ref REQA_TIMEOUT_US.
+ *
+ * @return true  If a card answered (possibly several, colliding).
+ * @return false If the field is empty.
+ */
+bool Mfrc522Reader::cardPresent() {
+  unsigned long start = micros();
+  bool answered = requestA();
+  recordTiming(pollTiming, micros() - start);
+  return answered;
+}
+
+/**
+ * @brief Reads the UIDs of every card in the field, one after another.
+ *
+ * Call after cardPresent() returned true. The library's anticollision resolves
+ * a collision to one card; that card is selected, recorded and sent to HALT so
+ * it stays silent, and a new REQA wakes the remaining ones. This repeats until
+ * the field answers no more, `maxCards` were read or the multi-card budget is
+ * spent. The budget is checked between cards, so a poll overruns it by at most
+ * one card. Halted cards stay silent until they leave the field, as with a
+ * single card.
+ *
+ * With secure cards enabled, each card's sector is authenticated and read while
+ * the card is still selected, before it is halted, so the check costs no extra
+ * REQA or select.
+ *
+ * @return uint8_t Number of UIDs read (0 if the card left before it was selected).
+ */
+uint8_t Mfrc522Reader::readAllCards(UidKey* keys, uint8_t maxCards, uint8_t* verified) {
+  unsigned long start = micros();
+  uint8_t count = 0;
+  *verified = 0;
+
+  setTimerReload(DEFAULT_TIMER_RELOAD);
+  while (count < maxCards) {
+    unsigned long selectStart = micros();
+    if (!mfrc.PICC_ReadCardSerial())
+      break;
+    recordTiming(selectTiming[mfrc.uid.size == 4 ? 0 : 1], micros() - selectStart);
+
+    // a card that failed authentication fell back to IDLE and missed its HLTA, so
+    // the next REQA selected it again: this time it is only halted
+    UidKey key = makeUidKey(mfrc.uid.uidByte, mfrc.uid.size);
+    bool again = false;
+    for (uint8_t i = 0; i < count; i++)
+      again |= keys[i] == key;
+    if (!again) {
+      keys[count] = key;
+      if (secureCardsEnabled() && authenticateCard(key, selectStart))
+        *verified |= 1 << count;
+      count++;
+    }
+    // a card never answers HLTA, so the library waits for the timer: keep it short
+    setTimerReload(IDLE_TIMER_RELOAD);
+    mfrc.PICC_HaltA();
+    mfrc.PCD_StopCrypto1(); // the next card starts a fresh authentication
+
+    if (count == maxCards || micros() - start >= multiCardBudget)
+      break;
+
+    // anyone else out there? ask with the short timeout, select with the normal one
+    if (!requestA())
+      break;
+    setTimerReload(DEFAULT_TIMER_RELOAD);
+  }
+
+  mfrc.PCD_StopCrypto1();
+  setTimerReload(IDLE_TIMER_RELOAD);
+  return count;
+}
+
+/**
+ * @brief Authenticates the selected card's credential sector and checks its block.
+ *
+ * Key A of the configured sector is tried with the site key, then the
+ * credential block is read and compared with the HMAC of the UID. If the card
+ * was armed for provisioning (see @ref requestProvisioning()), the expected
+ * block is written first. Each stage is timed; cards whose select-to-verdict
+ * time exceeds the configured budget are counted.
+ *
+ * @return true If the card carries a valid credential block.
+ */
+bool Mfrc522Reader::authenticateCard(const UidKey& key, unsigned long selectStart) {
+  unsigned long stageStart = micros();
+  MFRC522::StatusCode status = mfrc.PCD_Authenticate(
+      MFRC522::PICC_CMD_MF_AUTH_KEY_A, secureTrailerBlock(), secureSiteKey(), &mfrc.uid);
+  recordTiming(authTiming, micros() - stageStart);
+
+  byte block[SECURE_BLOCK_SIZE + 2]; // MIFARE_Read() wants room for the CRC
+  if (status == MFRC522::STATUS_OK && provisioningPending(key)) {
+    secureCredentialBlock(key, block);
+    provisioningDone(mfrc.MIFARE_Write(secureDataBlock(), block, SECURE_BLOCK_SIZE) ==
+                     MFRC522::STATUS_OK);
+  }
+
+  if (status == MFRC522::STATUS_OK) {
+    stageStart = micros();
+    byte size = sizeof(block);
+    status = mfrc.MIFARE_Read(secureDataBlock(), block, &size);
+    recordTiming(blockTiming, micros() - stageStart);
+  }
+
+  bool valid = false;
+  if (status == MFRC522::STATUS_OK) {
+    stageStart = micros();
+    valid = verifyCredentialBlock(key, block);
+    recordTiming(verifyTiming, micros() - stageStart);
+  }
+
+  uint32_t total = micros() - selectStart;
+  recordTiming(secureTotalTiming, total);
+  if (total > secureBudgetUs())
+    overBudget++;
+  if (!valid)
+    secureFailures++;
+  return valid;
+}
+
+/**
+ * @brief Checks that the chip answers and still has the lock's configuration.
+ *
+ * A brown-out resets the MFRC522 to its defaults: the antenna turns off and the
+ * timer loses its auto-start, so polls would never see a card again.
+ */
+bool Mfrc522Reader::probe() {
+  static const MFRC522::PCD_Register regs[] = {MFRC522::VersionReg, MFRC522::TxControlReg,
+                                               MFRC522::TModeReg, MFRC522::TReloadRegL};
+  byte values[4];
+  readRegs(regs, values, 4);
+  return versionLooksValid(values[0]) && (values[1] & 0x03) == 0x03 && (values[2] & 0x80) &&
+         values[3] == (IDLE_TIMER_RELOAD & 0xFF);
+}
+
+uint8_t Mfrc522Reader::poll(UidKey* keys, uint8_t maxCards, uint8_t* verified) {
+  *verified = 0;
+  if (!cardPresent())
+    return 0;
+  return readAllCards(keys, maxCards, verified);
+}
+
+void Mfrc522Reader::printTiming(const char* label, OpTiming& timing) {
+  if (timing.count == 0)
+    return;
+  Serial.printf("  %s: %lu x, avg %lu us, worst %lu us\n", label, (unsigned long)timing.count,
+                (unsigned long)(timing.total / timing.count), (unsigned long)timing.worst);
+  timing = {};
+}
+
+/**
+ * @brief Prints bus rates and per-operation timing since the last call, then resets them.
+ */
+void Mfrc522Reader::printStats() {
+  unsigned long elapsed = millis() - statsStart;
+  if (elapsed == 0)
+    return;
+
+  Serial.printf("%s (MFRC522 @ %lu Hz, select @ %lu Hz): %lu SPI transactions/s "
+                "(%lu frames/s)\n",
+                label, (unsigned long)spiClock, (unsigned long)MFRC522_SPICLOCK,
+                (unsigned long)(spiTransactions * 1000ULL / elapsed),
+                (unsigned long)(spiFrames * 1000ULL / elapsed));
+  printTiming("idle poll", pollTiming);
+  printTiming("select 4-byte", selectTiming[0]);
+  printTiming("select 7/10-byte", selectTiming[1]);
+  if (secureCardsEnabled()) {
+    printTiming("sector auth", authTiming);
+    printTiming("block read", blockTiming);
+    printTiming("MAC check", verifyTiming);
+    printTiming("select to verdict", secureTotalTiming);
+    Serial.printf("  %lu cards failed authentication, %lu over the %lu ms budget\n",
+                  (unsigned long)secureFailures, (unsigned long)overBudget,
+                  secureBudgetUs() / 1000);
+    secureFailures = 0;
+    overBudget = 0;
+  }
+  cadence.printStats(label);
+
+  spiTransactions = 0;
+  spiFrames = 0;
+  statsStart = millis();
+}
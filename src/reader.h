@@ -0,0 +1,174 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <SPI.h>
+
+#include "scancadence.h"
+#include "uidkey.h"
+
+const uint8_t MAX_CARDS_PER_SCAN = 4;
+
+// reader health watchdog
+const unsigned long HEALTH_CHECK_INTERVAL = 5000UL; // ms between checks of a healthy reader
+const unsigned long HEALTH_BACKOFF_MIN = 1000UL;    // first retry after a failed re-init
+const unsigned long HEALTH_BACKOFF_MAX = 60000UL;
+
+// how far one step of bringing a reader up got
+enum InitProgress : uint8_t {
+  INIT_PENDING, // more steps to run
+  INIT_DONE,
+  INIT_FAILED,
+};
+
+// every card read in one poll of one reader
+struct CardEvent {
+  uint8_t reader;
+  uint8_t count;
+  uint8_t verified; // bit i set if card i passed sector authentication
+  uint32_t detectedUs;
+  UidKey keys[MAX_CARDS_PER_SCAN];
+};
+
+/**
+ * One card reader on the SPI bus. Each reader keeps its own scan cadence so
+ * several readers can be polled in turn without slowing each other down, and
+ * its own health watchdog that re-initializes it when it stops responding.
+ */
+class CardReader {
+public:
+  CardReader(uint8_t id, const char* label) : id(id), label(label) {}
+  virtual ~CardReader() {}
+
+  bool begin();
+
+  /**
+   * @brief Polls the reader once.
+   *
+   * @param keys     Output array receiving the packed UIDs of the cards found.
+   * @param maxCards Size of `keys`.
+   * @param verified Receives a bit mask of the cards that passed sector
+   *                 authentication (see securecard.h); 0 if the reader cannot check.
+   *
+   * @return uint8_t Number of cards read, 0 if the field is empty.
+   */
+  virtual uint8_t poll(UidKey* keys, uint8_t maxCards, uint8_t* verified) = 0;
+
+  virtual void printStats() = 0;
+
+  /**
+   * @brief Milliseconds until the answer to a command the last poll left running
+   * can be read by the next poll; 0 if none is running.
+   */
+  virtual unsigned long answerDueMs() const {
+    return 0;
+  }
+
+  void checkHealth();
+  void printHealth(Print& out);
+  void slept(unsigned long ms);
+
+  void noteRead() {
+    lastRead = millis();
+  }
+
+  bool isHealthy() const {
+    return healthy;
+  }
+
+  const uint8_t id;
+  const char* const label;
+  ScanCadence cadence;
+
+protected:
+  // cheap check that the chip still answers and is still configured
+  virtual bool probe() = 0;
+
+  /**
+   * @brief Runs the next step of bringing the chip up, short enough for one loop() pass.
+   *
+   * @param first true to start over from the first step.
+   */
+  virtual InitProgress initStep(bool first) = 0;
+
+private:
+  bool healthy = true;
+  bool initializing = false; // a re-init is part way through its steps
+  uint32_t resets = 0;
+  uint32_t worstInitStepUs = 0;
+  unsigned long lastRead = 0;
+  unsigned long nextCheck = 0;
+  unsigned long backoff = HEALTH_BACKOFF_MIN;
+};
+
+/**
+ * MFRC522 backend. The library handles anticollision and select; the idle poll
+ * path talks to the chip directly over a batched SPI layer.
+ */
+class Mfrc522Reader : public CardReader {
+public:
+  Mfrc522Reader(uint8_t id, const char* label, uint8_t ssPin, uint8_t rstPin,
+                unsigned long multiCardBudgetUs);
+
+  uint8_t poll(UidKey* keys, uint8_t maxCards, uint8_t* verified) override;
+  void printStats() override;
+
+protected:
+  bool probe() override;
+  InitProgress initStep(bool first) override;
+
+private:
+  struct RegWrite {
+    MFRC522::PCD_Register reg;
+    byte value;
+  };
+
+  // per-operation timing, in microseconds
+  struct OpTiming {
+    uint32_t count;
+    uint32_t total;
+    uint32_t worst;
+  };
+
+  bool cardPresent();
+  bool requestA();
+  uint8_t readAllCards(UidKey* keys, uint8_t maxCards, uint8_t* verified);
+  bool authenticateCard(const UidKey& key, unsigned long selectStart);
+
+  void setSpiClock(uint32_t clock);
+  bool busSelfTest();
+  void beginBatch();
+  void endBatch();
+  void frameWrite(MFRC522::PCD_Register reg, const byte* values, uint8_t count);
+  void writeRegs(const RegWrite* writes, uint8_t count);
+  void writeReg(MFRC522::PCD_Register reg, byte value);
+  void readRegs(const MFRC522::PCD_Register* regs, byte* values, uint8_t count);
+  byte readReg(MFRC522::PCD_Register reg);
+  void writeFifo(const byte* data, uint8_t count);
+  void readFifo(byte* data, uint8_t count);
+  void setTimerReload(uint16_t reload);
+
+  static void recordTiming(OpTiming& timing, uint32_t us);
+  static void printTiming(const char* label, OpTiming& timing);
+
+  MFRC522 mfrc;
+  const uint8_t chipSelect;
+  const unsigned long multiCardBudget;
+  uint32_t spiClock = 4000000UL; // the library default until the self-test ran
+  SPISettings spiSettings;
+  uint8_t initStage = 0;
+  unsigned long resetAt = 0; // millis() of the soft reset
+
+  uint32_t spiTransactions = 0;
+  uint32_t spiFrames = 0;
+  unsigned long statsStart = 0;
+  OpTiming pollTiming = {};
+  OpTiming selectTiming[2] = {}; // [0] = 4-byte UIDs, [1] = 7/10-byte UIDs
+  // sector authentication stages, and select-to-verdict per card
+  OpTiming authTiming = {};
+  OpTiming blockTiming = {};
+  OpTiming verifyTiming = {};
+  OpTiming secureTotalTiming = {};
+  uint32_t secureFailures = 0;
+  uint32_t overBudget = 0;
+};
@@ -0,0 +1,294 @@
+#include "replay.h"
+
+#ifdef ENABLE_BENCH
+
+#include <LittleFS.h>
+
+#include "credstore.h"
+#include "csvreader.h"
+#include "spscqueue.h"
+
+// upper bounds of the decision latency buckets in us; one more bucket catches the rest
+static const uint32_t LATENCY_BOUNDS_US[REPLAY_LATENCY_BUCKETS] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+
+struct Transition {
+  uint32_t atMs;
+  SystemState from;
+  SystemState to;
+};
+
+struct ReplayReport {
+  uint32_t lines;
+  uint32_t ignored; // lines that are not a known event, e.g. comments
+  uint32_t taps;
+  uint32_t granted;
+  uint32_t denied;
+  uint32_t modeCards;
+  uint32_t missedTaps;
+  uint32_t registered;
+  uint32_t duplicates;
+  uint32_t missedRegistrations;
+  uint32_t latency[REPLAY_LATENCY_BUCKETS + 1];
+  uint32_t latencyMax;
+  uint32_t unlocks;
+  uint32_t unlockMinMs;
+  uint32_t unlockMaxMs;
+  uint32_t addModes;
+  uint32_t expiries;
+  uint32_t expiryIdleMinMs; // time since the last add mode activity when it timed out
+  uint32_t expiryIdleMaxMs;
+  uint32_t transitionCount;
+  Transition transitions[REPLAY_MAX_TRANSITIONS];
+};
+
+static bool active = false;
+static uint32_t virtualMs = 0;
+static ReplayReport report;
+
+// what the lock looked like after the last event or loop() pass
+static SystemState lastState;
+static bool wasUnlocked;
+static uint32_t unlockedAtMs;
+static uint32_t activityMs; // last event that restarted the add mode timeout
+
+static SpscQueue<uint32_t, 4> pendingTaps; // trace time of each queued tap
+
+unsigned long replayMillis() {
+  return active ? virtualMs : millis();
+}
+
+static void recordLatency(uint32_t us) {
+  uint8_t bucket = 0;
+  while (bucket < REPLAY_LATENCY_BUCKETS && us > LATENCY_BOUNDS_US[bucket])
+    bucket++;
+  report.latency[bucket]++;
+  report.latencyMax = max(report.latencyMax, us);
+}
+
+// upper bound of the bucket holding the given quantile, in us, capped at the worst seen
+static uint32_t latencyQuantile(uint32_t permille) {
+  uint32_t decided = report.granted + report.denied + report.modeCards;
+  uint32_t rank = (decided * permille + 999) / 1000;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < REPLAY_LATENCY_BUCKETS; i++) {
+    seen += report.latency[i];
+    if (seen >= rank)
+      return min(LATENCY_BOUNDS_US[i], report.latencyMax);
+  }
+  return report.latencyMax;
+}
+
+// notes mode transitions and door openings since the last look
+static void observe(const ReplayHooks& hooks, bool afterPass) {
+  SystemState state = hooks.state();
+  if (state != lastState) {
+    if (report.transitionCount < REPLAY_MAX_TRANSITIONS)
+      report.transitions[report.transitionCount] = {virtualMs, lastState, state};
+    report.transitionCount++;
+
+    if (lastState == STATE_DOOR_LOCK) {
+      report.addModes++;
+    } else if (state == STATE_DOOR_LOCK && afterPass) {
+      // only the timeout leaves add mode from a loop() pass
+      uint32_t idle = virtualMs - activityMs;
+      report.expiries++;
+      report.expiryIdleMinMs = min(report.expiryIdleMinMs, idle);
+      report.expiryIdleMaxMs = max(report.expiryIdleMaxMs, idle);
+    }
+    lastState = state;
+  }
+
+  bool unlocked = hooks.unlocked();
+  if (unlocked && !wasUnlocked) {
+    unlockedAtMs = virtualMs;
+    report.unlocks++;
+  } else if (!unlocked && wasUnlocked) {
+    uint32_t open = virtualMs - unlockedAtMs;
+    report.unlockMinMs = min(report.unlockMinMs, open);
+    report.unlockMaxMs = max(report.unlockMaxMs, open);
+  }
+  wasUnlocked = unlocked;
+}
+
+static bool parseGesture(const char* text, ButtonGesture* gesture) {
+  if (strcmp(text, "short") == 0)
+    *gesture = GESTURE_SHORT;
+  else if (strcmp(text, "long") == 0)
+    *gesture = GESTURE_LONG;
+  else if (strcmp(text, "double") == 0)
+    *gesture = GESTURE_DOUBLE;
+  else
+    return false;
+  return true;
+}
+
+static void applyEvent(const CsvReader& line, const ReplayHooks& hooks) {
+  report.lines++;
+  const char* event = line.fieldCount() >= 2 ? line.field(1) : "";
+  UidKey key;
+  ButtonGesture gesture;
+
+  if (strcmp(event, "tap") == 0 && line.fieldCount() == 3 && parseUidKey(line.field(2), &key)) {
+    report.taps++;
+    if (hooks.tap(key))
+      pendingTaps.push(virtualMs);
+    else
+      report.missedTaps++;
+  } else if (strcmp(event, "button") == 0 && line.fieldCount() == 3 &&
+             parseGesture(line.field(2), &gesture)) {
+    if (gesture == GESTURE_SHORT && hooks.state() == STATE_DOOR_LOCK)
+      activityMs = virtualMs;
+    hooks.gesture(gesture);
+  } else if ((strcmp(event, "register") == 0 || strcmp(event, "register-admin") == 0) &&
+             line.fieldCount() == 3 && parseUidKey(line.field(2), &key)) {
+    switch (hooks.registerCard(key, event[8] == '\0' ? 'U' : 'A')) {
+    case REGISTER_OK:
+      report.registered++;
+      activityMs = virtualMs;
+      break;
+    case REGISTER_DUPLICATE:
+      report.duplicates++;
+      break;
+    case REGISTER_MISSED:
+      report.missedRegistrations++;
+      break;
+    }
+  } else {
+    report.ignored++;
+  }
+}
+
+// one loop() pass at the current trace time
+static void replayPass(const ReplayHooks& hooks) {
+  uint32_t start = micros();
+  ReplayOutcome outcome = hooks.step();
+  uint32_t us = micros() - start;
+  if (outcome != OUTCOME_NONE) {
+    uint32_t tappedMs = virtualMs;
+    pendingTaps.pop(&tappedMs);
+    recordLatency((virtualMs - tappedMs) * 1000UL + us);
+  }
+
+  switch (outcome) {
+  case OUTCOME_GRANTED:
+    report.granted++;
+    break;
+  case OUTCOME_DENIED:
+    report.denied++;
+    break;
+  case OUTCOME_MODE_EVENT:
+    report.modeCards++;
+    activityMs = virtualMs; // every card restarts the add mode timeout
+    break;
+  case OUTCOME_NONE:
+    break;
+  }
+  observe(hooks, true);
+}
+
+static void printReport(Print& out, unsigned long realMs) {
+  out.printf("{\"trace\":\"/trace.csv\",\"lines\":%lu,\"ignored\":%lu,\"virtual_ms\":%lu,"
+             "\"real_ms\":%lu,\n",
+             (unsigned long)report.lines, (unsigned long)report.ignored,
+             (unsigned long)virtualMs, realMs);
+  out.printf(" \"taps\":{\"total\":%lu,\"granted\":%lu,\"denied\":%lu,\"mode_events\":%lu,"
+             "\"missed\":%lu},\n",
+             (unsigned long)report.taps, (unsigned long)report.granted,
+             (unsigned long)report.denied, (unsigned long)report.modeCards,
+             (unsigned long)report.missedTaps);
+  out.printf(" \"registrations\":{\"ok\":%lu,\"duplicate\":%lu,\"missed\":%lu},\n",
+             (unsigned long)report.registered, (unsigned long)report.duplicates,
+             (unsigned long)report.missedRegistrations);
+
+  out.printf(" \"decision_latency_us\":{\"p50\":%lu,\"p99\":%lu,\"max\":%lu,\"buckets\":[",
+             (unsigned long)latencyQuantile(500), (unsigned long)latencyQuantile(990),
+             (unsigned long)report.latencyMax);
+  for (uint8_t i = 0; i < REPLAY_LATENCY_BUCKETS; i++)
+    out.printf("{\"le\":%lu,\"count\":%lu},", (unsigned long)LATENCY_BOUNDS_US[i],
+               (unsigned long)report.latency[i]);
+  out.printf("{\"le\":\"+Inf\",\"count\":%lu}]},\n",
+             (unsigned long)report.latency[REPLAY_LATENCY_BUCKETS]);
+
+  out.printf(" \"unlocks\":{\"count\":%lu,\"min_ms\":%lu,\"max_ms\":%lu},\n",
+             (unsigned long)report.unlocks,
+             (unsigned long)(report.unlocks ? report.unlockMinMs : 0),
+             (unsigned long)report.unlockMaxMs);
+  out.printf(" \"add_mode\":{\"entered\":%lu,\"expired\":%lu,\"idle_before_expiry_min_ms\":%lu,"
+             "\"idle_before_expiry_max_ms\":%lu},\n",
+             (unsigned long)report.addModes, (unsigned long)report.expiries,
+             (unsigned long)(report.expiries ? report.expiryIdleMinMs : 0),
+             (unsigned long)report.expiryIdleMaxMs);
+
+  out.printf(" \"transitions\":{\"count\":%lu,\"first\":[", (unsigned long)report.transitionCount);
+  uint8_t listed = min<uint32_t>(report.transitionCount, REPLAY_MAX_TRANSITIONS);
+  for (uint8_t i = 0; i < listed; i++) {
+    const Transition& transition = report.transitions[i];
+    out.printf("%s\n  {\"at_ms\":%lu,\"from\":\"%s\",\"to\":\"%s\"}", i ? "," : "",
+               (unsigned long)transition.atMs, ModeMachine::stateName(transition.from),
+               ModeMachine::stateName(transition.to));
+  }
+  out.println("]}}");
+}
+
+/**
+ * @brief Replays `/trace.csv` and prints a JSON report.
+ *
+ * Trace events are applied when the virtual clock reaches their time; between
+ * them the clock advances by @ref REPLAY_TICK_MS per loop() pass while anything
+ * is time-driven (door open, add mode, queued cards) and jumps straight to the
+ * next event otherwise. The door, buzzer, radio and audit log are left alone,
+ * and registrations only go into RAM: the registered cards are reloaded at the
+ * end. Access schedules are checked against the lock's own clock.
+ */
+void runReplay(Print& out, const ReplayHooks& hooks) {
+  if (hooks.state() != STATE_DOOR_LOCK || hooks.unlocked()) {
+    out.println("{\"error\":\"the lock is busy\"}");
+    return;
+  }
+  File file = LittleFS.open("/trace.csv", "r");
+  if (!file) {
+    out.println("{\"error\":\"no /trace.csv\"}");
+    return;
+  }
+
+  report = {};
+  report.unlockMinMs = UINT32_MAX;
+  report.expiryIdleMinMs = UINT32_MAX;
+  lastState = STATE_DOOR_LOCK;
+  wasUnlocked = false;
+  virtualMs = 0;
+  active = true;
+  unsigned long realStart = millis();
+
+  CsvReader line(file);
+  bool more = line.next();
+  uint32_t passes = 0;
+  while (true) {
+    while (more && strtoul(line.field(0), nullptr, 10) <= virtualMs) {
+      applyEvent(line, hooks);
+      observe(hooks, false);
+      more = line.next();
+    }
+
+    replayPass(hooks);
+    bool idle = lastState == STATE_DOOR_LOCK && !wasUnlocked && pendingTaps.empty();
+    if (idle && !more)
+      break;
+    if (idle)
+      virtualMs = max<uint32_t>(virtualMs + REPLAY_TICK_MS, strtoul(line.field(0), nullptr, 10));
+    else
+      virtualMs += REPLAY_TICK_MS;
+
+    if (++passes % 256 == 0)
+      yield();
+  }
+  file.close();
+  active = false;
+
+  if (report.registered > 0)
+    loadCredentials();
+  printReport(out, millis() - realStart);
+}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "button.h"
+#include "modefsm.h"
+#include "uidkey.h"
+
+// Trace replay, only built with -D ENABLE_BENCH: plays recorded door traffic
+// from /trace.csv through the firmware's pipeline and mode machine on a virtual
+// clock, then prints a JSON report. Trace lines are `time_ms,event,argument`:
+//   1200,tap,AA:BB:CC:DD             card at the entry reader
+//   5000,button,short                MODE button gesture: short, long or double
+//   9000,register,AA:BB:CC:DD        portal registration as a user (kept in RAM only)
+//   9500,register-admin,AA:BB:CC:DD  the same, as an admin
+const uint16_t REPLAY_TICK_MS = 10;       // virtual time per loop() pass
+const uint8_t REPLAY_MAX_TRANSITIONS = 32; // mode transitions listed in the report
+const uint8_t REPLAY_LATENCY_BUCKETS = 9;
+
+enum ReplayOutcome : uint8_t { OUTCOME_NONE, OUTCOME_GRANTED, OUTCOME_DENIED, OUTCOME_MODE_EVENT };
+enum RegisterResult : uint8_t { REGISTER_MISSED, REGISTER_DUPLICATE, REGISTER_OK };
+
+// entry points into main.cpp
+struct ReplayHooks {
+  bool (*tap)(const UidKey& key); // false if the card queue was full
+  ReplayOutcome (*step)();        // one loop() pass: card stages, relock and mode timeouts
+  void (*gesture)(ButtonGesture gesture);
+  RegisterResult (*registerCard)(const UidKey& key, char role);
+  SystemState (*state)();
+  bool (*unlocked)();
+};
+
+unsigned long replayMillis();
+void runReplay(Print& out, const ReplayHooks& hooks);
+
+// the clock the lock's timeouts run on: millis(), or the trace clock during a replay
+#ifdef ENABLE_BENCH
+inline unsigned long logicMillis() {
+  return replayMillis();
+}
+#else
+inline unsigned long logicMillis() {
+  return millis();
+}
+#endif
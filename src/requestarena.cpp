@@ -0,0 +1,57 @@
+#include "requestarena.h"
+
+static char arena[REQUEST_ARENA_SIZE] __attribute__((aligned(4)));
+static size_t arenaUsed = 0;
+static size_t highWater = 0;
+
+/**
+ * @brief Takes `size` bytes from the request arena.
+ *
+ * @return char* The memory (4-byte aligned), or nullptr if the arena is full.
+ */
+char* arenaAlloc(size_t size) {
+  size_t start = (arenaUsed + 3) & ~(size_t)3;
+  if (size > REQUEST_ARENA_SIZE - min(start, REQUEST_ARENA_SIZE))
+    return nullptr;
+
+  arenaUsed = start + size;
+  highWater = max(highWater, arenaUsed);
+  return arena + start;
+}
+
+/**
+ * @brief Copies a string into the request arena, e.g. a form field to be edited in place.
+ *
+ * @return char* The copy, or nullptr if it does not fit.
+ */
+char* arenaCopy(const char* text) {
+  size_t length = strlen(text);
+  char* copy = arenaAlloc(length + 1);
+  if (copy != nullptr)
+    memcpy(copy, text, length + 1);
+  return copy;
+}
+
+/**
+ * @brief Releases everything taken from the arena; called after every request.
+ */
+void arenaReset() {
+  arenaUsed = 0;
+}
+
+size_t arenaHighWater() {
+  return highWater;
+}
+
+ArenaPrint::ArenaPrint(size_t capacity) : buffer(arenaAlloc(capacity)), capacity(capacity) {
+  if (buffer != nullptr)
+    buffer[0] = '\0';
+}
+
+size_t ArenaPrint::write(uint8_t c) {
+  if (buffer == nullptr || used + 1 >= capacity)
+    return 0;
+  buffer[used++] = c;
+  buffer[used] = '\0';
+  return 1;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Scratch memory for one portal request. Handlers take what they need from a
+// static block instead of the heap, and everything is released at once when the
+// request is done. The web server library's own request parsing (headers, form
+// arguments as String) still uses the heap, and frees it after the request.
+const size_t REQUEST_ARENA_SIZE = 1024;
+
+char* arenaAlloc(size_t size);
+char* arenaCopy(const char* text);
+void arenaReset();
+size_t arenaHighWater();
+
+/**
+ * A fixed-size text buffer taken from the request arena, for building a
+ * response with `Print` calls. Output past the capacity is dropped.
+ */
+class ArenaPrint : public Print {
+public:
+  explicit ArenaPrint(size_t capacity);
+
+  size_t write(uint8_t c) override;
+
+  const char* c_str() const {
+    return buffer != nullptr ? buffer : "";
+  }
+
+  size_t length() const {
+    return used;
+  }
+
+private:
+  char* buffer;
+  size_t capacity;
+  size_t used = 0;
+};
@@ -0,0 +1,89 @@
+#include "scancadence.h"
+
+/**
+ * @brief Configures the adaptive scan cadence.
+ *
+ * The reader is polled every `fastMs` for `windowMs` after any card or button
+ * activity. After that the interval doubles on every empty poll until it
+ * reaches `maxMs`, which bounds how long a card can sit in the field before it
+ * is noticed.
+ */
+void ScanCadence::begin(unsigned long fastMs, unsigned long windowMs, unsigned long maxMs) {
+  fastInterval = fastMs;
+  fastWindow = windowMs;
+  maxInterval = maxMs < fastMs ? fastMs : maxMs;
+  currentInterval = fastInterval;
+  lastActivity = millis();
+}
+
+/**
+ * @brief Whether the reader should be polled on this loop() pass.
+ */
+bool ScanCadence::due() const {
+  return untilDue() == 0;
+}
+
+/**
+ * @brief Records a finished poll and backs the cadence off when nothing is happening.
+ *
+ * @param detected   true if the poll found a card.
+ * @param followUpMs Non-zero if the poll only started a command on the reader: the
+ *                   next poll, due that many ms later, reads its answer and counts
+ *                   as the rest of this one.
+ */
+void ScanCadence::polled(bool detected, unsigned long followUpMs) {
+  lastPoll = millis();
+  followUp = followUpMs;
+  if (followUp != 0)
+    return;
+  polls++;
+
+  if (detected) {
+    detections++;
+    activity();
+    return;
+  }
+
+  if (millis() - lastActivity >= fastWindow && currentInterval < maxInterval) {
+    currentInterval *= 2;
+    if (currentInterval > maxInterval)
+      currentInterval = maxInterval;
+  }
+}
+
+/**
+ * @brief Switches back to fast polling, e.g. after a card or a MODE button press.
+ */
+void ScanCadence::activity() {
+  lastActivity = millis();
+  currentInterval = fastInterval;
+}
+
+/**
+ * @brief Milliseconds until the next poll is due, 0 if it already is.
+ */
+unsigned long ScanCadence::untilDue() const {
+  unsigned long interval = followUp != 0 ? min(followUp, currentInterval) : currentInterval;
+  unsigned long elapsed = millis() - lastPoll;
+  return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+/**
+ * @brief Accounts for time spent in light sleep, during which millis() stands still.
+ */
+void ScanCadence::slept(unsigned long ms) {
+  lastPoll -= ms;
+  lastActivity -= ms;
+}
+
+/**
+ * @brief Prints the current cadence and the detections-per-poll ratio, then resets the counters.
+ */
+void ScanCadence::printStats(const char* label) {
+  Serial.printf("%s cadence: every %lu ms (fast %lu, max %lu), %lu polls, %lu detections "
+                "(%.4f per poll)\n",
+                label, currentInterval, fastInterval, maxInterval, (unsigned long)polls,
+                (unsigned long)detections, polls ? (double)detections / polls : 0.0);
+  polls = 0;
+  detections = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Adaptive polling schedule for one reader: fast right after activity, backing
+ * off geometrically to a bounded idle rate.
+ */
+class ScanCadence {
+public:
+  void begin(unsigned long fastMs, unsigned long windowMs, unsigned long maxMs);
+  bool due() const;
+  void polled(bool detected, unsigned long followUpMs = 0);
+  void activity();
+  unsigned long untilDue() const;
+  void slept(unsigned long ms);
+  void printStats(const char* label);
+
+  unsigned long interval() const {
+    return currentInterval;
+  }
+
+  unsigned long lastPollTime() const {
+    return lastPoll;
+  }
+
+private:
+  unsigned long fastInterval = 20;
+  unsigned long fastWindow = 30000;
+  unsigned long maxInterval = 200; // upper bound on detection latency
+
+  unsigned long currentInterval = 20;
+  unsigned long lastPoll = 0;
+  unsigned long lastActivity = 0;
+  unsigned long followUp = 0; // ms to the next poll when the last one left a command running
+
+  uint32_t polls = 0;
+  uint32_t detections = 0;
+};
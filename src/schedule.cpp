@@ -0,0 +1,212 @@
+#include "schedule.h"
+
+#include <LittleFS.h>
+
+#include "csvreader.h"
+#include "timekeeper.h"
+
+struct RoleSchedule {
+  char role;
+  WeeklySchedule schedule;
+};
+
+struct UserSchedule {
+  UidKey uid;
+  WeeklySchedule schedule;
+};
+
+static RoleSchedule roleSchedules[MAX_ROLE_SCHEDULES];
+static uint8_t roleScheduleCount = 0;
+static UserSchedule userSchedules[MAX_USER_SCHEDULES];
+static uint8_t userScheduleCount = 0;
+static bool warnedClockUnset = false;
+
+static WeeklySchedule* scheduleFor(const char* key) {
+  if (key[0] != '\0' && key[1] == '\0') {
+    char role = toupper(key[0]);
+    for (uint8_t i = 0; i < roleScheduleCount; i++)
+      if (roleSchedules[i].role == role)
+        return &roleSchedules[i].schedule;
+
+    if (roleScheduleCount == MAX_ROLE_SCHEDULES)
+      return nullptr;
+    RoleSchedule& entry = roleSchedules[roleScheduleCount++];
+    entry.role = role;
+    memset(entry.schedule.bits, 0, sizeof(entry.schedule.bits));
+    return &entry.schedule;
+  }
+
+  UidKey uid;
+  if (!parseUidKey(key, &uid))
+    return nullptr;
+
+  for (uint8_t i = 0; i < userScheduleCount; i++)
+    if (userSchedules[i].uid == uid)
+      return &userSchedules[i].schedule;
+
+  if (userScheduleCount == MAX_USER_SCHEDULES)
+    return nullptr;
+  UserSchedule& entry = userSchedules[userScheduleCount++];
+  entry.uid = uid;
+  memset(entry.schedule.bits, 0, sizeof(entry.schedule.bits));
+  return &entry.schedule;
+}
+
+// parses "HH:MM" into minutes since midnight
+static int parseMinuteOfDay(const char* text, const char** end) {
+  char* colon;
+  long hours = strtol(text, &colon, 10);
+  if (colon == text || *colon != ':')
+    return -1;
+
+  char* rest;
+  long minutes = strtol(colon + 1, &rest, 10);
+  if (rest == colon + 1)
+    return -1;
+  *end = rest;
+
+  if (hours < 0 || hours > 24 || minutes < 0 || minutes > 59 || (hours == 24 && minutes != 0))
+    return -1;
+
+  return hours * 60 + minutes;
+}
+
+static void setSlots(WeeklySchedule* schedule, uint16_t from, uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    uint16_t slot = (from + i) % SCHEDULE_SLOTS;
+    schedule->bits[slot >> 3] |= 1 << (slot & 7);
+  }
+}
+
+/**
+ * @brief Compiles `/schedules.txt` into per-role and per-user weekly bitmaps.
+ *
+ * Each line grants one time window: `KEY,DAYS,HH:MM-HH:MM`, where KEY is a role
+ * letter (e.g. `U`) or a full UID, and DAYS is a 7-character Monday..Sunday mask
+ * with `-` for days off. Several lines for the same key are OR-ed together; a
+ * window whose end is before its start runs past midnight into the next day.
+ * Times between slot boundaries are rounded into the window (the start up, the
+ * end down), so a window never allows more than it says.
+ *
+ * Example `/schedules.txt`:
+ * ```
+ * U,MTWTF--,08:00-18:00
+ * 04:3A:7F:92:11:22:33,-----SS,22:00-06:00
+ * ```
+ *
+ * A UID with its own schedule ignores its role's schedule. Roles and UIDs that
+ * have no lines at all are allowed at any time.
+ *
+ * @return true  If the file was compiled (or does not exist).
+ * @return false If the file could not be opened.
+ */
+bool loadSchedules() {
+  roleScheduleCount = 0;
+  userScheduleCount = 0;
+
+  if (!LittleFS.exists("/schedules.txt"))
+    return true;
+
+  File file = LittleFS.open("/schedules.txt", "r");
+  if (!file) {
+    Serial.println("Failed to open schedule file for reading");
+    return false;
+  }
+
+  // parse the csv lines in place: KEY,DAYS,HH:MM-HH:MM
+  CsvReader reader(file);
+  while (reader.next()) {
+    const char* key = reader.field(0);
+    const char* days = reader.field(1);
+    const char* window = reader.field(2);
+
+    if (key[0] == '#')
+      continue;
+
+    const char* rest = window;
+    int start = parseMinuteOfDay(window, &rest);
+    int end = start == -1 || *rest != '-' ? -1 : parseMinuteOfDay(rest + 1, &rest);
+    if (reader.fieldCount() != 3 || strlen(days) != 7 || start == -1 || end == -1 ||
+        *rest != '\0') {
+      Serial.printf("Ignoring bad schedule line for %s\n", key);
+      continue;
+    }
+
+    WeeklySchedule* schedule = scheduleFor(key);
+    if (schedule == nullptr) {
+      Serial.printf("Bad UID or too many schedules, ignoring: %s\n", key);
+      continue;
+    }
+
+    uint16_t first = (start + SCHEDULE_SLOT_MINUTES - 1) / SCHEDULE_SLOT_MINUTES;
+    uint16_t last = end / SCHEDULE_SLOT_MINUTES; // exclusive
+    uint16_t length = end > start ? (last > first ? last - first : 0)
+                                  : SCHEDULE_SLOTS_PER_DAY - first + last;
+    for (uint8_t day = 0; day < 7; day++)
+      if (days[day] != '-')
+        setSlots(schedule, day * SCHEDULE_SLOTS_PER_DAY + first, length);
+  }
+  file.close();
+
+  Serial.printf("Schedules loaded: %u roles, %u users\n", roleScheduleCount, userScheduleCount);
+  return true;
+}
+
+/**
+ * @brief Maps a local epoch time to its slot in the weekly bitmap.
+ */
+uint16_t scheduleSlotAt(uint32_t localEpoch) {
+  uint32_t days = localEpoch / 86400UL;
+  uint16_t weekday = (days + 3) % 7; // 1970-01-01 was a Thursday, Monday = 0
+  uint16_t slotOfDay = (localEpoch % 86400UL) / (SCHEDULE_SLOT_MINUTES * 60);
+  return weekday * SCHEDULE_SLOTS_PER_DAY + slotOfDay;
+}
+
+/**
+ * @brief Whether the UID has schedule lines of its own (as opposed to its role's).
+ */
+bool hasUserSchedule(const UidKey& uid) {
+  for (uint8_t i = 0; i < userScheduleCount; i++)
+    if (userSchedules[i].uid == uid)
+      return true;
+  return false;
+}
+
+/**
+ * @brief Checks whether the card may open the door right now.
+ *
+ * Only a slot computation and a single bit test once the bitmap is found, so it
+ * can sit on the unlock path. Until the clock has been set from the portal (the
+ * lock has no other time source after a reboot) cards that have a schedule are
+ * denied; cards without one are not affected.
+ *
+ * @param uid  The card's packed UID.
+ * @param cred The card's credential entry.
+ *
+ * @return true  If there is no schedule for the card/role or the current slot is allowed.
+ * @return false If the current slot is outside the schedule, or the clock is not set.
+ */
+bool scheduleAllows(const UidKey& uid, const Credential& cred) {
+  const WeeklySchedule* schedule = nullptr;
+  if (cred.flags & CRED_OWN_SCHEDULE)
+    for (uint8_t i = 0; i < userScheduleCount && schedule == nullptr; i++)
+      if (userSchedules[i].uid == uid)
+        schedule = &userSchedules[i].schedule;
+  for (uint8_t i = 0; i < roleScheduleCount && schedule == nullptr; i++)
+    if (roleSchedules[i].role == cred.role)
+      schedule = &roleSchedules[i].schedule;
+
+  if (schedule == nullptr)
+    return true;
+
+  if (!clockIsSet()) {
+    if (!warnedClockUnset) {
+      Serial.println("Clock not set, denying cards that have a schedule until it is");
+      warnedClockUnset = true;
+    }
+    return false;
+  }
+
+  uint16_t slot = scheduleSlotAt(clockNow());
+  return schedule->bits[slot >> 3] & (1 << (slot & 7));
+}
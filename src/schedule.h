@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "credstore.h"
+
+// weekly access schedules, compiled into one bit per 15-minute slot (Monday 00:00 = slot 0)
+const uint8_t SCHEDULE_SLOT_MINUTES = 15;
+const uint16_t SCHEDULE_SLOTS_PER_DAY = 24 * 60 / SCHEDULE_SLOT_MINUTES;
+const uint16_t SCHEDULE_SLOTS = 7 * SCHEDULE_SLOTS_PER_DAY;
+
+const uint8_t MAX_ROLE_SCHEDULES = 8;
+const uint8_t MAX_USER_SCHEDULES = 16;
+
+struct WeeklySchedule {
+  uint8_t bits[SCHEDULE_SLOTS / 8];
+};
+
+bool loadSchedules();
+bool hasUserSchedule(const UidKey& uid);
+bool scheduleAllows(const UidKey& uid, const Credential& cred);
+uint16_t scheduleSlotAt(uint32_t localEpoch);
@@ -0,0 +1,180 @@
+#include "securecard.h"
+
+#include <LittleFS.h>
+#include <bearssl/bearssl_hmac.h>
+
+#include "csvreader.h"
+
+const uint8_t MIFARE_1K_SECTORS = 16;
+const uint8_t MAX_SECRET_BYTES = 32;
+
+static bool enabled = false;
+static uint8_t sector = 1;
+static unsigned long budgetUs = SECURE_DEFAULT_BUDGET_MS * 1000UL;
+static MFRC522::MIFARE_Key siteKey;
+// HMAC-SHA256 inner and outer pad states, computed once at boot
+static br_hmac_key_context macKey;
+
+static bool provisioning = false;
+static UidKey provisionUid;
+
+// parses exactly `length` bytes of hex digits
+static bool parseHexBytes(const char* text, uint8_t* bytes, uint8_t length) {
+  if (strlen(text) != (size_t)length * 2)
+    return false;
+  for (uint8_t i = 0; i < length; i++) {
+    char pair[3] = {text[2 * i], text[2 * i + 1], '\0'};
+    if (!isxdigit((uint8_t)pair[0]) || !isxdigit((uint8_t)pair[1]))
+      return false;
+    bytes[i] = strtoul(pair, nullptr, 16);
+  }
+  return true;
+}
+
+/**
+ * @brief Loads the card authentication settings from `/secure.txt`.
+ *
+ * One `SETTING,VALUE` pair per line:
+ * - `sector`: MIFARE Classic 1K sector holding the credential block (default 1)
+ * - `key`: the site's 6-byte key A for that sector, in hex
+ * - `secret`: the HMAC secret, 1 to 32 bytes in hex
+ * - `budget`: time allowed for authenticating one card, in ms (default 50)
+ *
+ * Without the file, or without `key` and `secret`, access stays UID-only. The
+ * HMAC key schedule is computed here so each card only costs two SHA-256 blocks.
+ *
+ * @return true  If card authentication is enabled.
+ * @return false If it is off or the file is invalid.
+ */
+bool loadSecureConfig() {
+  enabled = false;
+  sector = 1;
+  budgetUs = SECURE_DEFAULT_BUDGET_MS * 1000UL;
+  if (!LittleFS.exists("/secure.txt"))
+    return false;
+
+  File file = LittleFS.open("/secure.txt", "r");
+  if (!file) {
+    Serial.println("Failed to open secure card file for reading");
+    return false;
+  }
+
+  bool haveKey = false;
+  uint8_t secret[MAX_SECRET_BYTES];
+  uint8_t secretLength = 0;
+
+  CsvReader reader(file);
+  while (reader.next()) {
+    const char* setting = reader.field(0);
+    const char* value = reader.field(1);
+    if (setting[0] == '#')
+      continue;
+
+    bool ok = reader.fieldCount() == 2;
+    if (ok && strcmp(setting, "sector") == 0) {
+      int number = atoi(value);
+      ok = number > 0 && number < MIFARE_1K_SECTORS;
+      if (ok)
+        sector = number;
+    } else if (ok && strcmp(setting, "key") == 0) {
+      ok = haveKey = parseHexBytes(value, siteKey.keyByte, sizeof(siteKey.keyByte));
+    } else if (ok && strcmp(setting, "secret") == 0) {
+      secretLength = strlen(value) / 2;
+      ok = secretLength > 0 && secretLength <= MAX_SECRET_BYTES &&
+           parseHexBytes(value, secret, secretLength);
+      if (!ok)
+        secretLength = 0;
+    } else if (ok && strcmp(setting, "budget") == 0) {
+      unsigned long ms = strtoul(value, nullptr, 10);
+      ok = ms > 0;
+      if (ok)
+        budgetUs = ms * 1000UL;
+    } else {
+      ok = false;
+    }
+
+    if (!ok)
+      Serial.printf("Ignoring bad secure card line: %s\n", setting);
+  }
+  file.close();
+
+  if (!haveKey || secretLength == 0) {
+    Serial.println("Secure card file needs a key and a secret, cards are checked by UID only");
+    return false;
+  }
+
+  br_hmac_key_init(&macKey, &br_sha256_vtable, secret, secretLength);
+  memset(secret, 0, sizeof(secret));
+  enabled = true;
+  Serial.printf("Secure cards enabled: sector %u, budget %lu ms\n", sector, budgetUs / 1000);
+  return true;
+}
+
+bool secureCardsEnabled() {
+  return enabled;
+}
+
+// the sector's first data block carries the credential
+uint8_t secureDataBlock() {
+  return sector * 4;
+}
+
+uint8_t secureTrailerBlock() {
+  return sector * 4 + 3;
+}
+
+MFRC522::MIFARE_Key* secureSiteKey() {
+  return &siteKey;
+}
+
+unsigned long secureBudgetUs() {
+  return budgetUs;
+}
+
+/**
+ * @brief Computes the credential block a card must carry: HMAC-SHA256 of its UID, truncated.
+ *
+ * @param block Receives @ref SECURE_BLOCK_SIZE bytes.
+ */
+void secureCredentialBlock(const UidKey& uid, uint8_t* block) {
+  uint8_t bytes[UID_MAX_BYTES];
+  uidKeyBytes(uid, bytes);
+
+  br_hmac_context mac;
+  br_hmac_init(&mac, &macKey, SECURE_BLOCK_SIZE);
+  br_hmac_update(&mac, bytes, uidKeyLength(uid));
+  br_hmac_out(&mac, block);
+}
+
+/**
+ * @brief Checks a block read from the card against the expected MAC, in constant time.
+ */
+bool verifyCredentialBlock(const UidKey& uid, const uint8_t* block) {
+  uint8_t expected[SECURE_BLOCK_SIZE];
+  secureCredentialBlock(uid, expected);
+
+  uint8_t diff = 0;
+  for (uint8_t i = 0; i < SECURE_BLOCK_SIZE; i++)
+    diff |= expected[i] ^ block[i];
+  return diff == 0;
+}
+
+/**
+ * @brief Arms writing the credential block to the given card the next time a reader selects it.
+ */
+void requestProvisioning(const UidKey& uid) {
+  provisionUid = uid;
+  provisioning = true;
+}
+
+bool provisioningPending(const UidKey& uid) {
+  return provisioning && provisionUid == uid;
+}
+
+void provisioningDone(bool written) {
+  provisioning = false;
+  char uidText[UID_TEXT_SIZE];
+  formatUidKey(provisionUid, uidText);
+  Serial.printf("Credential block %s %s\n", written ? "written to" : "could not be written to",
+                uidText);
+}
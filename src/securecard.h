@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MFRC522.h>
+
+#include "uidkey.h"
+
+// optional card authentication: a MIFARE Classic sector holding an HMAC of the UID
+const uint8_t SECURE_BLOCK_SIZE = 16;
+const unsigned long SECURE_DEFAULT_BUDGET_MS = 50;
+
+bool loadSecureConfig();
+bool secureCardsEnabled();
+uint8_t secureDataBlock();
+uint8_t secureTrailerBlock();
+MFRC522::MIFARE_Key* secureSiteKey();
+unsigned long secureBudgetUs();
+
+void secureCredentialBlock(const UidKey& uid, uint8_t* block);
+bool verifyCredentialBlock(const UidKey& uid, const uint8_t* block);
+
+void requestProvisioning(const UidKey& uid);
+bool provisioningPending(const UidKey& uid);
+void provisioningDone(bool written);
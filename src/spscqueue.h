@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * Fixed-size single-producer/single-consumer queue.
+ *
+ * The producer only writes `head`, the consumer only writes `tail`, so one
+ * side may run in an interrupt while the other runs in loop(). Items are copied
+ * in and out; nothing is allocated. `N` must be a power of two up to 128.
+ * push() and pop() are always inlined so an IRAM interrupt handler can use them.
+ */
+template <typename T, uint8_t N> class SpscQueue {
+  static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+  /**
+   * @brief Appends an item (producer side).
+   *
+   * @return false If the queue was full; the item is dropped and counted.
+   */
+  __attribute__((always_inline)) bool push(const T& item) {
+    uint8_t at = head;
+    if ((uint8_t)(at - tail) == N) {
+      drops++;
+      return false;
+    }
+    items[at & (N - 1)] = item;
+    std::atomic_signal_fence(std::memory_order_release);
+    head = at + 1;
+    return true;
+  }
+
+  /**
+   * @brief Takes the oldest item (consumer side).
+   *
+   * @return false If the queue was empty.
+   */
+  __attribute__((always_inline)) bool pop(T* item) {
+    uint8_t at = tail;
+    if (at == head)
+      return false;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    *item = items[at & (N - 1)];
+    std::atomic_signal_fence(std::memory_order_release);
+    tail = at + 1;
+    return true;
+  }
+
+  bool empty() const {
+    return head == tail;
+  }
+
+  uint8_t size() const {
+    return (uint8_t)(head - tail);
+  }
+
+  // items dropped because the queue was full
+  uint32_t dropped() const {
+    return drops;
+  }
+
+private:
+  T items[N];
+  volatile uint8_t head = 0;
+  volatile uint8_t tail = 0;
+  uint32_t drops = 0;
+};
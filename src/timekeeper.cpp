@@ -0,0 +1,53 @@
+#include "timekeeper.h"
+
+static bool clockSet = false;
+static uint32_t clockBase = 0;     // local epoch seconds at clockBaseMillis
+static unsigned long clockBaseMillis = 0;
+
+/**
+ * @brief Sets the local wall-clock time.
+ *
+ * @param localEpoch Seconds since 1970-01-01 00:00 in the door's local time zone
+ *                   (the portal sends the browser's local time, not UTC).
+ */
+void setClock(uint32_t localEpoch) {
+  clockBase = localEpoch;
+  clockBaseMillis = millis();
+  clockSet = true;
+  Serial.printf("Clock set to %lu\n", (unsigned long)localEpoch);
+}
+
+bool clockIsSet() {
+  return clockSet;
+}
+
+/**
+ * @brief Folds whole elapsed seconds into the clock base.
+ *
+ * Keeps the millis() delta small so the clock survives the 49-day millis() wrap.
+ * Call it regularly from loop().
+ */
+void updateClock() {
+  unsigned long elapsed = millis() - clockBaseMillis;
+  if (elapsed < 1000)
+    return;
+
+  uint32_t seconds = elapsed / 1000;
+  clockBase += seconds;
+  clockBaseMillis += seconds * 1000UL;
+}
+
+/**
+ * @brief Carries the clock over a light sleep, during which millis() stands still.
+ */
+void clockSlept(unsigned long ms) {
+  clockBaseMillis -= ms;
+}
+
+/**
+ * @return uint32_t Local epoch seconds, or seconds since boot if the clock was never set.
+ */
+uint32_t clockNow() {
+  updateClock();
+  return clockBase;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Arduino.h>
+
+// There is no RTC or NTP on the lock: local wall-clock time is set through the
+// registration portal and then carried forward with millis().
+
+void setClock(uint32_t localEpoch);
+bool clockIsSet();
+uint32_t clockNow();
+void updateClock();
+void clockSlept(unsigned long ms);
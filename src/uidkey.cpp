@@ -0,0 +1,128 @@
+#include "uidkey.h"
+
+/**
+ * @brief Packs raw UID bytes (as read from the card) into a key.
+ *
+ * @param bytes  UID bytes, most significant first as the card sends them.
+ * @param length Number of bytes (4, 7 or 10; longer input is truncated).
+ */
+UidKey makeUidKey(const uint8_t* bytes, uint8_t length) {
+  if (length > UID_MAX_BYTES)
+    length = UID_MAX_BYTES;
+
+  UidKey key = {0, (uint64_t)length << 56};
+  for (uint8_t i = 0; i < length; i++) {
+    if (i < 8)
+      key.lo |= (uint64_t)bytes[i] << (8 * i);
+    else
+      key.hi |= (uint64_t)bytes[i] << (8 * (i - 8));
+  }
+  return key;
+}
+
+/**
+ * @brief Unpacks a key back into its UID bytes.
+ *
+ * @param bytes Output buffer of at least @ref UID_MAX_BYTES bytes.
+ */
+void uidKeyBytes(const UidKey& key, uint8_t* bytes) {
+  uint8_t length = uidKeyLength(key);
+  for (uint8_t i = 0; i < length; i++)
+    bytes[i] = i < 8 ? key.lo >> (8 * i) : key.hi >> (8 * (i - 8));
+}
+
+static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// value of every 7-bit character as a hex digit, -1 if it is not one
+struct HexValues {
+  int8_t value[128];
+
+  constexpr HexValues() : value() {
+    for (int c = 0; c < 128; c++)
+      value[c] = c >= '0' && c <= '9'   ? c - '0'
+                 : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                 : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                        : -1;
+  }
+};
+
+static constexpr HexValues HEX_VALUES;
+
+static inline int hexValue(char c) {
+  return (uint8_t)c < 128 ? HEX_VALUES.value[(uint8_t)c] : -1;
+}
+
+/**
+ * @brief Parses a UID string such as "AA:BB:CC:DD" (any case, ':' optional).
+ *
+ * Leading and trailing whitespace is ignored.
+ *
+ * @return true  If the text held 1 to 10 well-formed hex bytes.
+ * @return false Otherwise; `key` is left untouched.
+ */
+bool parseUidKey(const char* text, UidKey* key) {
+  uint8_t bytes[UID_MAX_BYTES];
+  uint8_t length = 0;
+
+  while (*text == ' ' || *text == '\t')
+    text++;
+
+  while (*text != '\0' && *text != ' ' && *text != '\t' && *text != '\r' && *text != '\n') {
+    int high = hexValue(text[0]);
+    int low = high == -1 ? -1 : hexValue(text[1]);
+    if (low == -1 || length == UID_MAX_BYTES)
+      return false;
+
+    bytes[length++] = (high << 4) | low;
+    text += 2;
+    if (*text == ':')
+      text++;
+  }
+
+  if (length == 0)
+    return false;
+
+  *key = makeUidKey(bytes, length);
+  return true;
+}
+
+/**
+ * @brief Formats a key as "AA:BB:CC:DD" into a caller buffer.
+ *
+ * Each byte is two lookups in a nibble table; nothing is allocated.
+ *
+ * @param text Output buffer of at least @ref UID_TEXT_SIZE bytes, always terminated.
+ *
+ * @return uint8_t Length of the text, without the terminator.
+ */
+uint8_t formatUidKey(const UidKey& key, char* text) {
+  uint8_t bytes[UID_MAX_BYTES];
+  uint8_t length = uidKeyLength(key);
+  uidKeyBytes(key, bytes);
+
+  char* out = text;
+  for (uint8_t i = 0; i < length; i++) {
+    if (i > 0)
+      *out++ = ':';
+    *out++ = HEX_DIGITS[bytes[i] >> 4];
+    *out++ = HEX_DIGITS[bytes[i] & 0x0F];
+  }
+  *out = '\0';
+  return out - text;
+}
+
+/**
+ * @brief Seeded hash of a packed key (murmur3 finalizer over both words).
+ *
+ * tools/mkphf.py carries an exact copy; keep the two in sync or perfect-hash
+ * images built offline will stop matching.
+ */
+uint32_t uidKeyHash(const UidKey& key, uint32_t seed) {
+  uint64_t h = key.lo ^ (key.hi * 0x9E3779B97F4A7C15ULL) ^ seed;
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
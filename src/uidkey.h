@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+const uint8_t UID_MAX_BYTES = 10;
+// "AA:BB:...:JJ" for the longest UID, plus the terminator
+const uint8_t UID_TEXT_SIZE = UID_MAX_BYTES * 3;
+
+/**
+ * Packed card UID used for every comparison and lookup.
+ *
+ * Bytes 0..7 live in `lo`, bytes 8..9 in the low bits of `hi` and the UID
+ * length in the top byte of `hi`, so two keys are equal exactly when both words
+ * are. A 4-byte UID only uses the low 32 bits of `lo`.
+ */
+struct UidKey {
+  uint64_t lo;
+  uint64_t hi;
+};
+
+inline bool operator==(const UidKey& a, const UidKey& b) {
+  return a.lo == b.lo && a.hi == b.hi;
+}
+
+inline bool operator!=(const UidKey& a, const UidKey& b) {
+  return !(a == b);
+}
+
+inline bool operator<(const UidKey& a, const UidKey& b) {
+  return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+inline uint8_t uidKeyLength(const UidKey& key) {
+  return key.hi >> 56;
+}
+
+UidKey makeUidKey(const uint8_t* bytes, uint8_t length);
+void uidKeyBytes(const UidKey& key, uint8_t* bytes);
+bool parseUidKey(const char* text, UidKey* key);
+uint8_t formatUidKey(const UidKey& key, char* text);
+uint32_t uidKeyHash(const UidKey& key, uint32_t seed);
@@ -0,0 +1,179 @@
+#include <Adafruit_PN532.h>
+#include <MFRC522.h> // hostCard() for UID parsing
+
+namespace {
+
+struct FieldCard {
+  uint8_t uid[10];
+  uint8_t length;
+  bool listed; // selected by InListPassiveTarget, not yet released
+};
+
+std::vector<FieldCard> field;
+uint32_t releases = 0;
+bool responding = true;
+
+// the answer of the running InListPassiveTarget
+struct Answer {
+  bool running = false;
+  uint64_t readyAtUs = 0; // UINT64_MAX: never, with endless retries on an empty field
+  uint8_t uid[10];
+  uint8_t length = 0;
+} answer;
+
+// a new command aborts the running one
+void command() {
+  hostAdvanceMicros(HOST_PN532_COMMAND_US);
+  answer.running = false;
+}
+
+// the status byte after a status read (0x02) on the PN532's chip select
+class StatusPort : public HostSpiDevice {
+public:
+  explicit StatusPort(uint8_t csPin) : HostSpiDevice(csPin) {}
+
+  void frameStart() override {
+    first = true;
+  }
+
+  uint8_t transfer(uint8_t out, uint32_t clock) override {
+    (void)clock;
+    if (first) {
+      first = false;
+      statusRead = out == 0x02;
+      return 0xFF;
+    }
+    if (!responding || !statusRead)
+      return 0xFF;
+    return answer.running && hostMicros() >= answer.readyAtUs ? 0x01 : 0x00;
+  }
+
+private:
+  bool first = true;
+  bool statusRead = false;
+};
+
+uint32_t listedCount() {
+  uint32_t count = 0;
+  for (const FieldCard& card : field)
+    count += card.listed;
+  return count;
+}
+
+} // namespace
+
+Adafruit_PN532::Adafruit_PN532(uint8_t ss, SPIClass* theSPI) {
+  (void)theSPI;
+  hostHeapPause(true);
+  hostSpiAttach(new StatusPort(ss));
+  hostHeapPause(false);
+}
+
+bool Adafruit_PN532::begin() {
+  command();
+  return true;
+}
+
+uint32_t Adafruit_PN532::getFirmwareVersion() {
+  command();
+  return responding ? 0x32010607UL : 0; // PN532, firmware 1.6
+}
+
+bool Adafruit_PN532::SAMConfig() {
+  command();
+  return responding;
+}
+
+bool Adafruit_PN532::setPassiveActivationRetries(uint8_t maxRetries) {
+  command();
+  retries = maxRetries;
+  return responding;
+}
+
+// sends the command and takes its ACK; the PN532 lists at most two targets, and a listed
+// card is selected and ignores WUPA
+bool Adafruit_PN532::startPassiveTargetIDDetection(uint8_t cardbaudrate) {
+  (void)cardbaudrate;
+  command();
+  if (!responding)
+    return false;
+
+  answer.running = true;
+  answer.length = 0;
+  if (listedCount() < 2) {
+    for (FieldCard& card : field) {
+      if (card.listed)
+        continue;
+      card.listed = true;
+      memcpy(answer.uid, card.uid, card.length);
+      answer.length = card.length;
+      answer.readyAtUs = hostMicros() + HOST_PN532_LIST_US;
+      return true;
+    }
+  }
+
+  // nobody answered: every retry costs an activation attempt, 0xFF retries forever
+  answer.readyAtUs = retries == 0xFF ? UINT64_MAX
+                                     : hostMicros() + (retries + 1ULL) * HOST_PN532_RETRY_US;
+  return true;
+}
+
+// reads the answer frame whether or not it is ready, as the library does
+bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t* uid, uint8_t* uidLength) {
+  hostAdvanceMicros(HOST_PN532_COMMAND_US);
+  bool ready = responding && answer.running && hostMicros() >= answer.readyAtUs;
+  answer.running = false;
+  *uidLength = 0;
+  if (!ready || answer.length == 0)
+    return false;
+  memcpy(uid, answer.uid, answer.length);
+  *uidLength = answer.length;
+  return true;
+}
+
+bool Adafruit_PN532::inRelease(const uint8_t relevantTarget) {
+  (void)relevantTarget; // the firmware only ever releases all (0)
+  command();
+  releases++;
+  for (FieldCard& card : field)
+    card.listed = false;
+  return responding;
+}
+
+void hostPn532AddCard(const char* uidText) {
+  HostCard parsed = hostCard(uidText);
+  FieldCard card = {};
+  memcpy(card.uid, parsed.uid, parsed.length);
+  card.length = parsed.length;
+  hostHeapPause(true);
+  field.push_back(card);
+  hostHeapPause(false);
+}
+
+bool hostPn532RemoveCard(const char* uidText) {
+  HostCard parsed = hostCard(uidText);
+  for (size_t i = 0; i < field.size(); i++) {
+    if (field[i].length == parsed.length && memcmp(field[i].uid, parsed.uid, parsed.length) == 0) {
+      field.erase(field.begin() + i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void hostPn532ClearField() {
+  field.clear();
+  answer.running = false;
+}
+
+uint8_t hostPn532Listed() {
+  return listedCount();
+}
+
+uint32_t hostPn532Releases() {
+  return releases;
+}
+
+void hostPn532Responding(bool value) {
+  responding = value;
+}
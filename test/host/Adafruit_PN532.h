@@ -0,0 +1,43 @@
+#pragma once
+
+// Host stand-in for Adafruit-PN532 and the PN532 behind it. Only what the
+// firmware calls is here. InListPassiveTarget wakes any card in the field that
+// is not already a listed target; a listed card stays selected, and silent,
+// until InRelease. Its answer is ready after the time the PN532 would spend on
+// the field, and the chip's SPI status byte says when. Each command moves the
+// fake clock by a typical duration.
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#define PN532_MIFARE_ISO14443A (0x00)
+
+// rough command times of a PN532 on SPI
+const uint32_t HOST_PN532_LIST_US = 3000;   // InListPassiveTarget that found a card
+const uint32_t HOST_PN532_RETRY_US = 1800;  // one activation attempt on an empty field
+const uint32_t HOST_PN532_COMMAND_US = 600; // a short command (InRelease, version, ...)
+
+class Adafruit_PN532 {
+public:
+  Adafruit_PN532(uint8_t ss, SPIClass* theSPI = &SPI);
+
+  bool begin();
+  uint32_t getFirmwareVersion();
+  bool SAMConfig();
+  bool setPassiveActivationRetries(uint8_t maxRetries);
+  bool startPassiveTargetIDDetection(uint8_t cardbaudrate);
+  bool readDetectedPassiveTargetID(uint8_t* uid, uint8_t* uidLength);
+  bool inRelease(const uint8_t relevantTarget = 0);
+
+private:
+  uint8_t retries = 0xFF;
+};
+
+// ---- test controls, for the one PN532 on the bus ----
+
+void hostPn532AddCard(const char* uidText);
+bool hostPn532RemoveCard(const char* uidText);
+void hostPn532ClearField();
+uint8_t hostPn532Listed();                 // targets listed and not yet released
+uint32_t hostPn532Releases();              // InRelease commands since start
+void hostPn532Responding(bool responding); // false: no answer, as with a dead chip
@@ -0,0 +1,476 @@
+#include <Arduino.h>
+#include <coredecls.h>
+#include <gpio.h>
+#include <user_interface.h>
+
+#include <chrono>
+#include <new>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static uint64_t nowUs = 0;
+
+struct HostPin {
+  uint8_t level = HIGH; // inputs idle high, as with the pull-ups
+  uint32_t writes = 0;
+  void (*isr)() = nullptr;
+  int isrMode = 0;
+  bool traced = true; // changes go to hostPinEvents()
+};
+
+static HostPin pins[HOST_PINS];
+static uint32_t analogRange = 255;
+static uint32_t analogFrequency = 1000; // the core's default
+static std::vector<HostPinEvent> pinEvents;
+
+static std::string serialInput;
+static std::string serialOutput;
+static bool serialQuiet = false;
+const size_t SERIAL_OUTPUT_KEPT = 64 * 1024;
+
+// ---- String: digits in lower case, as the core's utoa() gives them ----
+
+String::String(unsigned char value, unsigned char base) {
+  char digits[9];
+  char* out = digits + sizeof(digits);
+  *--out = '\0';
+  do {
+    *--out = "0123456789abcdefghijklmnopqrstuvwxyz"[value % base];
+    value /= base;
+  } while (value != 0);
+  text = out;
+}
+
+void String::toUpperCase() {
+  for (char& c : text)
+    c = toupper((unsigned char)c);
+}
+
+// ---- Print and Stream ----
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  while (written < size && write(buffer[written]))
+    written++;
+  return written;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char line[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length < 0)
+    return 0;
+  if ((size_t)length < sizeof(line))
+    return write((const uint8_t*)line, length);
+
+  hostHeapPause(true);
+  std::vector<char> longer(length + 1);
+  va_start(args, format);
+  vsnprintf(longer.data(), longer.size(), format, args);
+  va_end(args);
+  size_t written = write((const uint8_t*)longer.data(), length);
+  hostHeapPause(false);
+  return written;
+}
+
+size_t Print::print(const char* text) {
+  return write((const uint8_t*)text, strlen(text));
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", value);
+  return print(text);
+}
+
+size_t Print::print(long value, int base) {
+  if (base == HEX)
+    return print((unsigned long)value, base);
+  char text[24];
+  snprintf(text, sizeof(text), "%ld", value);
+  return print(text);
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  int c;
+  while (count < length && (c = read()) >= 0)
+    buffer[count++] = c;
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+  size_t count = 0;
+  int c;
+  while (count < length && (c = read()) >= 0 && c != terminator)
+    buffer[count++] = c;
+  return count;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (!serialQuiet)
+    fwrite(buffer, 1, size, stdout);
+  hostHeapPause(true);
+  if (serialOutput.size() + size > SERIAL_OUTPUT_KEPT)
+    serialOutput.erase(0, std::min(serialOutput.size(), SERIAL_OUTPUT_KEPT / 2 + size));
+  serialOutput.append((const char*)buffer, size);
+  hostHeapPause(false);
+  return size;
+}
+
+int HardwareSerial::available() {
+  return serialInput.size();
+}
+
+int HardwareSerial::read() {
+  if (serialInput.empty())
+    return -1;
+  uint8_t c = serialInput[0];
+  hostHeapPause(true);
+  serialInput.erase(0, 1);
+  hostHeapPause(false);
+  return c;
+}
+
+int HardwareSerial::peek() {
+  return serialInput.empty() ? -1 : (uint8_t)serialInput[0];
+}
+
+// ---- time: 32-bit like the ESP8266's, so wrap-around arithmetic behaves the same ----
+
+unsigned long millis() {
+  return (uint32_t)(nowUs / 1000);
+}
+
+unsigned long micros() {
+  return (uint32_t)nowUs;
+}
+
+// ---- timer0: armed against the fake clock, run when an advance passes it ----
+
+static timercallback timer0Isr = nullptr;
+static bool timer0Armed = false;
+static uint32_t armedSleeps = 0; // light sleeps begun while timer0 was armed
+static uint64_t timer0DueUs = 0;
+static uint32_t lastCycleCount = 0; // the reading timer0_write() counts from
+
+// moves the clock forward, stopping on the way to run timer0 if it comes due
+static void advance(uint64_t us) {
+  uint64_t target = nowUs + us;
+  while (timer0Armed && timer0DueUs <= target) {
+    timer0Armed = false;
+    nowUs = max(nowUs, timer0DueUs);
+    if (timer0Isr != nullptr)
+      timer0Isr();
+  }
+  nowUs = target;
+}
+
+void timer0_isr_init() {}
+
+void timer0_attachInterrupt(timercallback userFunc) {
+  timer0Isr = userFunc;
+}
+
+void timer0_detachInterrupt() {
+  timer0Isr = nullptr;
+  timer0Armed = false;
+}
+
+// the firmware writes a count it just computed from ESP.getCycleCount()
+void timer0_write(uint32_t count) {
+  timer0DueUs = nowUs + (uint32_t)(count - lastCycleCount) / clockCyclesPerMicrosecond();
+  timer0Armed = true;
+}
+
+void delay(unsigned long ms) {
+  advance(ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+  advance(us);
+}
+
+void yield() {}
+
+// ---- pins ----
+
+void pinMode(uint8_t, uint8_t) {}
+
+static void recordPin(uint8_t pin, uint32_t value, bool pwm) {
+  if (!pins[pin].traced)
+    return;
+  hostHeapPause(true);
+  pinEvents.push_back({nowUs, pin, value, pwm});
+  hostHeapPause(false);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= HOST_PINS)
+    return;
+  pins[pin].level = level ? HIGH : LOW;
+  pins[pin].writes++;
+  recordPin(pin, level ? analogRange : 0, false);
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < HOST_PINS ? pins[pin].level : LOW;
+}
+
+void analogWrite(uint8_t pin, int value) {
+  if (pin >= HOST_PINS)
+    return;
+  pins[pin].level = value > 0 ? HIGH : LOW;
+  recordPin(pin, value, true);
+}
+
+void analogWriteRange(uint32_t range) {
+  analogRange = range;
+}
+
+void analogWriteFreq(uint32_t frequency) {
+  analogFrequency = frequency;
+}
+
+void tone(uint8_t, unsigned int, unsigned long) {}
+
+void noTone(uint8_t) {}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  if (pin < HOST_PINS) {
+    pins[pin].isr = isr;
+    pins[pin].isrMode = mode;
+  }
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < HOST_PINS)
+    pins[pin].isr = nullptr;
+}
+
+void noInterrupts() {}
+
+void interrupts() {}
+
+// ---- heap: every operator new is counted, except while the fakes allocate for themselves ----
+
+static uint32_t heapInUse = 0;
+static uint32_t heapAllocations = 0;
+static uint8_t heapPaused = 0; // nesting depth of hostHeapPause(true)
+
+// the block size sits in front of each block, so delete knows what to give back
+struct alignas(std::max_align_t) HeapHeader {
+  size_t size;
+  bool counted;
+};
+
+void* operator new(size_t size) {
+  HeapHeader* header = (HeapHeader*)malloc(sizeof(HeapHeader) + size);
+  if (header == nullptr)
+    throw std::bad_alloc();
+  header->size = size;
+  header->counted = !heapPaused;
+  if (header->counted) {
+    heapInUse += size;
+    heapAllocations++;
+  }
+  return header + 1;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+  if (block == nullptr)
+    return;
+  HeapHeader* header = (HeapHeader*)block - 1;
+  if (header->counted)
+    heapInUse -= header->size;
+  free(header);
+}
+
+void operator delete[](void* block) noexcept {
+  operator delete(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return heapInUse < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - heapInUse : 0;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize() {
+  return getFreeHeap();
+}
+
+uint8_t EspClass::getHeapFragmentation() {
+  return 0;
+}
+
+uint32_t EspClass::getCycleCount() {
+  lastCycleCount = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+  return lastCycleCount;
+}
+
+// ---- light sleep: millis() stands still, only the RTC counts the sleep ----
+
+static uint64_t sleptUs = 0;
+static uint32_t sleepRequestUs = 0;
+static void (*sleepWakeup)() = nullptr;
+
+bool EspClass::forcedLightSleepBegin(uint32_t duration_us, void (*wakeupCb)()) {
+  if (hostTimer0Armed())
+    armedSleeps++;
+  sleepRequestUs = duration_us;
+  sleepWakeup = wakeupCb;
+  return true;
+}
+
+void EspClass::forcedLightSleepEnd(bool) {
+  sleepRequestUs = 0;
+}
+
+// a requested sleep runs to its end: nothing can pull the wake pin low meanwhile
+void esp_delay(uint32_t timeout_ms, const std::function<bool()>& blocked, uint32_t) {
+  if (sleepRequestUs > 0) {
+    sleptUs += sleepRequestUs;
+    sleepRequestUs = 0;
+    if (sleepWakeup != nullptr)
+      sleepWakeup();
+    return;
+  }
+  for (uint32_t waited = 0; waited < timeout_ms && blocked(); waited++)
+    advance(1000);
+}
+
+void esp_schedule() {}
+
+uint32_t system_get_rtc_time() {
+  return (uint32_t)(nowUs + sleptUs); // one tick per µs, see system_rtc_clock_cali_proc()
+}
+
+uint32_t system_rtc_clock_cali_proc() {
+  return 1 << 12; // µs per tick, Q12
+}
+
+void gpio_pin_wakeup_enable(uint32_t, GPIO_INT_TYPE) {}
+
+void gpio_pin_wakeup_disable() {}
+
+// ---- test controls ----
+
+void hostAdvanceMicros(uint64_t us) {
+  advance(us);
+}
+
+void hostAdvanceMillis(uint64_t ms) {
+  advance(ms * 1000ULL);
+}
+
+uint64_t hostMicros() {
+  return nowUs;
+}
+
+uint64_t hostRtcMicros() {
+  return nowUs + sleptUs;
+}
+
+uint64_t hostSleptMicros() {
+  return sleptUs;
+}
+
+uint32_t hostArmedSleeps() {
+  return armedSleeps;
+}
+
+bool hostTimer0Armed() {
+  return timer0Armed && timer0Isr != nullptr;
+}
+
+void hostSetPin(uint8_t pin, uint8_t level) {
+  HostPin& state = pins[pin];
+  bool changed = state.level != level;
+  state.level = level;
+  if (state.isr == nullptr)
+    return;
+  if (state.isrMode == CHANGE ? changed
+                              : state.isrMode == (level ? RISING : FALLING) && changed)
+    state.isr();
+}
+
+void hostTracePin(uint8_t pin, bool traced) {
+  if (pin < HOST_PINS)
+    pins[pin].traced = traced;
+}
+
+uint32_t hostPinWrites(uint8_t pin) {
+  return pin < HOST_PINS ? pins[pin].writes : 0;
+}
+
+uint32_t hostAnalogRange() {
+  return analogRange;
+}
+
+uint32_t hostAnalogFrequency() {
+  return analogFrequency;
+}
+
+const std::vector<HostPinEvent>& hostPinEvents() {
+  return pinEvents;
+}
+
+void hostClearPinEvents() {
+  pinEvents.clear();
+}
+
+void hostSerialInput(const char* text) {
+  hostHeapPause(true);
+  serialInput += text;
+  hostHeapPause(false);
+}
+
+void hostSerialQuiet(bool quiet) {
+  serialQuiet = quiet;
+}
+
+const std::string& hostSerialOutput() {
+  return serialOutput;
+}
+
+void hostClearSerialOutput() {
+  hostHeapPause(true);
+  serialOutput.clear();
+  hostHeapPause(false);
+}
+
+uint32_t hostHeapInUse() {
+  return heapInUse;
+}
+
+uint32_t hostHeapAllocations() {
+  return heapAllocations;
+}
+
+void hostHeapPause(bool paused) {
+  if (paused)
+    heapPaused++;
+  else if (heapPaused > 0)
+    heapPaused--;
+}
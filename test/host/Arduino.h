@@ -0,0 +1,235 @@
+#pragma once
+
+// Host stand-in for the parts of the ESP8266 Arduino core the firmware uses,
+// for the native test environment. Time only moves when a test advances it (or
+// the firmware calls delay()), pins are plain variables, and Serial writes to
+// stdout. The host* functions at the end are the tests' side of it.
+
+#include <algorithm>
+#include <cctype>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define DEC 10
+#define HEX 16
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+// NodeMCU pin names, as GPIO numbers
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+const uint8_t HOST_PINS = 17;
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define F(s) (s)
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define digitalPinToInterrupt(pin) (pin)
+#ifndef F_CPU
+#define F_CPU 80000000L
+#endif
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+using std::max;
+using std::min;
+
+class String {
+public:
+  String() {}
+  String(const char* text) : text(text ? text : "") {}
+  String(const std::string& text) : text(text) {}
+  explicit String(unsigned char value, unsigned char base = DEC);
+
+  const char* c_str() const {
+    return text.c_str();
+  }
+  unsigned length() const {
+    return text.size();
+  }
+  bool isEmpty() const {
+    return text.empty();
+  }
+  bool operator==(const char* other) const {
+    return text == other;
+  }
+  String& operator+=(const char* other) {
+    text += other;
+    return *this;
+  }
+  String& operator+=(const String& other) {
+    text += other.text;
+    return *this;
+  }
+  void toUpperCase();
+
+private:
+  std::string text;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* buffer, size_t size) {
+    return write((const uint8_t*)buffer, size);
+  }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* text);
+  size_t print(const String& text) {
+    return print(text.c_str());
+  }
+  size_t print(char c) {
+    return write((uint8_t)c);
+  }
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned value, int base = DEC) {
+    return print((unsigned long)value, base);
+  }
+  size_t print(int value, int base = DEC) {
+    return print((long)value, base);
+  }
+  size_t println() {
+    return write((const uint8_t*)"\r\n", 2);
+  }
+  template <typename T> size_t println(const T& value) {
+    return print(value) + println();
+  }
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    return readBytes((char*)buffer, length);
+  }
+  size_t readBytesUntil(char terminator, char* buffer, size_t length);
+  void setTimeout(unsigned long) {}
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+void analogWriteRange(uint32_t range);
+void analogWriteFreq(uint32_t frequency);
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+// timer0 fires once when the cycle counter reaches the value written, counted at F_CPU
+typedef void (*timercallback)(void);
+void timer0_isr_init();
+void timer0_attachInterrupt(timercallback userFunc);
+void timer0_detachInterrupt();
+void timer0_write(uint32_t count);
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMaxFreeBlockSize();
+  uint8_t getHeapFragmentation();
+  uint32_t getCycleCount(); // host CPU time, in ns at the 1000 MHz reported below
+  uint32_t getCpuFreqMHz() {
+    return 1000;
+  }
+  // the sleep only happens inside the esp_delay() that follows, see coredecls.h
+  bool forcedLightSleepBegin(uint32_t duration_us = 0, void (*wakeupCb)() = nullptr);
+  void forcedLightSleepEnd(bool cancel = false);
+};
+
+extern EspClass ESP;
+
+// ---- test controls ----
+
+const uint32_t HOST_HEAP_SIZE = 52 * 1024; // what a NodeMCU has free after boot
+
+// one change of an output pin; value is the analogWrite() value, or 0 / the
+// analogWrite range for digitalWrite()
+struct HostPinEvent {
+  uint64_t atUs;
+  uint8_t pin;
+  uint32_t value;
+  bool pwm;
+};
+
+void hostAdvanceMicros(uint64_t us);
+void hostAdvanceMillis(uint64_t ms);
+uint64_t hostMicros();
+uint64_t hostRtcMicros();   // awake time plus light sleep, as the RTC counts it
+uint64_t hostSleptMicros(); // light sleep since start
+bool hostTimer0Armed();     // attached and not fired yet
+uint32_t hostArmedSleeps(); // light sleeps begun with timer0 armed: its counter stops in them
+
+void hostSetPin(uint8_t pin, uint8_t level); // drives an input, running its interrupt
+uint32_t hostPinWrites(uint8_t pin);          // digitalWrite() calls, e.g. chip-select frames
+void hostTracePin(uint8_t pin, bool traced);  // e.g. off for a chip select in a long soak
+uint32_t hostAnalogRange();
+uint32_t hostAnalogFrequency();
+const std::vector<HostPinEvent>& hostPinEvents();
+void hostClearPinEvents();
+
+void hostSerialInput(const char* text);
+void hostSerialQuiet(bool quiet); // drops Serial output, e.g. during long soak runs
+// the last 64 KB written to Serial, quiet or not
+const std::string& hostSerialOutput();
+void hostClearSerialOutput();
+
+uint32_t hostHeapInUse();      // bytes the firmware holds through new/malloc
+uint32_t hostHeapAllocations(); // allocations made since start
+void hostHeapPause(bool paused); // nests; the fakes' own storage is not firmware heap
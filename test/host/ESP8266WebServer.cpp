@@ -0,0 +1,106 @@
+#include <ESP8266WebServer.h>
+
+static int hexDigit(char c) {
+  if (isdigit((unsigned char)c))
+    return c - '0';
+  return isxdigit((unsigned char)c) ? (c | 0x20) - 'a' + 10 : -1;
+}
+
+// application/x-www-form-urlencoded: '+' is a space, %XX a byte
+static std::string decodeForm(const std::string& text) {
+  std::string out;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '+') {
+      out += ' ';
+    } else if (text[i] == '%' && i + 2 < text.size() && hexDigit(text[i + 1]) >= 0 &&
+               hexDigit(text[i + 2]) >= 0) {
+      out += (char)(hexDigit(text[i + 1]) * 16 + hexDigit(text[i + 2]));
+      i += 2;
+    } else {
+      out += text[i];
+    }
+  }
+  return out;
+}
+
+void ESP8266WebServer::on(const char* uri, HTTPMethod method, THandlerFunction handler) {
+  hostHeapPause(true);
+  routes.push_back({uri, method, handler});
+  hostHeapPause(false);
+}
+
+void ESP8266WebServer::handleClient() {
+  if (!listening || !pending)
+    return;
+  pending = false;
+
+  for (const Route& route : routes) {
+    if (route.uri == requestUri && (route.method == HTTP_ANY || route.method == requestMethod)) {
+      route.handler();
+      break;
+    }
+  }
+  if (response.code == 0)
+    send(404, "text/plain", "Not found");
+
+  hostHeapPause(true);
+  args.clear();
+  hostHeapPause(false);
+}
+
+const String& ESP8266WebServer::arg(const char* name) const {
+  static const String empty;
+  for (const auto& field : args)
+    if (field.first == name)
+      return field.second;
+  return empty;
+}
+
+bool ESP8266WebServer::hasArg(const char* name) const {
+  for (const auto& field : args)
+    if (field.first == name)
+      return true;
+  return false;
+}
+
+void ESP8266WebServer::send(int code, const char* contentType, const char* content) {
+  hostHeapPause(true);
+  response.code = code;
+  response.contentType = contentType;
+  response.body = content;
+  hostHeapPause(false);
+}
+
+void ESP8266WebServer::sendContent(const char* content, size_t length) {
+  hostHeapPause(true);
+  response.body.append(content, length);
+  hostHeapPause(false);
+}
+
+bool ESP8266WebServer::hostRequest(HTTPMethod method, const char* uri, const char* form) {
+  if (!listening)
+    return false;
+
+  hostHeapPause(true);
+  pending = true;
+  requestMethod = method;
+  requestUri = uri;
+  contentLength = method == HTTP_POST ? strlen(form) : 0;
+  response = HostHttpResponse();
+  args.clear();
+  std::string text = form;
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = text.find('&', start);
+    if (end == std::string::npos)
+      end = text.size();
+    std::string field = text.substr(start, end - start);
+    size_t equals = field.find('=');
+    std::string name = decodeForm(field.substr(0, equals));
+    std::string value = equals == std::string::npos ? "" : decodeForm(field.substr(equals + 1));
+    args.push_back({name, String(value)});
+    start = end + 1;
+  }
+  hostHeapPause(false);
+  return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// Host stand-in for the portal's web server. A test queues a request with
+// hostRequest(), the firmware's handleClient() serves it from the routes
+// registered with on(), and the response is kept for the test to read. The
+// server's own storage (routes, arguments, the response) stands for the
+// library's and is not counted as firmware heap.
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+#include <functional>
+#include <utility>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+struct HostHttpResponse {
+  int code = 0; // 0 until the handler sends something
+  std::string contentType;
+  std::string body;
+};
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit ESP8266WebServer(int port = 80) {
+    (void)port;
+  }
+
+  void on(const char* uri, HTTPMethod method, THandlerFunction handler);
+  void begin() {
+    listening = true;
+  }
+  void stop() {
+    listening = false;
+  }
+  void handleClient();
+
+  const String& arg(const char* name) const;
+  bool hasArg(const char* name) const;
+  int clientContentLength() const {
+    return contentLength;
+  }
+
+  void send(int code, const char* contentType, const char* content);
+  void send(int code, const char* contentType, const String& content) {
+    send(code, contentType, content.c_str());
+  }
+  void send_P(int code, PGM_P contentType, PGM_P content) {
+    send(code, contentType, content);
+  }
+  void setContentLength(size_t length) {
+    (void)length;
+  }
+  void sendContent(const char* content, size_t length);
+  void sendContent(const char* content) {
+    sendContent(content, strlen(content));
+  }
+  template <typename T> size_t streamFile(T& file, const char* contentType) {
+    send(200, contentType, "");
+    char chunk[256];
+    size_t total = 0;
+    size_t bytes;
+    while ((bytes = file.read((uint8_t*)chunk, sizeof(chunk))) > 0) {
+      sendContent(chunk, bytes);
+      total += bytes;
+    }
+    return total;
+  }
+
+  // ---- test controls ----
+
+  // queues a request for the next handleClient(); false if the server is not listening.
+  // `form` is the query string of a GET or the url-encoded body of a POST.
+  bool hostRequest(HTTPMethod method, const char* uri, const char* form = "");
+  bool hostPending() const {
+    return pending;
+  }
+  const HostHttpResponse& hostResponse() const {
+    return response;
+  }
+
+private:
+  struct Route {
+    std::string uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+  };
+
+  std::vector<Route> routes;
+  bool listening = false;
+  bool pending = false;
+  HTTPMethod requestMethod = HTTP_GET;
+  std::string requestUri;
+  std::vector<std::pair<std::string, String>> args;
+  int contentLength = 0;
+  HostHttpResponse response;
+};
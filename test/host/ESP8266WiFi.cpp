@@ -0,0 +1,36 @@
+#include <ESP8266WiFi.h>
+
+ESP8266WiFiClass WiFi;
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+  return String(text);
+}
+
+bool ESP8266WiFiClass::mode(WiFiMode_t mode) {
+  if (mode == WIFI_OFF || mode == WIFI_STA)
+    apUp = false;
+  return true;
+}
+
+bool ESP8266WiFiClass::forceSleepBegin(uint32_t) {
+  asleep = true;
+  apUp = false;
+  return true;
+}
+
+bool ESP8266WiFiClass::forceSleepWake() {
+  asleep = false;
+  return true;
+}
+
+bool ESP8266WiFiClass::softAP(const char*, const char*) {
+  apUp = !asleep;
+  return apUp;
+}
+
+bool ESP8266WiFiClass::softAPdisconnect(bool) {
+  apUp = false;
+  return true;
+}
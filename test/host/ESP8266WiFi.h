@@ -0,0 +1,44 @@
+#pragma once
+
+// Host stand-in for the WiFi calls the firmware makes; there is no radio, only
+// whether the access point would be up.
+
+#include <Arduino.h>
+
+enum WiFiMode_t { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+  String toString() const;
+
+private:
+  uint8_t octets[4];
+};
+
+class ESP8266WiFiClass {
+public:
+  void persistent(bool) {}
+  bool mode(WiFiMode_t mode);
+  bool forceSleepBegin(uint32_t sleepUs = 0);
+  bool forceSleepWake();
+  bool softAP(const char* ssid, const char* passphrase = nullptr);
+  bool softAPdisconnect(bool wifioff = false);
+  IPAddress softAPIP() {
+    return IPAddress(192, 168, 4, 1);
+  }
+
+  // ---- test controls ----
+  bool hostSoftApUp() const {
+    return apUp;
+  }
+  bool hostRadioAsleep() const {
+    return asleep;
+  }
+
+private:
+  bool apUp = false;
+  bool asleep = false;
+};
+
+extern ESP8266WiFiClass WiFi;
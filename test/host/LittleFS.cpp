@@ -0,0 +1,202 @@
+#include <LittleFS.h>
+
+#include <map>
+#include <set>
+
+FS LittleFS;
+
+static uint32_t bytesWritten = 0;
+
+struct HostFileData {
+  std::string bytes;
+};
+
+static std::map<std::string, std::shared_ptr<HostFileData>>& files() {
+  static std::map<std::string, std::shared_ptr<HostFileData>> table;
+  return table;
+}
+
+File::File(std::shared_ptr<HostFileData> data, bool readable, bool writable, bool append)
+    : data(data), readable(readable), writable(writable), append(append) {}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  if (!data || !writable)
+    return 0;
+  hostHeapPause(true);
+  if (append)
+    offset = data->bytes.size();
+  if (offset > data->bytes.size())
+    data->bytes.resize(offset);
+  data->bytes.replace(offset, std::min(size, data->bytes.size() - offset), (const char*)buffer,
+                      size);
+  offset += size;
+  bytesWritten += size;
+  hostHeapPause(false);
+  return size;
+}
+
+int File::available() {
+  return data && readable && offset < data->bytes.size() ? data->bytes.size() - offset : 0;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  return available() ? (uint8_t)data->bytes[offset] : -1;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+  size_t count = std::min<size_t>(size, available());
+  if (count > 0)
+    memcpy(buffer, data->bytes.data() + offset, count);
+  offset += count;
+  return count;
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+  if (!data)
+    return false;
+  size_t base = mode == SeekSet ? 0 : mode == SeekCur ? offset : data->bytes.size();
+  if (base + position > data->bytes.size())
+    return false;
+  offset = base + position;
+  return true;
+}
+
+size_t File::size() const {
+  return data ? data->bytes.size() : 0;
+}
+
+bool File::truncate(uint32_t size) {
+  if (!data || !writable)
+    return false;
+  hostHeapPause(true);
+  data->bytes.resize(size);
+  hostHeapPause(false);
+  return true;
+}
+
+void File::close() {
+  hostHeapPause(true);
+  data.reset();
+  hostHeapPause(false);
+}
+
+static std::set<std::string>& directories() {
+  static std::set<std::string> table;
+  return table;
+}
+
+bool Dir::next() {
+  if (index == entries.size())
+    return false;
+  index++;
+  return true;
+}
+
+String Dir::fileName() const {
+  return index > 0 ? String(entries[index - 1].first) : String();
+}
+
+size_t Dir::fileSize() const {
+  return index > 0 ? entries[index - 1].second : 0;
+}
+
+bool FS::exists(const char* path) {
+  return files().count(path) > 0 || directories().count(path) > 0;
+}
+
+bool FS::mkdir(const char* path) {
+  hostHeapPause(true);
+  directories().insert(path);
+  hostHeapPause(false);
+  return true;
+}
+
+// the files directly inside `path`, in name order as LittleFS lists them
+Dir FS::openDir(const char* path) {
+  hostHeapPause(true);
+  Dir dir;
+  std::string prefix = std::string(path) + "/";
+  for (const auto& file : files()) {
+    if (file.first.compare(0, prefix.size(), prefix) == 0 &&
+        file.first.find('/', prefix.size()) == std::string::npos)
+      dir.entries.push_back({file.first.substr(prefix.size()), file.second->bytes.size()});
+  }
+  hostHeapPause(false);
+  return dir;
+}
+
+// modes as in fopen(): "r", "r+", "w", "w+", "a", "a+"
+File FS::open(const char* path, const char* mode) {
+  hostHeapPause(true);
+  bool plus = strchr(mode, '+') != nullptr;
+  auto found = files().find(path);
+  std::shared_ptr<HostFileData> data;
+  if (mode[0] == 'r') {
+    if (found != files().end())
+      data = found->second;
+  } else {
+    data = found != files().end() ? found->second : std::make_shared<HostFileData>();
+    if (mode[0] == 'w')
+      data->bytes.clear();
+    files()[path] = data;
+  }
+  File file;
+  if (data)
+    file = File(data, mode[0] == 'r' || plus, mode[0] != 'r' || plus, mode[0] == 'a');
+  hostHeapPause(false);
+  return file;
+}
+
+bool FS::remove(const char* path) {
+  hostHeapPause(true);
+  bool removed = files().erase(path) > 0;
+  hostHeapPause(false);
+  return removed;
+}
+
+bool FS::rename(const char* from, const char* to) {
+  auto found = files().find(from);
+  if (found == files().end())
+    return false;
+  hostHeapPause(true);
+  files()[to] = found->second;
+  files().erase(from);
+  hostHeapPause(false);
+  return true;
+}
+
+void FS::hostWrite(const char* path, const std::string& contents) {
+  hostHeapPause(true);
+  auto data = std::make_shared<HostFileData>();
+  data->bytes = contents;
+  files()[path] = data;
+  hostHeapPause(false);
+}
+
+std::string FS::hostRead(const char* path) {
+  hostHeapPause(true);
+  auto found = files().find(path);
+  std::string contents = found == files().end() ? std::string() : found->second->bytes;
+  hostHeapPause(false);
+  return contents;
+}
+
+void FS::hostFormat() {
+  hostHeapPause(true);
+  files().clear();
+  directories().clear();
+  hostHeapPause(false);
+}
+
+uint32_t FS::hostBytesWritten() {
+  return bytesWritten;
+}
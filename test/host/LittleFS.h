@@ -0,0 +1,83 @@
+#pragma once
+
+// Host stand-in for LittleFS: files live in memory for the life of the test
+// process. Only what the firmware uses is here. Its storage is not counted as
+// firmware heap (see hostHeapPause()).
+
+#include <Arduino.h>
+
+#include <memory>
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct HostFileData;
+
+class File : public Stream {
+public:
+  File() {}
+  File(std::shared_ptr<HostFileData> data, bool readable, bool writable, bool append);
+
+  explicit operator bool() const {
+    return data != nullptr;
+  }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t* buffer, size_t size);
+  size_t readBytes(char* buffer, size_t length) override {
+    return read((uint8_t*)buffer, length);
+  }
+
+  bool seek(uint32_t position, SeekMode mode = SeekSet);
+  size_t position() const {
+    return offset;
+  }
+  size_t size() const;
+  bool truncate(uint32_t size);
+  void close();
+
+private:
+  std::shared_ptr<HostFileData> data;
+  size_t offset = 0;
+  bool readable = false;
+  bool writable = false;
+  bool append = false;
+};
+
+// a directory listing, taken when the directory is opened
+class Dir {
+public:
+  bool next();
+  String fileName() const; // without the directory
+  size_t fileSize() const;
+
+private:
+  friend class FS;
+  std::vector<std::pair<std::string, size_t>> entries;
+  size_t index = 0; // one past the current entry
+};
+
+class FS {
+public:
+  bool begin() {
+    return true;
+  }
+  bool exists(const char* path); // a file, or a directory made with mkdir()
+  bool mkdir(const char* path);
+  Dir openDir(const char* path);
+  File open(const char* path, const char* mode);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+
+  // ---- test controls ----
+  void hostWrite(const char* path, const std::string& contents); // creates or replaces
+  std::string hostRead(const char* path);
+  void hostFormat(); // removes every file and directory
+  uint32_t hostBytesWritten(); // through File, since start: what wears the flash
+};
+
+extern FS LittleFS;
@@ -0,0 +1,921 @@
+#include <MFRC522.h>
+
+uint32_t MFRC522::hostSpiClock = MFRC522_SPICLOCK;
+
+// ---- library: register access, one SPI transaction each ----
+
+void MFRC522::PCD_WriteRegister(PCD_Register reg, byte value) {
+  PCD_WriteRegister(reg, 1, &value);
+}
+
+void MFRC522::PCD_WriteRegister(PCD_Register reg, byte count, byte* values) {
+  SPI.beginTransaction(SPISettings(hostSpiClock, MSBFIRST, SPI_MODE0));
+  digitalWrite(chipSelectPin, LOW);
+  SPI.transfer(reg);
+  for (byte i = 0; i < count; i++)
+    SPI.transfer(values[i]);
+  digitalWrite(chipSelectPin, HIGH);
+  SPI.endTransaction();
+}
+
+byte MFRC522::PCD_ReadRegister(PCD_Register reg) {
+  SPI.beginTransaction(SPISettings(hostSpiClock, MSBFIRST, SPI_MODE0));
+  digitalWrite(chipSelectPin, LOW);
+  SPI.transfer(0x80 | reg);
+  byte value = SPI.transfer(0);
+  digitalWrite(chipSelectPin, HIGH);
+  SPI.endTransaction();
+  return value;
+}
+
+void MFRC522::PCD_ReadRegister(PCD_Register reg, byte count, byte* values, byte rxAlign) {
+  if (count == 0)
+    return;
+  byte address = 0x80 | reg;
+  byte index = 0;
+  SPI.beginTransaction(SPISettings(hostSpiClock, MSBFIRST, SPI_MODE0));
+  digitalWrite(chipSelectPin, LOW);
+  count--;
+  SPI.transfer(address);
+  if (rxAlign) {
+    byte mask = (0xFF << rxAlign) & 0xFF;
+    byte value = SPI.transfer(address);
+    values[0] = (values[0] & ~mask) | (value & mask);
+    index++;
+  }
+  while (index < count)
+    values[index++] = SPI.transfer(address);
+  values[index] = SPI.transfer(0);
+  digitalWrite(chipSelectPin, HIGH);
+  SPI.endTransaction();
+}
+
+void MFRC522::PCD_SetRegisterBitMask(PCD_Register reg, byte mask) {
+  PCD_WriteRegister(reg, PCD_ReadRegister(reg) | mask);
+}
+
+void MFRC522::PCD_ClearRegisterBitMask(PCD_Register reg, byte mask) {
+  PCD_WriteRegister(reg, PCD_ReadRegister(reg) & ~mask);
+}
+
+MFRC522::StatusCode MFRC522::PCD_CalculateCRC(byte* data, byte length, byte* result) {
+  PCD_WriteRegister(CommandReg, PCD_Idle);
+  PCD_WriteRegister(DivIrqReg, 0x04);
+  PCD_WriteRegister(FIFOLevelReg, 0x80);
+  PCD_WriteRegister(FIFODataReg, length, data);
+  PCD_WriteRegister(CommandReg, PCD_CalcCRC);
+
+  const uint32_t deadline = millis() + 89;
+  do {
+    if (PCD_ReadRegister(DivIrqReg) & 0x04) {
+      PCD_WriteRegister(CommandReg, PCD_Idle);
+      result[0] = PCD_ReadRegister(CRCResultRegL);
+      result[1] = PCD_ReadRegister(CRCResultRegH);
+      return STATUS_OK;
+    }
+    yield();
+  } while ((uint32_t)millis() < deadline);
+  return STATUS_TIMEOUT;
+}
+
+// soft reset only: the hard reset through the RST pin is not modelled
+void MFRC522::PCD_Init() {
+  pinMode(chipSelectPin, OUTPUT);
+  digitalWrite(chipSelectPin, HIGH);
+
+  PCD_WriteRegister(CommandReg, PCD_SoftReset);
+  uint8_t count = 0;
+  do {
+    delay(50);
+  } while ((PCD_ReadRegister(CommandReg) & (1 << 4)) && (++count) < 3);
+
+  PCD_WriteRegister(TxModeReg, 0x00);
+  PCD_WriteRegister(RxModeReg, 0x00);
+  PCD_WriteRegister(ModWidthReg, 0x26);
+  PCD_WriteRegister(TModeReg, 0x80);
+  PCD_WriteRegister(TPrescalerReg, 0xA9);
+  PCD_WriteRegister(TReloadRegH, 0x03);
+  PCD_WriteRegister(TReloadRegL, 0xE8);
+  PCD_WriteRegister(TxASKReg, 0x40);
+  PCD_WriteRegister(ModeReg, 0x3D);
+  PCD_AntennaOn();
+}
+
+void MFRC522::PCD_AntennaOn() {
+  byte value = PCD_ReadRegister(TxControlReg);
+  if ((value & 0x03) != 0x03)
+    PCD_WriteRegister(TxControlReg, value | 0x03);
+}
+
+// ---- library: talking to cards ----
+
+MFRC522::StatusCode MFRC522::PCD_TransceiveData(byte* sendData, byte sendLen, byte* backData,
+                                                byte* backLen, byte* validBits, byte rxAlign,
+                                                bool checkCRC) {
+  return PCD_CommunicateWithPICC(PCD_Transceive, 0x30, sendData, sendLen, backData, backLen,
+                                 validBits, rxAlign, checkCRC);
+}
+
+MFRC522::StatusCode MFRC522::PCD_CommunicateWithPICC(byte command, byte waitIRq, byte* sendData,
+                                                     byte sendLen, byte* backData, byte* backLen,
+                                                     byte* validBits, byte rxAlign,
+                                                     bool checkCRC) {
+  byte txLastBits = validBits ? *validBits : 0;
+  byte bitFraming = (rxAlign << 4) + txLastBits;
+
+  PCD_WriteRegister(CommandReg, PCD_Idle);
+  PCD_WriteRegister(ComIrqReg, 0x7F);
+  PCD_WriteRegister(FIFOLevelReg, 0x80);
+  PCD_WriteRegister(FIFODataReg, sendLen, sendData);
+  PCD_WriteRegister(BitFramingReg, bitFraming);
+  PCD_WriteRegister(CommandReg, command);
+  if (command == PCD_Transceive)
+    PCD_SetRegisterBitMask(BitFramingReg, 0x80);
+
+  const uint32_t deadline = millis() + 36;
+  bool completed = false;
+  do {
+    byte n = PCD_ReadRegister(ComIrqReg);
+    if (n & waitIRq) {
+      completed = true;
+      break;
+    }
+    if (n & 0x01)
+      return STATUS_TIMEOUT;
+    yield();
+  } while ((uint32_t)millis() < deadline);
+  if (!completed)
+    return STATUS_TIMEOUT;
+
+  byte errorRegValue = PCD_ReadRegister(ErrorReg);
+  if (errorRegValue & 0x13)
+    return STATUS_ERROR;
+
+  byte lastBits = 0;
+  if (backData && backLen) {
+    byte n = PCD_ReadRegister(FIFOLevelReg);
+    if (n > *backLen)
+      return STATUS_NO_ROOM;
+    *backLen = n;
+    PCD_ReadRegister(FIFODataReg, n, backData, rxAlign);
+    lastBits = PCD_ReadRegister(ControlReg) & 0x07;
+    if (validBits)
+      *validBits = lastBits;
+  }
+
+  if (errorRegValue & 0x08)
+    return STATUS_COLLISION;
+
+  if (backData && backLen && checkCRC) {
+    if (*backLen == 1 && lastBits == 4)
+      return STATUS_MIFARE_NACK;
+    if (*backLen < 2 || lastBits != 0)
+      return STATUS_CRC_WRONG;
+    byte control[2];
+    StatusCode status = PCD_CalculateCRC(backData, *backLen - 2, control);
+    if (status != STATUS_OK)
+      return status;
+    if (backData[*backLen - 2] != control[0] || backData[*backLen - 1] != control[1])
+      return STATUS_CRC_WRONG;
+  }
+  return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::PICC_RequestA(byte* bufferATQA, byte* bufferSize) {
+  return PICC_REQA_or_WUPA(PICC_CMD_REQA, bufferATQA, bufferSize);
+}
+
+MFRC522::StatusCode MFRC522::PICC_WakeupA(byte* bufferATQA, byte* bufferSize) {
+  return PICC_REQA_or_WUPA(PICC_CMD_WUPA, bufferATQA, bufferSize);
+}
+
+MFRC522::StatusCode MFRC522::PICC_REQA_or_WUPA(byte command, byte* bufferATQA, byte* bufferSize) {
+  if (bufferATQA == nullptr || *bufferSize < 2)
+    return STATUS_NO_ROOM;
+  PCD_ClearRegisterBitMask(CollReg, 0x80);
+  byte validBits = 7;
+  StatusCode status = PCD_TransceiveData(&command, 1, bufferATQA, bufferSize, &validBits);
+  if (status != STATUS_OK)
+    return status;
+  if (*bufferSize != 2 || validBits != 0)
+    return STATUS_ERROR;
+  return STATUS_OK;
+}
+
+// the library's select, anticollision loop included
+MFRC522::StatusCode MFRC522::PICC_Select(Uid* uid, byte validBits) {
+  byte cascadeLevel = 1;
+  byte buffer[9];
+  byte uidIndex = 0;
+  bool useCascadeTag = false;
+  byte* responseBuffer = nullptr;
+  byte responseLength = 0;
+  byte txLastBits = 0;
+
+  if (validBits > 80)
+    return STATUS_INVALID;
+  PCD_ClearRegisterBitMask(CollReg, 0x80);
+
+  bool uidComplete = false;
+  while (!uidComplete) {
+    switch (cascadeLevel) {
+    case 1:
+      buffer[0] = PICC_CMD_SEL_CL1;
+      uidIndex = 0;
+      useCascadeTag = validBits && uid->size > 4;
+      break;
+    case 2:
+      buffer[0] = PICC_CMD_SEL_CL2;
+      uidIndex = 3;
+      useCascadeTag = validBits && uid->size > 7;
+      break;
+    case 3:
+      buffer[0] = PICC_CMD_SEL_CL3;
+      uidIndex = 6;
+      useCascadeTag = false;
+      break;
+    default:
+      return STATUS_INTERNAL_ERROR;
+    }
+
+    int8_t currentLevelKnownBits = validBits - (8 * uidIndex);
+    if (currentLevelKnownBits < 0)
+      currentLevelKnownBits = 0;
+    byte index = 2;
+    if (useCascadeTag)
+      buffer[index++] = PICC_CMD_CT;
+    byte bytesToCopy = currentLevelKnownBits / 8 + (currentLevelKnownBits % 8 ? 1 : 0);
+    if (bytesToCopy) {
+      byte maxBytes = useCascadeTag ? 3 : 4;
+      if (bytesToCopy > maxBytes)
+        bytesToCopy = maxBytes;
+      for (byte count = 0; count < bytesToCopy; count++)
+        buffer[index++] = uid->uidByte[uidIndex + count];
+    }
+    if (useCascadeTag)
+      currentLevelKnownBits += 8;
+
+    bool selectDone = false;
+    while (!selectDone) {
+      byte bufferUsed;
+      if (currentLevelKnownBits >= 32) {
+        buffer[1] = 0x70;
+        buffer[6] = buffer[2] ^ buffer[3] ^ buffer[4] ^ buffer[5];
+        StatusCode status = PCD_CalculateCRC(buffer, 7, &buffer[7]);
+        if (status != STATUS_OK)
+          return status;
+        txLastBits = 0;
+        bufferUsed = 9;
+        responseBuffer = &buffer[6];
+        responseLength = 3;
+      } else {
+        txLastBits = currentLevelKnownBits % 8;
+        byte count = currentLevelKnownBits / 8;
+        index = 2 + count;
+        buffer[1] = (index << 4) + txLastBits;
+        bufferUsed = index + (txLastBits ? 1 : 0);
+        responseBuffer = &buffer[index];
+        responseLength = sizeof(buffer) - index;
+      }
+
+      byte rxAlign = txLastBits;
+      PCD_WriteRegister(BitFramingReg, (rxAlign << 4) + txLastBits);
+      StatusCode status = PCD_TransceiveData(buffer, bufferUsed, responseBuffer, &responseLength,
+                                             &txLastBits, rxAlign);
+      if (status == STATUS_COLLISION) {
+        byte valueOfCollReg = PCD_ReadRegister(CollReg);
+        if (valueOfCollReg & 0x20)
+          return STATUS_COLLISION;
+        byte collisionPos = valueOfCollReg & 0x1F;
+        if (collisionPos == 0)
+          collisionPos = 32;
+        if (collisionPos <= currentLevelKnownBits)
+          return STATUS_INTERNAL_ERROR;
+        currentLevelKnownBits = collisionPos;
+        byte count = currentLevelKnownBits % 8;
+        byte checkBit = (currentLevelKnownBits - 1) % 8;
+        index = 1 + (currentLevelKnownBits / 8) + (count ? 1 : 0);
+        buffer[index] |= (1 << checkBit);
+      } else if (status != STATUS_OK) {
+        return status;
+      } else if (currentLevelKnownBits >= 32) {
+        selectDone = true;
+      } else {
+        currentLevelKnownBits = 32;
+      }
+    }
+
+    index = buffer[2] == PICC_CMD_CT ? 3 : 2;
+    byte bytesToCopyOut = buffer[2] == PICC_CMD_CT ? 3 : 4;
+    for (byte count = 0; count < bytesToCopyOut; count++)
+      uid->uidByte[uidIndex + count] = buffer[index++];
+
+    if (responseLength != 3 || txLastBits != 0)
+      return STATUS_ERROR;
+    StatusCode status = PCD_CalculateCRC(responseBuffer, 1, &buffer[2]);
+    if (status != STATUS_OK)
+      return status;
+    if (buffer[2] != responseBuffer[1] || buffer[3] != responseBuffer[2])
+      return STATUS_CRC_WRONG;
+    if (responseBuffer[0] & 0x04) {
+      cascadeLevel++;
+    } else {
+      uidComplete = true;
+      uid->sak = responseBuffer[0];
+    }
+  }
+
+  uid->size = 3 * cascadeLevel + 1;
+  return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::PICC_HaltA() {
+  byte buffer[4] = {PICC_CMD_HLTA, 0};
+  StatusCode status = PCD_CalculateCRC(buffer, 2, &buffer[2]);
+  if (status != STATUS_OK)
+    return status;
+  // a halted card does not answer: a timeout is success
+  status = PCD_TransceiveData(buffer, sizeof(buffer), nullptr, 0);
+  if (status == STATUS_TIMEOUT)
+    return STATUS_OK;
+  if (status == STATUS_OK)
+    return STATUS_ERROR;
+  return status;
+}
+
+bool MFRC522::PICC_IsNewCardPresent() {
+  byte bufferATQA[2];
+  byte bufferSize = sizeof(bufferATQA);
+  PCD_WriteRegister(TxModeReg, 0x00);
+  PCD_WriteRegister(RxModeReg, 0x00);
+  PCD_WriteRegister(ModWidthReg, 0x26);
+  StatusCode status = PICC_RequestA(bufferATQA, &bufferSize);
+  return status == STATUS_OK || status == STATUS_COLLISION;
+}
+
+bool MFRC522::PICC_ReadCardSerial() {
+  return PICC_Select(&uid) == STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::PCD_Authenticate(byte command, byte blockAddr, MIFARE_Key* key,
+                                              Uid* uid) {
+  byte sendData[12];
+  sendData[0] = command;
+  sendData[1] = blockAddr;
+  for (byte i = 0; i < 6; i++)
+    sendData[2 + i] = key->keyByte[i];
+  for (byte i = 0; i < 4; i++)
+    sendData[8 + i] = uid->uidByte[i + uid->size - 4];
+  return PCD_CommunicateWithPICC(PCD_MFAuthent, 0x10, sendData, sizeof(sendData));
+}
+
+void MFRC522::PCD_StopCrypto1() {
+  PCD_ClearRegisterBitMask(Status2Reg, 0x08);
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Read(byte blockAddr, byte* buffer, byte* bufferSize) {
+  if (buffer == nullptr || *bufferSize < 18)
+    return STATUS_NO_ROOM;
+  buffer[0] = PICC_CMD_MF_READ;
+  buffer[1] = blockAddr;
+  StatusCode status = PCD_CalculateCRC(buffer, 2, &buffer[2]);
+  if (status != STATUS_OK)
+    return status;
+  return PCD_TransceiveData(buffer, 4, buffer, bufferSize, nullptr, 0, true);
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Write(byte blockAddr, byte* buffer, byte bufferSize) {
+  if (buffer == nullptr || bufferSize < 16)
+    return STATUS_INVALID;
+  byte command[2] = {PICC_CMD_MF_WRITE, blockAddr};
+  StatusCode status = PCD_MIFARE_Transceive(command, 2);
+  if (status != STATUS_OK)
+    return status;
+  return PCD_MIFARE_Transceive(buffer, bufferSize);
+}
+
+MFRC522::StatusCode MFRC522::PCD_MIFARE_Transceive(byte* sendData, byte sendLen,
+                                                   bool acceptTimeout) {
+  byte buffer[18];
+  if (sendData == nullptr || sendLen > 16)
+    return STATUS_INVALID;
+  memcpy(buffer, sendData, sendLen);
+  StatusCode status = PCD_CalculateCRC(buffer, sendLen, &buffer[sendLen]);
+  if (status != STATUS_OK)
+    return status;
+  sendLen += 2;
+
+  byte bufferSize = sizeof(buffer);
+  byte validBits = 0;
+  status = PCD_CommunicateWithPICC(PCD_Transceive, 0x30, buffer, sendLen, buffer, &bufferSize,
+                                   &validBits);
+  if (acceptTimeout && status == STATUS_TIMEOUT)
+    return STATUS_OK;
+  if (status != STATUS_OK)
+    return status;
+  if (bufferSize != 1 || validBits != 4)
+    return STATUS_ERROR;
+  if (buffer[0] != 0x0A) // MF_ACK
+    return STATUS_MIFARE_NACK;
+  return STATUS_OK;
+}
+
+// ---- chip ----
+
+// register indexes (the library's addresses are shifted left by one)
+const uint8_t R_COMMAND = MFRC522::CommandReg >> 1;
+const uint8_t R_COM_IRQ = MFRC522::ComIrqReg >> 1;
+const uint8_t R_DIV_IRQ = MFRC522::DivIrqReg >> 1;
+const uint8_t R_ERROR = MFRC522::ErrorReg >> 1;
+const uint8_t R_STATUS2 = MFRC522::Status2Reg >> 1;
+const uint8_t R_FIFO_DATA = MFRC522::FIFODataReg >> 1;
+const uint8_t R_FIFO_LEVEL = MFRC522::FIFOLevelReg >> 1;
+const uint8_t R_CONTROL = MFRC522::ControlReg >> 1;
+const uint8_t R_BIT_FRAMING = MFRC522::BitFramingReg >> 1;
+const uint8_t R_COLL = MFRC522::CollReg >> 1;
+const uint8_t R_TX_CONTROL = MFRC522::TxControlReg >> 1;
+const uint8_t R_CRC_H = MFRC522::CRCResultRegH >> 1;
+const uint8_t R_CRC_L = MFRC522::CRCResultRegL >> 1;
+const uint8_t R_TMODE = MFRC522::TModeReg >> 1;
+const uint8_t R_TPRESCALER = MFRC522::TPrescalerReg >> 1;
+const uint8_t R_TRELOAD_H = MFRC522::TReloadRegH >> 1;
+const uint8_t R_TRELOAD_L = MFRC522::TReloadRegL >> 1;
+const uint8_t R_VERSION = MFRC522::VersionReg >> 1;
+
+const uint8_t FIFO_SIZE = 64;
+// ISO 14443A at 106 kbit/s: frame delay time, then ~85 us per byte with parity
+const uint32_t FDT_US = 86;
+const uint32_t BYTE_AIR_US = 85;
+const uint32_t AUTH_US = 1000; // three-pass authentication
+
+static uint16_t crcA(const uint8_t* data, size_t length) {
+  uint16_t crc = 0x6363;
+  for (size_t i = 0; i < length; i++) {
+    uint8_t b = data[i] ^ (crc & 0xFF);
+    b ^= b << 4;
+    crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+  }
+  return crc;
+}
+
+static void appendCrc(std::vector<uint8_t>& frame) {
+  uint16_t crc = crcA(frame.data(), frame.size());
+  frame.push_back(crc & 0xFF);
+  frame.push_back(crc >> 8);
+}
+
+// the 5 bytes a card sends at one cascade level (4 UID or CT bytes, then BCC)
+static bool levelFrame(const HostCard& card, uint8_t level, uint8_t* out) {
+  uint8_t levels = card.length == 4 ? 1 : card.length == 7 ? 2 : 3;
+  if (level > levels)
+    return false;
+  const uint8_t* uid = card.uid + 3 * (level - 1);
+  if (level < levels) {
+    out[0] = MFRC522::PICC_CMD_CT;
+    memcpy(out + 1, uid, 3);
+  } else {
+    memcpy(out, uid, 4);
+  }
+  out[4] = out[0] ^ out[1] ^ out[2] ^ out[3];
+  return true;
+}
+
+static bool bitAt(const uint8_t* bytes, uint8_t bit) {
+  return bytes[bit / 8] >> (bit % 8) & 1;
+}
+
+HostMfrc522Chip::HostMfrc522Chip(uint8_t csPin) : HostSpiDevice(csPin) {
+  brownOut();
+}
+
+void HostMfrc522Chip::brownOut() {
+  memset(regs, 0, sizeof(regs));
+  regs[R_COMMAND] = 0x20;
+  regs[MFRC522::ComIEnReg >> 1] = 0x80;
+  regs[R_COM_IRQ] = 0x14;
+  regs[MFRC522::Status1Reg >> 1] = 0x21;
+  regs[MFRC522::WaterLevelReg >> 1] = 0x08;
+  regs[R_CONTROL] = 0x10;
+  regs[R_COLL] = 0xA0;
+  regs[MFRC522::ModeReg >> 1] = 0x3F;
+  regs[R_TX_CONTROL] = 0x80; // antenna off
+  regs[MFRC522::ModWidthReg >> 1] = 0x26;
+  regs[MFRC522::RFCfgReg >> 1] = 0x48;
+  hostHeapPause(true);
+  fifo.clear();
+  hostHeapPause(false);
+  pending.active = false;
+  // the field drops with the chip, so every card powers down
+  for (FieldCard& card : field) {
+    card.state = FieldCard::IDLE;
+    card.authSector = -1;
+    card.writeBlock = -1;
+  }
+}
+
+void HostMfrc522Chip::frameStart() {
+  firstByte = true;
+}
+
+uint8_t HostMfrc522Chip::transfer(uint8_t out, uint32_t clock) {
+  if (!responding)
+    return 0xFF;
+  if (firstByte) {
+    firstByte = false;
+    address = (out >> 1) & 0x3F;
+    reading = out & 0x80;
+    return 0;
+  }
+  if (!reading) {
+    write(address, out);
+    return 0;
+  }
+  uint8_t value = read(address);
+  address = (out >> 1) & 0x3F;
+  return clock > maxClock ? (uint8_t)(value << 1 | 1) : value; // sampled a bit late
+}
+
+uint8_t HostMfrc522Chip::read(uint8_t address) {
+  settle();
+  switch (address) {
+  case R_FIFO_DATA: {
+    if (fifo.empty())
+      return 0;
+    uint8_t value = fifo.front();
+    fifo.erase(fifo.begin());
+    return value;
+  }
+  case R_FIFO_LEVEL:
+    return fifo.size();
+  case R_VERSION:
+    return version;
+  default:
+    return regs[address];
+  }
+}
+
+void HostMfrc522Chip::write(uint8_t address, uint8_t value) {
+  settle();
+  hostHeapPause(true);
+  switch (address) {
+  case R_COMMAND:
+    regs[R_COMMAND] = (regs[R_COMMAND] & 0xE0) | (value & 0x1F);
+    startCommand(value & 0x0F);
+    break;
+  case R_COM_IRQ:
+  case R_DIV_IRQ:
+    if (value & 0x80)
+      regs[address] |= value & 0x7F;
+    else
+      regs[address] &= ~(value & 0x7F);
+    break;
+  case R_FIFO_DATA:
+    if (fifo.size() < FIFO_SIZE)
+      fifo.push_back(value);
+    break;
+  case R_FIFO_LEVEL:
+    if (value & 0x80)
+      fifo.clear();
+    break;
+  case R_BIT_FRAMING:
+    regs[R_BIT_FRAMING] = value & 0x7F;
+    if ((value & 0x80) && (regs[R_COMMAND] & 0x0F) == MFRC522::PCD_Transceive)
+      transceive();
+    break;
+  case R_STATUS2:
+    regs[R_STATUS2] = (regs[R_STATUS2] & 0x08) & value;
+    if (!(regs[R_STATUS2] & 0x08))
+      for (FieldCard& card : field)
+        card.authSector = -1;
+    break;
+  default:
+    regs[address] = value;
+  }
+  hostHeapPause(false);
+}
+
+void HostMfrc522Chip::startCommand(uint8_t command) {
+  switch (command) {
+  case MFRC522::PCD_Idle:
+    pending.active = false;
+    break;
+  case MFRC522::PCD_SoftReset:
+    brownOut();
+    break;
+  case MFRC522::PCD_CalcCRC: {
+    uint16_t crc = crcA(fifo.data(), fifo.size());
+    fifo.clear();
+    regs[R_CRC_L] = crc & 0xFF;
+    regs[R_CRC_H] = crc >> 8;
+    regs[R_DIV_IRQ] |= 0x04;
+    break;
+  }
+  case MFRC522::PCD_MFAuthent:
+    authenticate();
+    break;
+  default:
+    break;
+  }
+}
+
+// the reply (or the timer) lands once its time on air has passed
+void HostMfrc522Chip::settle() {
+  if (!pending.active || hostMicros() < pending.atUs)
+    return;
+  pending.active = false;
+  hostHeapPause(true);
+  fifo = pending.reply;
+  hostHeapPause(false);
+  regs[R_COM_IRQ] |= pending.irq;
+  regs[R_ERROR] = pending.error;
+  regs[R_CONTROL] = (regs[R_CONTROL] & ~0x07) | pending.lastBits;
+  regs[R_COLL] = (regs[R_COLL] & 0x80) | (pending.collPos ? pending.collPos & 0x1F : 0x20);
+  if (pending.crypto)
+    regs[R_STATUS2] |= 0x08;
+}
+
+void HostMfrc522Chip::finishAfter(uint32_t airUs, std::vector<uint8_t> reply, uint8_t lastBits) {
+  pending = Pending();
+  pending.active = true;
+  pending.atUs = hostMicros() + airUs;
+  pending.irq = 0x20; // RxIRq
+  pending.reply = std::move(reply);
+  pending.lastBits = lastBits;
+}
+
+// nobody answered: the timer fires after TReload ticks, if it was set to start by itself
+void HostMfrc522Chip::timeOut() {
+  pending = Pending();
+  if (!(regs[R_TMODE] & 0x80))
+    return;
+  uint32_t prescaler = (regs[R_TMODE] & 0x0F) << 8 | regs[R_TPRESCALER];
+  uint32_t reload = regs[R_TRELOAD_H] << 8 | regs[R_TRELOAD_L];
+  uint64_t tickNs = (2 * prescaler + 1) * 1000000ULL / 13560;
+  pending.active = true;
+  pending.atUs = hostMicros() + FDT_US + (reload + 1) * tickNs / 1000;
+  pending.irq = 0x01; // TimerIRq
+}
+
+HostMfrc522Chip::FieldCard* HostMfrc522Chip::activeCard() {
+  for (FieldCard& card : field)
+    if (card.state == FieldCard::ACTIVE)
+      return &card;
+  return nullptr;
+}
+
+void HostMfrc522Chip::transceive() {
+  std::vector<uint8_t> frame;
+  frame.swap(fifo);
+  uint8_t txLastBits = regs[R_BIT_FRAMING] & 0x07;
+  regs[R_ERROR] = 0;
+
+  if ((regs[R_TX_CONTROL] & 0x03) != 0x03 || frame.empty()) {
+    timeOut();
+    return;
+  }
+  uint32_t airUs = FDT_US + BYTE_AIR_US * frame.size();
+  uint8_t command = frame[0];
+
+  FieldCard* active = activeCard();
+  if (active != nullptr && active->writeBlock >= 0) {
+    if (frame.size() >= 18)
+      memcpy(active->card.blocks[active->writeBlock], frame.data(), 16);
+    active->writeBlock = -1;
+    finishAfter(airUs + BYTE_AIR_US, {0x0A}, 4);
+    return;
+  }
+
+  if (frame.size() == 1 && txLastBits == 7 &&
+      (command == MFRC522::PICC_CMD_REQA || command == MFRC522::PICC_CMD_WUPA)) {
+    uint8_t atqa = 0;
+    uint8_t answers = 0;
+    bool collision = false;
+    for (FieldCard& card : field) {
+      bool wakes = card.state == FieldCard::IDLE ||
+                   (card.state == FieldCard::HALT && command == MFRC522::PICC_CMD_WUPA);
+      if (card.state == FieldCard::READY || card.state == FieldCard::ACTIVE) {
+        card.state = FieldCard::IDLE; // unexpected in these states
+        continue;
+      }
+      if (!wakes)
+        continue;
+      card.state = FieldCard::READY;
+      card.level = 1;
+      uint8_t own = card.card.length == 4 ? 0x04 : card.card.length == 7 ? 0x44 : 0x84;
+      collision |= answers > 0 && own != atqa;
+      atqa |= own;
+      answers++;
+    }
+    if (answers == 0) {
+      timeOut();
+      return;
+    }
+    finishAfter(airUs + 2 * BYTE_AIR_US, {atqa, 0x00});
+    pending.error = collision ? 0x08 : 0;
+    return;
+  }
+
+  if ((command == MFRC522::PICC_CMD_SEL_CL1 || command == MFRC522::PICC_CMD_SEL_CL2 ||
+       command == MFRC522::PICC_CMD_SEL_CL3) &&
+      frame.size() >= 2) {
+    uint8_t level = command == MFRC522::PICC_CMD_SEL_CL1 ? 1
+                    : command == MFRC522::PICC_CMD_SEL_CL2 ? 2
+                                                           : 3;
+    uint8_t error = 0;
+    uint8_t collPos = 0;
+    std::vector<uint8_t> reply = frame[1] == 0x70 ? select(level, frame)
+                                                  : anticollision(level, frame, &error, &collPos);
+    if (reply.empty()) {
+      timeOut();
+      return;
+    }
+    finishAfter(airUs + BYTE_AIR_US * reply.size(), reply);
+    pending.error = error;
+    pending.collPos = collPos;
+    return;
+  }
+
+  if (command == MFRC522::PICC_CMD_HLTA && active != nullptr) {
+    active->state = FieldCard::HALT;
+    active->authSector = -1;
+    timeOut(); // halted cards do not answer
+    return;
+  }
+
+  if ((command == MFRC522::PICC_CMD_MF_READ || command == MFRC522::PICC_CMD_MF_WRITE) &&
+      active != nullptr && frame.size() >= 2) {
+    uint8_t block = frame[1];
+    if (block >= 64 || active->authSector != block / 4) {
+      active->state = FieldCard::IDLE;
+      active->authSector = -1;
+      finishAfter(airUs + BYTE_AIR_US, {0x04}, 4); // NAK
+      return;
+    }
+    if (command == MFRC522::PICC_CMD_MF_WRITE) {
+      active->writeBlock = block;
+      finishAfter(airUs + BYTE_AIR_US, {0x0A}, 4); // ACK
+      return;
+    }
+    std::vector<uint8_t> reply(active->card.blocks[block], active->card.blocks[block] + 16);
+    appendCrc(reply);
+    finishAfter(airUs + BYTE_AIR_US * reply.size(), reply);
+    return;
+  }
+
+  // anything else sends listening cards back to idle
+  for (FieldCard& card : field)
+    if (card.state == FieldCard::READY || card.state == FieldCard::ACTIVE)
+      card.state = FieldCard::IDLE;
+  timeOut();
+}
+
+// cards still in the running answer with the rest of their frame; the first bit
+// where they disagree is reported as the collision position
+std::vector<uint8_t> HostMfrc522Chip::anticollision(uint8_t level,
+                                                    const std::vector<uint8_t>& frame,
+                                                    uint8_t* error, uint8_t* collPos) {
+  uint8_t knownBits = ((frame[1] >> 4) - 2) * 8 + (frame[1] & 0x0F);
+  const uint8_t* known = frame.data() + 2;
+
+  std::vector<const uint8_t*> answers;
+  static uint8_t frames[8][5];
+  uint8_t combined[5] = {};
+  for (FieldCard& card : field) {
+    if (card.state != FieldCard::READY || card.level != level || answers.size() == 8)
+      continue;
+    uint8_t* own = frames[answers.size()];
+    if (!levelFrame(card.card, level, own))
+      continue;
+    bool matches = true;
+    for (uint8_t bit = 0; bit < knownBits && matches; bit++)
+      matches = bitAt(own, bit) == bitAt(known, bit);
+    if (!matches)
+      continue;
+    answers.push_back(own);
+    for (uint8_t i = 0; i < 5; i++)
+      combined[i] |= own[i];
+  }
+  if (answers.empty())
+    return {};
+
+  for (uint8_t bit = knownBits; bit < 40 && answers.size() > 1 && *error == 0; bit++) {
+    for (const uint8_t* own : answers) {
+      if (bitAt(own, bit) != bitAt(answers[0], bit)) {
+        *error = 0x08; // CollErr
+        *collPos = (bit + 1) % 32;
+        break;
+      }
+    }
+  }
+  return std::vector<uint8_t>(combined + knownBits / 8, combined + 5);
+}
+
+std::vector<uint8_t> HostMfrc522Chip::select(uint8_t level, const std::vector<uint8_t>& frame) {
+  std::vector<uint8_t> reply;
+  for (FieldCard& card : field) {
+    if (card.state != FieldCard::READY || card.level != level)
+      continue;
+    uint8_t own[5];
+    if (frame.size() < 7 || !levelFrame(card.card, level, own) ||
+        memcmp(own, frame.data() + 2, 5) != 0) {
+      card.state = FieldCard::IDLE; // another card was selected
+      continue;
+    }
+    uint8_t levels = card.card.length == 4 ? 1 : card.card.length == 7 ? 2 : 3;
+    if (level < levels) {
+      card.level++;
+      reply = {0x04}; // cascade bit: UID not complete
+    } else {
+      card.state = FieldCard::ACTIVE;
+      reply = {card.card.sak};
+    }
+  }
+  if (!reply.empty())
+    appendCrc(reply);
+  return reply;
+}
+
+void HostMfrc522Chip::authenticate() {
+  std::vector<uint8_t> frame;
+  frame.swap(fifo);
+  FieldCard* active = activeCard();
+  bool ok = active != nullptr && frame.size() >= 12 &&
+            frame[0] == MFRC522::PICC_CMD_MF_AUTH_KEY_A && frame[1] < 64 &&
+            memcmp(frame.data() + 2, active->card.keyA[frame[1] / 4], 6) == 0 &&
+            memcmp(frame.data() + 8, active->card.uid + active->card.length - 4, 4) == 0;
+  if (!ok) {
+    if (active != nullptr)
+      active->state = FieldCard::IDLE;
+    timeOut();
+    return;
+  }
+  active->authSector = frame[1] / 4;
+  pending = Pending();
+  pending.active = true;
+  pending.atUs = hostMicros() + AUTH_US;
+  pending.irq = 0x10; // IdleIRq
+  pending.crypto = true;
+}
+
+void HostMfrc522Chip::addCard(const HostCard& card) {
+  hostHeapPause(true);
+  field.push_back({card, FieldCard::IDLE, 1, -1, -1});
+  hostHeapPause(false);
+}
+
+bool HostMfrc522Chip::removeCard(const uint8_t* uid, uint8_t length) {
+  for (auto it = field.begin(); it != field.end(); ++it) {
+    if (it->card.length == length && memcmp(it->card.uid, uid, length) == 0) {
+      field.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void HostMfrc522Chip::clearField() {
+  field.clear();
+}
+
+size_t HostMfrc522Chip::cardsInField() const {
+  return field.size();
+}
+
+const HostCard* HostMfrc522Chip::card(const uint8_t* uid, uint8_t length) const {
+  for (const FieldCard& card : field)
+    if (card.card.length == length && memcmp(card.card.uid, uid, length) == 0)
+      return &card.card;
+  return nullptr;
+}
+
+uint8_t HostMfrc522Chip::reg(MFRC522::PCD_Register reg) const {
+  return regs[reg >> 1];
+}
+
+HostMfrc522Chip& hostMfrc522Chip(uint8_t csPin) {
+  static std::vector<std::unique_ptr<HostMfrc522Chip>> chips;
+  for (auto& chip : chips)
+    if (chip->csPin == csPin)
+      return *chip;
+  hostHeapPause(true);
+  chips.emplace_back(new HostMfrc522Chip(csPin));
+  hostHeapPause(false);
+  hostSpiAttach(chips.back().get());
+  return *chips.back();
+}
+
+HostCard hostCard(const char* uidText) {
+  HostCard card = {};
+  while (*uidText != '\0' && card.length < sizeof(card.uid)) {
+    if (*uidText == ':') {
+      uidText++;
+      continue;
+    }
+    char digits[3] = {uidText[0], uidText[1], '\0'};
+    card.uid[card.length++] = strtoul(digits, nullptr, 16);
+    uidText += 2;
+  }
+  card.sak = 0x08;
+  memset(card.keyA, 0xFF, sizeof(card.keyA));
+  return card;
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+// Host stand-in for the MFRC522 library (miguelbalboa/MFRC522 1.4.x) and the
+// chip it talks to. The library half follows the real one register access by
+// register access, one SPI transaction each, so its bus time is what the device
+// pays. The chip half (HostMfrc522Chip) answers on the simulated SPI bus with
+// ISO 14443A cards in its field: REQA/WUPA, bit-wise anticollision over up to
+// three cascade levels, select, HLTA and MIFARE Classic authenticate, read and
+// write. Authentication compares keys instead of running Crypto1.
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#include <memory>
+
+#ifndef MFRC522_SPICLOCK
+#define MFRC522_SPICLOCK (4000000u)
+#endif
+
+class MFRC522 {
+public:
+  enum PCD_Register : byte {
+    CommandReg = 0x01 << 1,
+    ComIEnReg = 0x02 << 1,
+    DivIEnReg = 0x03 << 1,
+    ComIrqReg = 0x04 << 1,
+    DivIrqReg = 0x05 << 1,
+    ErrorReg = 0x06 << 1,
+    Status1Reg = 0x07 << 1,
+    Status2Reg = 0x08 << 1,
+    FIFODataReg = 0x09 << 1,
+    FIFOLevelReg = 0x0A << 1,
+    WaterLevelReg = 0x0B << 1,
+    ControlReg = 0x0C << 1,
+    BitFramingReg = 0x0D << 1,
+    CollReg = 0x0E << 1,
+    ModeReg = 0x11 << 1,
+    TxModeReg = 0x12 << 1,
+    RxModeReg = 0x13 << 1,
+    TxControlReg = 0x14 << 1,
+    TxASKReg = 0x15 << 1,
+    CRCResultRegH = 0x21 << 1,
+    CRCResultRegL = 0x22 << 1,
+    ModWidthReg = 0x24 << 1,
+    RFCfgReg = 0x26 << 1,
+    TModeReg = 0x2A << 1,
+    TPrescalerReg = 0x2B << 1,
+    TReloadRegH = 0x2C << 1,
+    TReloadRegL = 0x2D << 1,
+    VersionReg = 0x37 << 1,
+  };
+
+  enum PCD_Command : byte {
+    PCD_Idle = 0x00,
+    PCD_Mem = 0x01,
+    PCD_CalcCRC = 0x03,
+    PCD_Transmit = 0x04,
+    PCD_Receive = 0x08,
+    PCD_Transceive = 0x0C,
+    PCD_MFAuthent = 0x0E,
+    PCD_SoftReset = 0x0F,
+  };
+
+  enum PICC_Command : byte {
+    PICC_CMD_REQA = 0x26,
+    PICC_CMD_WUPA = 0x52,
+    PICC_CMD_CT = 0x88,
+    PICC_CMD_SEL_CL1 = 0x93,
+    PICC_CMD_SEL_CL2 = 0x95,
+    PICC_CMD_SEL_CL3 = 0x97,
+    PICC_CMD_HLTA = 0x50,
+    PICC_CMD_MF_AUTH_KEY_A = 0x60,
+    PICC_CMD_MF_AUTH_KEY_B = 0x61,
+    PICC_CMD_MF_READ = 0x30,
+    PICC_CMD_MF_WRITE = 0xA0,
+  };
+
+  enum StatusCode : byte {
+    STATUS_OK,
+    STATUS_ERROR,
+    STATUS_COLLISION,
+    STATUS_TIMEOUT,
+    STATUS_NO_ROOM,
+    STATUS_INTERNAL_ERROR,
+    STATUS_INVALID,
+    STATUS_CRC_WRONG,
+    STATUS_MIFARE_NACK = 0xff
+  };
+
+  typedef struct {
+    byte size;
+    byte uidByte[10];
+    byte sak;
+  } Uid;
+
+  typedef struct {
+    byte keyByte[6];
+  } MIFARE_Key;
+
+  Uid uid = {};
+
+  MFRC522(byte chipSelectPin, byte resetPowerDownPin)
+      : chipSelectPin(chipSelectPin), resetPowerDownPin(resetPowerDownPin) {}
+
+  void PCD_Init();
+  void PCD_WriteRegister(PCD_Register reg, byte value);
+  void PCD_WriteRegister(PCD_Register reg, byte count, byte* values);
+  byte PCD_ReadRegister(PCD_Register reg);
+  void PCD_ReadRegister(PCD_Register reg, byte count, byte* values, byte rxAlign = 0);
+  void PCD_SetRegisterBitMask(PCD_Register reg, byte mask);
+  void PCD_ClearRegisterBitMask(PCD_Register reg, byte mask);
+  StatusCode PCD_CalculateCRC(byte* data, byte length, byte* result);
+  void PCD_AntennaOn();
+
+  StatusCode PCD_TransceiveData(byte* sendData, byte sendLen, byte* backData, byte* backLen,
+                                byte* validBits = nullptr, byte rxAlign = 0,
+                                bool checkCRC = false);
+  StatusCode PCD_CommunicateWithPICC(byte command, byte waitIRq, byte* sendData, byte sendLen,
+                                     byte* backData = nullptr, byte* backLen = nullptr,
+                                     byte* validBits = nullptr, byte rxAlign = 0,
+                                     bool checkCRC = false);
+
+  StatusCode PICC_RequestA(byte* bufferATQA, byte* bufferSize);
+  StatusCode PICC_WakeupA(byte* bufferATQA, byte* bufferSize);
+  StatusCode PICC_REQA_or_WUPA(byte command, byte* bufferATQA, byte* bufferSize);
+  StatusCode PICC_Select(Uid* uid, byte validBits = 0);
+  StatusCode PICC_HaltA();
+  bool PICC_IsNewCardPresent();
+  bool PICC_ReadCardSerial();
+
+  StatusCode PCD_Authenticate(byte command, byte blockAddr, MIFARE_Key* key, Uid* uid);
+  void PCD_StopCrypto1();
+  StatusCode MIFARE_Read(byte blockAddr, byte* buffer, byte* bufferSize);
+  StatusCode MIFARE_Write(byte blockAddr, byte* buffer, byte bufferSize);
+  StatusCode PCD_MIFARE_Transceive(byte* sendData, byte sendLen, bool acceptTimeout = false);
+
+  // ---- test controls ----
+
+  // the clock the library's own transactions run at; MFRC522_SPICLOCK until changed
+  static uint32_t hostSpiClock;
+
+private:
+  const byte chipSelectPin;
+  const byte resetPowerDownPin;
+};
+
+// ---- simulated chip and cards ----
+
+struct HostCard {
+  uint8_t uid[10];
+  uint8_t length; // 4, 7 or 10
+  uint8_t sak;    // final SAK, 0x08 for a MIFARE Classic 1K
+  uint8_t keyA[16][6];
+  uint8_t blocks[64][16];
+};
+
+class HostMfrc522Chip : public HostSpiDevice {
+public:
+  explicit HostMfrc522Chip(uint8_t csPin);
+
+  void frameStart() override;
+  uint8_t transfer(uint8_t out, uint32_t clock) override;
+
+  // the card enters the field idle, as a freshly presented one does
+  void addCard(const HostCard& card);
+  bool removeCard(const uint8_t* uid, uint8_t length);
+  void clearField();
+  size_t cardsInField() const;
+  const HostCard* card(const uint8_t* uid, uint8_t length) const;
+
+  void brownOut(); // registers back to power-on values, as after a supply dip
+  uint8_t reg(MFRC522::PCD_Register reg) const;
+
+  uint32_t maxClock = 10000000UL; // reads above it come back corrupted
+  uint8_t version = 0x92;         // MFRC522 v2.0
+  bool responding = true;         // false: MISO stuck high, as with a dead chip
+
+private:
+  struct FieldCard {
+    HostCard card;
+    enum { IDLE, READY, ACTIVE, HALT } state;
+    uint8_t level;      // cascade level being resolved while READY, 1..3
+    int8_t authSector;  // sector Crypto1 is running for, -1 if none
+    int16_t writeBlock; // block of a WRITE waiting for its data, -1 if none
+  };
+
+  struct Pending {
+    bool active = false;
+    uint64_t atUs = 0;
+    uint8_t irq = 0; // ComIrqReg bits to raise
+    std::vector<uint8_t> reply;
+    uint8_t lastBits = 0; // RxLastBits of the reply
+    uint8_t error = 0;
+    uint8_t collPos = 0; // CollReg CollPos, 0 if no collision
+    bool crypto = false; // set MFCrypto1On when done
+  };
+
+  void write(uint8_t address, uint8_t value);
+  uint8_t read(uint8_t address);
+  void settle();
+  void startCommand(uint8_t command);
+  void transceive();
+  void authenticate();
+  void finishAfter(uint32_t airUs, std::vector<uint8_t> reply, uint8_t lastBits = 0);
+  void timeOut();
+  std::vector<uint8_t> anticollision(uint8_t level, const std::vector<uint8_t>& frame,
+                                     uint8_t* error, uint8_t* collPos);
+  std::vector<uint8_t> select(uint8_t level, const std::vector<uint8_t>& frame);
+  FieldCard* activeCard();
+
+  uint8_t regs[64];
+  std::vector<uint8_t> fifo;
+  std::vector<FieldCard> field;
+  Pending pending;
+  uint8_t address = 0;
+  bool reading = false;
+  bool firstByte = true;
+};
+
+// the chip on that chip-select pin, created and put on the bus on first use
+HostMfrc522Chip& hostMfrc522Chip(uint8_t csPin);
+
+// a MIFARE Classic 1K with transport keys (FF x 6) and empty blocks
+HostCard hostCard(const char* uidText);
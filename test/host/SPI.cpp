@@ -0,0 +1,56 @@
+#include <SPI.h>
+
+SPIClass SPI;
+
+// function-local so devices can attach from other files' static initializers
+static std::vector<HostSpiDevice*>& devices() {
+  static std::vector<HostSpiDevice*> attached;
+  return attached;
+}
+
+static uint32_t bytesClocked = 0;
+static uint32_t pendingNs = 0; // below a microsecond, carried to the next charge
+
+static void charge(uint32_t ns) {
+  pendingNs += ns;
+  hostAdvanceMicros(pendingNs / 1000);
+  pendingNs %= 1000;
+}
+
+void SPIClass::beginTransaction(SPISettings settings) {
+  clock = settings.clock;
+  charge(HOST_SPI_TRANSACTION_NS);
+}
+
+uint8_t SPIClass::transfer(uint8_t out) {
+  charge(HOST_SPI_BYTE_NS + 8000000000ULL / clock);
+  bytesClocked++;
+
+  uint8_t in = 0xFF; // MISO floats high with no device driving it
+  for (HostSpiDevice* device : devices()) {
+    if (digitalRead(device->csPin) != LOW)
+      continue;
+    uint32_t writes = hostPinWrites(device->csPin);
+    if (writes != device->lastCsWrites) {
+      device->lastCsWrites = writes;
+      device->frameStart();
+    }
+    in &= device->transfer(out, clock);
+  }
+  return in;
+}
+
+void hostSpiAttach(HostSpiDevice* device) {
+  hostHeapPause(true);
+  devices().push_back(device);
+  hostHeapPause(false);
+}
+
+void hostSpiDetach(HostSpiDevice* device) {
+  std::vector<HostSpiDevice*>& list = devices();
+  list.erase(std::remove(list.begin(), list.end(), device), list.end());
+}
+
+uint32_t hostSpiBytes() {
+  return bytesClocked;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// Host stand-in for the ESP8266 SPI driver. Each byte goes to the simulated
+// device whose chip-select pin is low and moves the fake clock by its time on
+// the wire plus a fixed driver overhead, so bus traffic shows up in micros().
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+
+// rough costs of the ESP8266 driver on top of the bits on the wire
+const uint32_t HOST_SPI_TRANSACTION_NS = 2000; // beginTransaction() reprogramming the clock
+const uint32_t HOST_SPI_BYTE_NS = 600;         // register setup and busy-wait per transfer()
+
+struct SPISettings {
+  SPISettings() {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock) {
+    (void)bitOrder;
+    (void)dataMode;
+  }
+
+  uint32_t clock = 4000000UL;
+};
+
+/**
+ * A chip on the simulated bus. It sees every byte clocked while its
+ * chip-select pin is low, and a frame start whenever that pin was toggled since
+ * its last byte.
+ */
+class HostSpiDevice {
+public:
+  explicit HostSpiDevice(uint8_t csPin) : csPin(csPin) {}
+  virtual ~HostSpiDevice() {}
+
+  virtual void frameStart() {}
+  virtual uint8_t transfer(uint8_t out, uint32_t clock) = 0;
+
+  const uint8_t csPin;
+  uint32_t lastCsWrites = 0;
+};
+
+class SPIClass {
+public:
+  void begin() {}
+  void beginTransaction(SPISettings settings);
+  void endTransaction() {}
+  uint8_t transfer(uint8_t out);
+
+private:
+  uint32_t clock = 4000000UL;
+};
+
+extern SPIClass SPI;
+
+// ---- test controls ----
+
+void hostSpiAttach(HostSpiDevice* device);
+void hostSpiDetach(HostSpiDevice* device);
+uint32_t hostSpiBytes(); // bytes clocked since start
@@ -0,0 +1,37 @@
+#pragma once
+
+// Host stand-in for the HMAC part of BearSSL, with SHA-256 as the only hash.
+// Same names and call pattern as the real API, so securecard.cpp builds as is.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct br_hash_class_ br_hash_class;
+struct br_hash_class_ {
+  size_t desc; // output size in bytes
+};
+
+extern const br_hash_class br_sha256_vtable;
+
+typedef struct {
+  uint32_t state[8];
+  uint64_t count;
+  unsigned char buffer[64];
+} br_sha256_context;
+
+typedef struct {
+  const br_hash_class* dig_vtable;
+  uint32_t ksi[8], kso[8]; // hash states after the inner and outer key pads
+} br_hmac_key_context;
+
+typedef struct {
+  br_sha256_context dig;
+  uint32_t kso[8];
+  size_t out_len;
+} br_hmac_context;
+
+void br_hmac_key_init(br_hmac_key_context* kc, const br_hash_class* digest_vtable,
+                      const void* key, size_t key_len);
+void br_hmac_init(br_hmac_context* ctx, const br_hmac_key_context* kc, size_t out_len);
+void br_hmac_update(br_hmac_context* ctx, const void* data, size_t len);
+size_t br_hmac_out(const br_hmac_context* ctx, void* out);
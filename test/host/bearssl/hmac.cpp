@@ -0,0 +1,141 @@
+#include "bearssl_hmac.h"
+
+#include <string.h>
+
+const br_hash_class br_sha256_vtable = {32};
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+    0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+    0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+    0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+    0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+    0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+    0xc67178f2};
+
+static const uint32_t IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                               0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+static uint32_t ror(uint32_t x, int n) {
+  return x >> n | x << (32 - n);
+}
+
+static void compress(uint32_t* state, const unsigned char* block) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++)
+    w[i] = (uint32_t)block[4 * i] << 24 | block[4 * i + 1] << 16 | block[4 * i + 2] << 8 |
+           block[4 * i + 3];
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ w[i - 15] >> 3;
+    uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ w[i - 2] >> 10;
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+    uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+static void sha256Update(br_sha256_context* ctx, const void* data, size_t len) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  while (len > 0) {
+    size_t used = ctx->count % 64;
+    size_t take = len < 64 - used ? len : 64 - used;
+    memcpy(ctx->buffer + used, bytes, take);
+    ctx->count += take;
+    bytes += take;
+    len -= take;
+    if (ctx->count % 64 == 0)
+      compress(ctx->state, ctx->buffer);
+  }
+}
+
+static void sha256Out(const br_sha256_context* ctx, unsigned char* out) {
+  br_sha256_context copy = *ctx;
+  uint64_t bits = copy.count * 8;
+  unsigned char pad = 0x80;
+  sha256Update(&copy, &pad, 1);
+  pad = 0;
+  while (copy.count % 64 != 56)
+    sha256Update(&copy, &pad, 1);
+  unsigned char length[8];
+  for (int i = 0; i < 8; i++)
+    length[i] = bits >> (56 - 8 * i);
+  sha256Update(&copy, length, 8);
+  for (int i = 0; i < 8; i++) {
+    out[4 * i] = copy.state[i] >> 24;
+    out[4 * i + 1] = copy.state[i] >> 16;
+    out[4 * i + 2] = copy.state[i] >> 8;
+    out[4 * i + 3] = copy.state[i];
+  }
+}
+
+// hash state after one block of the key xor'ed with the pad byte
+static void padState(uint32_t* state, const unsigned char* key, unsigned char pad) {
+  unsigned char block[64];
+  for (int i = 0; i < 64; i++)
+    block[i] = key[i] ^ pad;
+  memcpy(state, IV, sizeof(IV));
+  compress(state, block);
+}
+
+void br_hmac_key_init(br_hmac_key_context* kc, const br_hash_class* digest_vtable,
+                      const void* key, size_t key_len) {
+  unsigned char block[64] = {};
+  if (key_len > 64) {
+    br_sha256_context ctx = {};
+    memcpy(ctx.state, IV, sizeof(IV));
+    sha256Update(&ctx, key, key_len);
+    sha256Out(&ctx, block);
+  } else {
+    memcpy(block, key, key_len);
+  }
+  kc->dig_vtable = digest_vtable;
+  padState(kc->ksi, block, 0x36);
+  padState(kc->kso, block, 0x5C);
+}
+
+void br_hmac_init(br_hmac_context* ctx, const br_hmac_key_context* kc, size_t out_len) {
+  memcpy(ctx->dig.state, kc->ksi, sizeof(kc->ksi));
+  ctx->dig.count = 64;
+  memcpy(ctx->kso, kc->kso, sizeof(kc->kso));
+  ctx->out_len = out_len == 0 || out_len > 32 ? 32 : out_len;
+}
+
+void br_hmac_update(br_hmac_context* ctx, const void* data, size_t len) {
+  sha256Update(&ctx->dig, data, len);
+}
+
+size_t br_hmac_out(const br_hmac_context* ctx, void* out) {
+  unsigned char inner[32];
+  sha256Out(&ctx->dig, inner);
+  br_sha256_context outer = {};
+  memcpy(outer.state, ctx->kso, sizeof(ctx->kso));
+  outer.count = 64;
+  sha256Update(&outer, inner, sizeof(inner));
+  unsigned char mac[32];
+  sha256Out(&outer, mac);
+  memcpy(out, mac, ctx->out_len);
+  return ctx->out_len;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in for the core's scheduler hooks; see ESP.forcedLightSleepBegin().
+
+#include <cstdint>
+#include <functional>
+
+// waits up to `timeout_ms` while `blocked` holds, or sleeps if a light sleep was requested
+void esp_delay(uint32_t timeout_ms, const std::function<bool()>& blocked, uint32_t intvl_ms = 0);
+void esp_schedule();
@@ -0,0 +1,21 @@
+#pragma once
+
+// Host stand-in for the SDK's GPIO wake-up calls; waking is a no-op on the host.
+
+#include <cstdint>
+
+#define GPIO_ID_PIN(n) (n)
+
+enum GPIO_INT_TYPE {
+  GPIO_PIN_INTR_DISABLE,
+  GPIO_PIN_INTR_POSEDGE,
+  GPIO_PIN_INTR_NEGEDGE,
+  GPIO_PIN_INTR_ANYEDGE,
+  GPIO_PIN_INTR_LOLEVEL,
+  GPIO_PIN_INTR_HILEVEL,
+};
+
+extern "C" {
+void gpio_pin_wakeup_enable(uint32_t pin, GPIO_INT_TYPE level);
+void gpio_pin_wakeup_disable();
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for the SDK's RTC clock, which keeps counting through light sleep.
+
+#include <cstdint>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t system_get_rtc_time();
+uint32_t system_rtc_clock_cali_proc();
+
+#ifdef __cplusplus
+}
+#endif
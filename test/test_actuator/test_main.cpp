@@ -0,0 +1,159 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "actuator.h"
+
+const uint8_t LOCK_PIN = D1;
+
+// the profile main.cpp drives the door with
+const ActuatorStep UNLOCK_PROFILE[] = {
+    {100, 300}, // pull-in, ms
+    {40, 0},    // hold until relock
+};
+const uint8_t UNLOCK_STEPS = sizeof(UNLOCK_PROFILE) / sizeof(UNLOCK_PROFILE[0]);
+
+// the lock pin's changes since the last call: value (0..range) and time from `since`
+struct Edge {
+  uint32_t value;
+  bool pwm;
+  uint32_t atMs;
+};
+
+static std::vector<Edge> edges(uint64_t sinceUs) {
+  std::vector<Edge> out;
+  for (const HostPinEvent& event : hostPinEvents())
+    if (event.pin == LOCK_PIN)
+      out.push_back({event.value, event.pwm, (uint32_t)((event.atUs - sinceUs) / 1000)});
+  hostClearPinEvents();
+  return out;
+}
+
+// loop() passes every `periodMs` for `totalMs`
+static void runLoop(uint32_t totalMs, uint32_t periodMs) {
+  for (uint32_t t = 0; t < totalMs; t += periodMs) {
+    hostAdvanceMillis(periodMs);
+    actuatorUpdate();
+  }
+}
+
+void setUp() {
+  actuatorBegin(LOCK_PIN, 1000);
+  hostClearPinEvents();
+}
+
+void tearDown() {
+  actuatorRelease();
+}
+
+void test_begin_leaves_the_actuator_off() {
+  hostClearPinEvents();
+  actuatorBegin(LOCK_PIN, 20000);
+  std::vector<Edge> out = edges(hostMicros());
+  TEST_ASSERT_EQUAL(1, out.size());
+  TEST_ASSERT_EQUAL_UINT32(0, out[0].value);
+  TEST_ASSERT_EQUAL_UINT32(255, hostAnalogRange());
+  TEST_ASSERT_EQUAL_UINT32(20000, hostAnalogFrequency());
+}
+
+void test_pull_in_then_hold_at_the_programmed_duty() {
+  uint64_t start = hostMicros();
+  actuatorEngage(UNLOCK_PROFILE, UNLOCK_STEPS);
+  runLoop(7000, 1);
+  actuatorRelease();
+
+  std::vector<Edge> out = edges(start);
+  TEST_ASSERT_EQUAL(3, out.size());
+  TEST_ASSERT_FALSE(out[0].pwm); // full power is a plain HIGH, not 100% PWM
+  TEST_ASSERT_EQUAL_UINT32(255, out[0].value);
+  TEST_ASSERT_EQUAL_UINT32(0, out[0].atMs);
+
+  TEST_ASSERT_TRUE(out[1].pwm);
+  TEST_ASSERT_EQUAL_UINT32(40 * 255 / 100, out[1].value);
+  TEST_ASSERT_EQUAL_UINT32(300, out[1].atMs);
+
+  TEST_ASSERT_FALSE(out[2].pwm);
+  TEST_ASSERT_EQUAL_UINT32(0, out[2].value);
+  TEST_ASSERT_EQUAL_UINT32(7000, out[2].atMs);
+}
+
+// the step change waits for loop(): it is late by at most one pass, never early
+void test_step_timing_follows_the_loop_period() {
+  char message[64];
+  for (uint32_t period : {1, 5, 20, 50}) {
+    hostClearPinEvents();
+    uint64_t start = hostMicros();
+    actuatorEngage(UNLOCK_PROFILE, UNLOCK_STEPS);
+    runLoop(1000, period);
+    actuatorRelease();
+
+    std::vector<Edge> out = edges(start);
+    TEST_ASSERT_EQUAL(3, out.size());
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(300, out[1].atMs);
+    TEST_ASSERT_LESS_THAN_UINT32(300 + period, out[1].atMs);
+    snprintf(message, sizeof(message), "loop every %lu ms: hold starts at %lu ms",
+             (unsigned long)period, (unsigned long)out[1].atMs);
+    TEST_MESSAGE(message);
+  }
+}
+
+void test_release_during_pull_in_stops_the_profile() {
+  uint64_t start = hostMicros();
+  actuatorEngage(UNLOCK_PROFILE, UNLOCK_STEPS);
+  runLoop(100, 1);
+  actuatorRelease();
+  runLoop(1000, 1);
+
+  std::vector<Edge> out = edges(start);
+  TEST_ASSERT_EQUAL(2, out.size());
+  TEST_ASSERT_EQUAL_UINT32(0, out[1].value);
+  TEST_ASSERT_EQUAL_UINT32(100, out[1].atMs);
+}
+
+void test_multi_step_profile() {
+  const ActuatorStep kick[] = {{100, 50}, {0, 20}, {100, 50}, {25, 0}};
+  uint64_t start = hostMicros();
+  actuatorEngage(kick, 4);
+  runLoop(500, 1);
+
+  std::vector<Edge> out = edges(start);
+  TEST_ASSERT_EQUAL(4, out.size());
+  const uint32_t values[] = {255, 0, 255, 25 * 255 / 100};
+  const uint32_t times[] = {0, 50, 70, 120};
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_UINT32(values[i], out[i].value);
+    TEST_ASSERT_EQUAL_UINT32(times[i], out[i].atMs);
+  }
+  TEST_ASSERT_TRUE(out[3].pwm);
+}
+
+void test_re_engaging_restarts_the_pull_in() {
+  uint64_t start = hostMicros();
+  actuatorEngage(UNLOCK_PROFILE, UNLOCK_STEPS);
+  runLoop(1000, 1);
+  actuatorEngage(UNLOCK_PROFILE, UNLOCK_STEPS); // a second card during the window
+  runLoop(1000, 1);
+
+  std::vector<Edge> out = edges(start);
+  TEST_ASSERT_EQUAL(4, out.size());
+  TEST_ASSERT_EQUAL_UINT32(255, out[2].value);
+  TEST_ASSERT_EQUAL_UINT32(1000, out[2].atMs);
+  TEST_ASSERT_EQUAL_UINT32(1300, out[3].atMs);
+}
+
+void test_empty_profile_is_ignored() {
+  actuatorEngage(UNLOCK_PROFILE, 0);
+  runLoop(1000, 10);
+  TEST_ASSERT_EQUAL(0, edges(hostMicros()).size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_leaves_the_actuator_off);
+  RUN_TEST(test_pull_in_then_hold_at_the_programmed_duty);
+  RUN_TEST(test_step_timing_follows_the_loop_period);
+  RUN_TEST(test_release_during_pull_in_stops_the_profile);
+  RUN_TEST(test_multi_step_profile);
+  RUN_TEST(test_re_engaging_restarts_the_pull_in);
+  RUN_TEST(test_empty_profile_is_ignored);
+  return UNITY_END();
+}
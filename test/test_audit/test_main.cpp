@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "audit.h"
+#include "timekeeper.h"
+
+const uint32_t EPOCH = 1767225600; // 2026-01-01 00:00 local
+
+static std::vector<std::string> lines;
+
+static void capture(const char* line, size_t length) {
+  lines.push_back(std::string(line, length));
+}
+
+static std::vector<std::string> stream(uint32_t from = 0, uint32_t to = UINT32_MAX) {
+  lines.clear();
+  auditStream(from, to, capture);
+  return lines;
+}
+
+// the index-th test card, 4 bytes
+static UidKey card(uint32_t index) {
+  uint8_t bytes[4] = {0xAA, (uint8_t)(index >> 16), (uint8_t)(index >> 8), (uint8_t)index};
+  return makeUidKey(bytes, 4);
+}
+
+// one record a second, written out whenever a page is ready, as loop() would
+static void appendRecords(uint32_t count, uint32_t firstCard = 0) {
+  for (uint32_t i = 0; i < count; i++) {
+    hostAdvanceMillis(1000);
+    auditAppend(card(firstCard + i), 0, ACCESS_GRANTED);
+    auditService();
+  }
+}
+
+static void flush() {
+  hostAdvanceMillis(AUDIT_FLUSH_MS);
+  auditService();
+}
+
+void setUp() {
+  hostSerialQuiet(true);
+  flush(); // nothing from the last test is left in RAM
+  LittleFS.hostFormat();
+  TEST_ASSERT_TRUE(auditBegin());
+}
+
+void tearDown() {
+  hostSerialQuiet(false);
+}
+
+// runs first: the clock cannot be unset once a test has set it
+void test_records_before_the_clock_is_set_are_marked_boot() {
+  hostAdvanceMillis(5000);
+  uint32_t sinceBoot = millis() / 1000;
+  auditAppend(card(1), 1, DENIED_UNKNOWN);
+  std::vector<std::string> out = stream();
+  TEST_ASSERT_EQUAL(1, out.size());
+  char expected[48];
+  snprintf(expected, sizeof(expected), "%lu+boot,AA:00:00:01,1,unknown\n",
+           (unsigned long)sinceBoot);
+  TEST_ASSERT_EQUAL_STRING(expected, out[0].c_str());
+
+  setClock(EPOCH);
+  auditAppend(card(2), 0, ACCESS_GRANTED);
+  out = stream();
+  TEST_ASSERT_EQUAL(2, out.size());
+  snprintf(expected, sizeof(expected), "%lu,AA:00:00:02,0,granted\n", (unsigned long)EPOCH);
+  TEST_ASSERT_EQUAL_STRING(expected, out[1].c_str());
+}
+
+void test_records_wait_in_ram_until_a_page_or_the_deadline() {
+  uint32_t written = LittleFS.hostBytesWritten();
+  appendRecords(AUDIT_BUFFER_RECORDS - 1);
+  TEST_ASSERT_EQUAL_UINT32(written, LittleFS.hostBytesWritten());
+  TEST_ASSERT_EQUAL(AUDIT_BUFFER_RECORDS - 1, stream().size()); // streamed from RAM
+
+  appendRecords(1);
+  TEST_ASSERT_EQUAL_UINT32(written + AUDIT_BUFFER_RECORDS * sizeof(AuditRecord),
+                           LittleFS.hostBytesWritten());
+
+  appendRecords(1);
+  hostAdvanceMillis(AUDIT_FLUSH_MS - 1000);
+  auditService();
+  TEST_ASSERT_EQUAL_UINT32(written + AUDIT_BUFFER_RECORDS * sizeof(AuditRecord),
+                           LittleFS.hostBytesWritten());
+  hostAdvanceMillis(1000);
+  auditService();
+  TEST_ASSERT_EQUAL(AUDIT_BUFFER_RECORDS + 1, LittleFS.open("/audit/0.bin", "r").size() / 16);
+}
+
+// a burst that keeps auditService() from running drops records instead of writing inline
+void test_full_buffer_drops_and_counts() {
+  uint32_t written = LittleFS.hostBytesWritten();
+  uint32_t droppedBefore = auditDropped();
+  for (uint32_t i = 0; i < AUDIT_BUFFER_RECORDS + 3; i++)
+    auditAppend(card(i), 0, ACCESS_GRANTED);
+  TEST_ASSERT_EQUAL_UINT32(written, LittleFS.hostBytesWritten());
+  TEST_ASSERT_EQUAL_UINT32(droppedBefore + 3, auditDropped());
+
+  auditService();
+  TEST_ASSERT_EQUAL(AUDIT_BUFFER_RECORDS, stream().size());
+}
+
+// a fifth file pushes out the oldest; the stream stays in order across the files
+void test_rotation_keeps_the_newest_four_files() {
+  const uint32_t total = AUDIT_FILES * AUDIT_FILE_RECORDS + 40;
+  uint32_t start = clockNow();
+  appendRecords(total);
+  flush();
+
+  TEST_ASSERT_FALSE(LittleFS.exists("/audit/0.bin"));
+  for (uint32_t sequence = 1; sequence <= AUDIT_FILES; sequence++) {
+    char path[24];
+    snprintf(path, sizeof(path), "/audit/%lu.bin", (unsigned long)sequence);
+    TEST_ASSERT_TRUE_MESSAGE(LittleFS.exists(path), path);
+  }
+
+  std::vector<std::string> out = stream();
+  uint32_t kept = (AUDIT_FILES - 1) * AUDIT_FILE_RECORDS + 40;
+  TEST_ASSERT_EQUAL(kept, out.size());
+  uint32_t previous = 0;
+  for (const std::string& line : out) {
+    uint32_t time = strtoul(line.c_str(), nullptr, 10);
+    TEST_ASSERT_GREATER_THAN_UINT32(previous, time);
+    previous = time;
+  }
+  TEST_ASSERT_EQUAL_UINT32(start + total, previous);
+  TEST_ASSERT_EQUAL_UINT32(start + total - kept + 1, strtoul(out[0].c_str(), nullptr, 10));
+
+  // the files are found again after a reboot, and appending carries on in the newest
+  TEST_ASSERT_TRUE(auditBegin());
+  appendRecords(1);
+  flush();
+  TEST_ASSERT_EQUAL(kept + 1, stream().size());
+}
+
+void test_from_and_to_are_inclusive() {
+  uint32_t start = clockNow();
+  appendRecords(10);
+  TEST_ASSERT_EQUAL(10, stream().size());
+  TEST_ASSERT_EQUAL(3, stream(start + 4, start + 6).size());
+  TEST_ASSERT_EQUAL(1, stream(start + 10, start + 10).size());
+  TEST_ASSERT_EQUAL(0, stream(start + 11).size());
+  TEST_ASSERT_EQUAL(5, stream(0, start + 5).size());
+}
+
+// power lost in the middle of an append leaves part of a record at the end of the file
+void test_partial_record_is_cut_at_boot() {
+  flush();
+  appendRecords(3);
+  flush();
+  std::string bytes = LittleFS.hostRead("/audit/0.bin");
+  TEST_ASSERT_EQUAL(3 * sizeof(AuditRecord), bytes.size());
+  LittleFS.hostWrite("/audit/0.bin", bytes + std::string("\x01\x02\x03\x04\x05\x06\x07", 7));
+
+  TEST_ASSERT_TRUE(auditBegin());
+  TEST_ASSERT_EQUAL(3 * sizeof(AuditRecord), LittleFS.hostRead("/audit/0.bin").size());
+
+  appendRecords(2, 100);
+  flush();
+  std::vector<std::string> out = stream();
+  TEST_ASSERT_EQUAL(5, out.size());
+  TEST_ASSERT_TRUE(out[3].find(",AA:00:00:64,0,granted\n") != std::string::npos);
+  TEST_ASSERT_TRUE(out[4].find(",AA:00:00:65,0,granted\n") != std::string::npos);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_before_the_clock_is_set_are_marked_boot);
+  RUN_TEST(test_records_wait_in_ram_until_a_page_or_the_deadline);
+  RUN_TEST(test_full_buffer_drops_and_counts);
+  RUN_TEST(test_rotation_keeps_the_newest_four_files);
+  RUN_TEST(test_from_and_to_are_inclusive);
+  RUN_TEST(test_partial_record_is_cut_at_boot);
+  return UNITY_END();
+}
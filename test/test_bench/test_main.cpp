@@ -0,0 +1,156 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// the nodemcuv2_bench firmware: benchTap() and the "bench" command come from main.cpp
+#include "main.cpp"
+
+// 4 format and parse, 3 lookups of registered cards, 18 of generated ones, 3 taps, 1 append
+const uint32_t RESULTS = 29;
+
+static std::string report;
+
+// the value of `field` in the result line that contains all of `match`, -1 if there is none
+static long resultField(const char* match, const char* field) {
+  char key[24];
+  snprintf(key, sizeof(key), "\"%s\":", field);
+  size_t at = report.find(match);
+  if (at == std::string::npos)
+    return -1;
+  size_t end = report.find('}', at);
+  size_t value = report.find(key, report.rfind('{', at));
+  if (value == std::string::npos || value > end)
+    return -1;
+  return strtol(report.c_str() + value + strlen(key), nullptr, 10);
+}
+
+static uint32_t occurrences(const char* text) {
+  uint32_t count = 0;
+  for (size_t at = report.find(text); at != std::string::npos; at = report.find(text, at + 1))
+    count++;
+  return count;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// boots with four registered cards and sends "bench", as from the serial monitor
+void test_bench_command_prints_one_json_document() {
+  hostSerialQuiet(true);
+  LittleFS.hostWrite("/uids.txt", "AA:BB:CC:01,Admin,A\n"
+                                  "AA:BB:CC:02,Alice,U\n"
+                                  "AA:BB:CC:03,Bob,U\n"
+                                  "AA:BB:CC:04,Carol,U\n");
+  setup();
+  TEST_ASSERT_EQUAL_UINT32(4, credentialCount());
+
+  hostClearSerialOutput();
+  hostSerialInput("bench\n");
+  hostAdvanceMillis(10);
+  loop();
+  hostSerialQuiet(false);
+
+  const std::string& output = hostSerialOutput();
+  size_t start = output.find("{\"build\"");
+  size_t end = output.find("\n]}", start);
+  TEST_ASSERT_TRUE(start != std::string::npos);
+  TEST_ASSERT_TRUE(end != std::string::npos);
+  report = output.substr(start, end + 3 - start);
+  printf("%s\n", report.c_str());
+
+  // BENCH_JSON=<file> keeps the report, to compare against the next firmware version
+  const char* path = getenv("BENCH_JSON");
+  if (path != nullptr) {
+    FILE* file = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    fprintf(file, "%s\n", report.c_str());
+    fclose(file);
+  }
+}
+
+// one result per line, and no log line printed in between
+void test_report_is_one_result_per_line() {
+  size_t line = report.find('\n') + 1;
+  const char* header = "\"results\":[\n";
+  TEST_ASSERT_EQUAL_STRING(header, report.substr(line - strlen(header), strlen(header)).c_str());
+  uint32_t results = 0;
+  for (size_t next = report.find('\n', line); next != std::string::npos;
+       line = next + 1, next = report.find('\n', line)) {
+    std::string text = report.substr(line, next - line);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("    {\"name\":\"", text.substr(0, 13).c_str(), text.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(text.back() == '}' || text.substr(text.size() - 2) == "},",
+                             text.c_str());
+    results++;
+  }
+  TEST_ASSERT_EQUAL_STRING("]}", report.substr(line).c_str());
+  TEST_ASSERT_EQUAL_UINT32(RESULTS, results);
+}
+
+void test_every_scenario_is_reported() {
+  TEST_ASSERT_EQUAL_UINT32(RESULTS, occurrences("\"mean_ns\":"));
+  TEST_ASSERT_EQUAL_UINT32(2, occurrences("\"name\":\"format\""));
+  TEST_ASSERT_EQUAL_UINT32(2, occurrences("\"name\":\"parse\""));
+  TEST_ASSERT_EQUAL_UINT32(3, occurrences("\"layout\":\"sorted\",\"cards\":4"));
+  TEST_ASSERT_EQUAL_UINT32(18, occurrences("\"layout\":\"synthetic\""));
+  TEST_ASSERT_EQUAL_UINT32(3, occurrences("\"name\":\"tap\""));
+  TEST_ASSERT_EQUAL_UINT32(1, occurrences("\"name\":\"register_append\""));
+
+  char match[96];
+  for (uint16_t cards : {16, 128, 512}) {
+    for (uint8_t length : {4, 7}) {
+      for (const char* which : {"hit", "miss", "near_miss"}) {
+        snprintf(match, sizeof(match), "\"cards\":%u,\"uid_bytes\":%u,\"case\":\"%s\"", cards,
+                 length, which);
+        TEST_ASSERT_EQUAL_MESSAGE(BENCH_ITERATIONS, resultField(match, "n"), match);
+      }
+    }
+  }
+  TEST_ASSERT_EQUAL(BENCH_APPENDS, resultField("register_append", "n"));
+}
+
+// only registered cards unlock; a one-bit near miss is a miss
+void test_taps_are_decided_like_the_door_would() {
+  TEST_ASSERT_EQUAL(BENCH_ITERATIONS, resultField("\"case\":\"hit\",\"granted\"", "granted"));
+  TEST_ASSERT_EQUAL(0, resultField("\"case\":\"miss\",\"granted\"", "granted"));
+  TEST_ASSERT_EQUAL(0, resultField("\"case\":\"near_miss\",\"granted\"", "granted"));
+}
+
+void test_worst_time_is_never_below_the_mean() {
+  for (size_t at = report.find("\"mean_ns\":"); at != std::string::npos;
+       at = report.find("\"mean_ns\":", at + 1)) {
+    long mean = strtol(report.c_str() + at + 10, nullptr, 10);
+    long worst = strtol(report.c_str() + report.find("\"max_ns\":", at) + 9, nullptr, 10);
+    TEST_ASSERT_LESS_OR_EQUAL(worst, mean);
+  }
+}
+
+// the generated tables are swapped out again and nothing was written or left behind
+void test_registered_cards_are_restored() {
+  UidKey alice;
+  TEST_ASSERT_TRUE(parseUidKey("AA:BB:CC:02", &alice));
+  TEST_ASSERT_EQUAL_UINT32(4, credentialCount());
+  TEST_ASSERT_NOT_NULL(findCredential(alice));
+  TEST_ASSERT_FALSE(LittleFS.exists("/bench.txt"));
+  TEST_ASSERT_EQUAL_STRING("AA:BB:CC:01,Admin,A\n"
+                           "AA:BB:CC:02,Alice,U\n"
+                           "AA:BB:CC:03,Bob,U\n"
+                           "AA:BB:CC:04,Carol,U\n",
+                           LittleFS.hostRead("/uids.txt").c_str());
+  TEST_ASSERT_FALSE(isUnlocked);
+  TEST_ASSERT_TRUE(actuatorQueue.empty());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_command_prints_one_json_document);
+  RUN_TEST(test_report_is_one_result_per_line);
+  RUN_TEST(test_every_scenario_is_reported);
+  RUN_TEST(test_taps_are_decided_like_the_door_would);
+  RUN_TEST(test_worst_time_is_never_below_the_mean);
+  RUN_TEST(test_registered_cards_are_restored);
+  return UNITY_END();
+}
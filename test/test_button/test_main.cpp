@@ -0,0 +1,173 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "button.h"
+
+const uint8_t BUTTON_PIN = D3;
+const unsigned long DEBOUNCE_MS = 30;
+const unsigned long LONG_PRESS_MS = 1500;
+const unsigned long DOUBLE_PRESS_MS = 400;
+
+// one level change on the pin, in µs from the start of the trace
+struct Change {
+  uint32_t atUs;
+  uint8_t level;
+};
+
+struct Report {
+  ButtonGesture gesture;
+  uint32_t atMs;
+};
+
+// a switch closing (LOW) or opening with `bounces` extra flips, 300 µs apart
+static void edge(std::vector<Change>& trace, uint32_t atMs, uint8_t level, int bounces = 4) {
+  uint32_t at = atMs * 1000;
+  for (int i = 0; i < bounces; i++) {
+    trace.push_back({at, level});
+    trace.push_back({at + 150, (uint8_t)!level});
+    at += 300;
+  }
+  trace.push_back({at, level});
+}
+
+/**
+ * Plays a trace on the pin (each change runs the interrupt) while loop() polls
+ * every `loopMs`, and returns the gestures with the time they were reported.
+ */
+static std::vector<Report> play(const std::vector<Change>& trace, uint32_t totalMs,
+                                uint32_t loopMs = 1) {
+  std::vector<Report> reports;
+  uint64_t start = hostMicros();
+  size_t next = 0;
+  for (uint32_t us = 0; us <= totalMs * 1000; us += 50) {
+    hostAdvanceMicros(start + us - hostMicros());
+    while (next < trace.size() && trace[next].atUs <= us)
+      hostSetPin(BUTTON_PIN, trace[next++].level);
+    if (us % (loopMs * 1000) == 0) {
+      ButtonGesture gesture = buttonPoll();
+      if (gesture != GESTURE_NONE)
+        reports.push_back({gesture, us / 1000});
+    }
+  }
+  return reports;
+}
+
+void setUp() {
+  hostSetPin(BUTTON_PIN, HIGH);
+  buttonBegin(BUTTON_PIN, DEBOUNCE_MS, LONG_PRESS_MS, DOUBLE_PRESS_MS);
+  // let whatever the last test left complete
+  for (int i = 0; i < 10; i++) {
+    hostAdvanceMillis(LONG_PRESS_MS);
+    buttonPoll();
+  }
+}
+
+void tearDown() {}
+
+void test_clean_short_press() {
+  std::vector<Change> trace;
+  edge(trace, 10, LOW, 0);
+  edge(trace, 150, HIGH, 0);
+  std::vector<Report> reports = play(trace, 1000);
+  TEST_ASSERT_EQUAL(1, reports.size());
+  TEST_ASSERT_EQUAL(GESTURE_SHORT, reports[0].gesture);
+  TEST_ASSERT_EQUAL_UINT32(150 + DOUBLE_PRESS_MS, reports[0].atMs);
+  TEST_ASSERT_FALSE(buttonBusy());
+}
+
+void test_bouncing_press_is_one_short_press() {
+  for (int bounces : {1, 4, 20}) {
+    std::vector<Change> trace;
+    edge(trace, 10, LOW, bounces);
+    edge(trace, 150, HIGH, bounces);
+    std::vector<Report> reports = play(trace, 1000);
+    TEST_ASSERT_EQUAL(1, reports.size());
+    TEST_ASSERT_EQUAL(GESTURE_SHORT, reports[0].gesture);
+    TEST_ASSERT_EQUAL_UINT32(150 + DOUBLE_PRESS_MS, reports[0].atMs);
+  }
+}
+
+void test_long_press_is_reported_while_held() {
+  std::vector<Change> trace;
+  edge(trace, 10, LOW);
+  edge(trace, 3000, HIGH);
+  std::vector<Report> reports = play(trace, 4000);
+  TEST_ASSERT_EQUAL(1, reports.size());
+  TEST_ASSERT_EQUAL(GESTURE_LONG, reports[0].gesture);
+  TEST_ASSERT_EQUAL_UINT32(10 + LONG_PRESS_MS, reports[0].atMs);
+}
+
+void test_bouncing_double_press() {
+  std::vector<Change> trace;
+  edge(trace, 10, LOW);
+  edge(trace, 120, HIGH);
+  edge(trace, 300, LOW);
+  edge(trace, 420, HIGH);
+  std::vector<Report> reports = play(trace, 1500);
+  TEST_ASSERT_EQUAL(1, reports.size());
+  TEST_ASSERT_EQUAL(GESTURE_DOUBLE, reports[0].gesture);
+  TEST_ASSERT_EQUAL_UINT32(420, reports[0].atMs);
+}
+
+void test_presses_outside_the_double_window_are_two_short_presses() {
+  std::vector<Change> trace;
+  edge(trace, 10, LOW);
+  edge(trace, 120, HIGH);
+  edge(trace, 120 + DOUBLE_PRESS_MS + 50, LOW);
+  edge(trace, 120 + DOUBLE_PRESS_MS + 150, HIGH);
+  std::vector<Report> reports = play(trace, 2000);
+  TEST_ASSERT_EQUAL(2, reports.size());
+  TEST_ASSERT_EQUAL(GESTURE_SHORT, reports[0].gesture);
+  TEST_ASSERT_EQUAL(GESTURE_SHORT, reports[1].gesture);
+}
+
+// the release bounces, and its last flip lands inside the window the press opened
+void test_release_inside_the_debounce_window_is_caught_up() {
+  std::vector<Change> trace;
+  edge(trace, 10, LOW, 0);
+  edge(trace, 25, HIGH, 4);
+  std::vector<Report> reports = play(trace, 1000);
+  TEST_ASSERT_EQUAL(1, reports.size());
+  TEST_ASSERT_EQUAL(GESTURE_SHORT, reports[0].gesture);
+  // the release is taken when the window closes, at 10 + 30 ms
+  TEST_ASSERT_EQUAL_UINT32(10 + DEBOUNCE_MS + DOUBLE_PRESS_MS, reports[0].atMs);
+}
+
+// edges are timestamped by the interrupt, so a busy loop() does not turn a double into shorts
+void test_gestures_survive_a_slow_loop() {
+  std::vector<Change> trace;
+  edge(trace, 10, LOW);
+  edge(trace, 120, HIGH);
+  edge(trace, 300, LOW);
+  edge(trace, 420, HIGH);
+  std::vector<Report> reports = play(trace, 2000, 500);
+  TEST_ASSERT_EQUAL(1, reports.size());
+  TEST_ASSERT_EQUAL(GESTURE_DOUBLE, reports[0].gesture);
+  TEST_ASSERT_EQUAL_UINT32(500, reports[0].atMs);
+}
+
+void test_busy_until_the_gesture_completes() {
+  hostSetPin(BUTTON_PIN, LOW);
+  TEST_ASSERT_TRUE(buttonBusy());
+  hostAdvanceMillis(100);
+  TEST_ASSERT_EQUAL(GESTURE_NONE, buttonPoll());
+  hostSetPin(BUTTON_PIN, HIGH);
+  TEST_ASSERT_EQUAL(GESTURE_NONE, buttonPoll());
+  TEST_ASSERT_TRUE(buttonBusy()); // a second press may still follow
+  hostAdvanceMillis(DOUBLE_PRESS_MS);
+  TEST_ASSERT_EQUAL(GESTURE_SHORT, buttonPoll());
+  TEST_ASSERT_FALSE(buttonBusy());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_short_press);
+  RUN_TEST(test_bouncing_press_is_one_short_press);
+  RUN_TEST(test_long_press_is_reported_while_held);
+  RUN_TEST(test_bouncing_double_press);
+  RUN_TEST(test_presses_outside_the_double_window_are_two_short_presses);
+  RUN_TEST(test_release_inside_the_debounce_window_is_caught_up);
+  RUN_TEST(test_gestures_survive_a_slow_loop);
+  RUN_TEST(test_busy_until_the_gesture_completes);
+  return UNITY_END();
+}
@@ -0,0 +1,176 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include "credstore.h"
+
+static UidKey uid(const char* text) {
+  UidKey key = {};
+  parseUidKey(text, &key);
+  return key;
+}
+
+static const char* nameOf(const char* text) {
+  static char name[CSV_MAX_LINE];
+  const Credential* cred = findCredential(uid(text));
+  if (cred == nullptr || !credentialName(*cred, name))
+    return "(none)";
+  return name;
+}
+
+void setUp() {
+  hostSerialQuiet(true);
+  LittleFS.hostWrite("/uids.txt", "AA:BB:CC:01,Alice,A\n"
+                                  "AA:BB:CC:02, Bob ,u\n"
+                                  "AA:BB:CC:03,Alice,U\n"
+                                  "not a uid,Mallory,U\n"
+                                  "04:3A:7F:92:11:22:33,Carol,U\n");
+}
+
+void tearDown() {
+  LittleFS.hostFormat();
+  hostSerialQuiet(false);
+}
+
+void test_names_are_stored_once_each() {
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_EQUAL_UINT32(4, credentialCount());
+  TEST_ASSERT_EQUAL_STRING("Alice\nBob\nCarol\n", LittleFS.hostRead("/names.txt").c_str());
+
+  TEST_ASSERT_EQUAL_STRING("Alice", nameOf("AA:BB:CC:01"));
+  TEST_ASSERT_EQUAL_STRING("Bob", nameOf("AA:BB:CC:02"));
+  TEST_ASSERT_EQUAL_STRING("Alice", nameOf("AA:BB:CC:03"));
+  TEST_ASSERT_EQUAL_STRING("Carol", nameOf("04:3A:7F:92:11:22:33"));
+  TEST_ASSERT_EQUAL_STRING("(none)", nameOf("AA:BB:CC:04"));
+  TEST_ASSERT_EQUAL_CHAR('U', findCredential(uid("AA:BB:CC:02"))->role);
+}
+
+void test_boot_with_unchanged_files_writes_nothing() {
+  TEST_ASSERT_TRUE(loadCredentials());
+  uint32_t written = LittleFS.hostBytesWritten();
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_EQUAL_UINT32(written, LittleFS.hostBytesWritten());
+  TEST_ASSERT_EQUAL_STRING("Bob", nameOf("AA:BB:CC:02"));
+}
+
+void test_registration_keeps_the_table_in_step() {
+  TEST_ASSERT_TRUE(loadCredentials());
+  char name[] = " Dave ";
+  char role[] = "u";
+  TEST_ASSERT_TRUE(registerUID("aa:bb:cc:05", name, role));
+  char again[] = "Bob";
+  char role2[] = "U";
+  TEST_ASSERT_TRUE(registerUID("AA:BB:CC:06", again, role2));
+  TEST_ASSERT_EQUAL_STRING("Alice\nBob\nCarol\nDave\n", LittleFS.hostRead("/names.txt").c_str());
+  TEST_ASSERT_EQUAL_STRING("Dave", nameOf("AA:BB:CC:05"));
+  TEST_ASSERT_EQUAL_STRING("Bob", nameOf("AA:BB:CC:06"));
+
+  // what registration wrote is what a boot would have built
+  uint32_t written = LittleFS.hostBytesWritten();
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_EQUAL_UINT32(written, LittleFS.hostBytesWritten());
+  TEST_ASSERT_EQUAL_STRING("Dave", nameOf("AA:BB:CC:05"));
+}
+
+// only the one-letter role "A" is admin; "Auditor" used to be, by its first letter
+void test_roles_are_one_letter() {
+  LittleFS.hostWrite("/uids.txt", "AA:BB:CC:01,Alice,A\n"
+                                  "AA:BB:CC:02,Bob,a\n"
+                                  "AA:BB:CC:03,Carol,Auditor\n"
+                                  "AA:BB:CC:04,Dave,ADMIN-temp\n"
+                                  "AA:BB:CC:05,Erin,\n");
+  hostClearSerialOutput();
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_EQUAL_UINT32(5, credentialCount());
+  TEST_ASSERT_EQUAL_CHAR('A', findCredential(uid("AA:BB:CC:01"))->role);
+  TEST_ASSERT_EQUAL_CHAR('A', findCredential(uid("AA:BB:CC:02"))->role);
+  TEST_ASSERT_EQUAL_CHAR('?', findCredential(uid("AA:BB:CC:03"))->role);
+  TEST_ASSERT_EQUAL_CHAR('?', findCredential(uid("AA:BB:CC:04"))->role);
+  TEST_ASSERT_EQUAL_CHAR('?', findCredential(uid("AA:BB:CC:05"))->role);
+  const std::string& log = hostSerialOutput();
+  TEST_ASSERT_TRUE(log.find("Role \"Auditor\" of AA:BB:CC:03 is not one letter") !=
+                   std::string::npos);
+  TEST_ASSERT_TRUE(log.find("Role \"ADMIN-temp\" of AA:BB:CC:04") != std::string::npos);
+
+  // registration refuses them, and writes nothing
+  uint32_t written = LittleFS.hostBytesWritten();
+  for (const char* text : {"Auditor", "ADMIN-temp", "", "1"}) {
+    char name[] = "Frank";
+    char role[16];
+    strcpy(role, text);
+    TEST_ASSERT_FALSE_MESSAGE(registerUID("AA:BB:CC:06", name, role), text);
+  }
+  TEST_ASSERT_EQUAL_UINT32(written, LittleFS.hostBytesWritten());
+  TEST_ASSERT_NULL(findCredential(uid("AA:BB:CC:06")));
+
+  char name[] = "Frank";
+  char role[] = " c ";
+  TEST_ASSERT_TRUE(registerUID("AA:BB:CC:06", name, role));
+  TEST_ASSERT_EQUAL_CHAR('C', findCredential(uid("AA:BB:CC:06"))->role);
+}
+
+void test_edited_uid_file_rebuilds_the_table() {
+  TEST_ASSERT_TRUE(loadCredentials());
+  LittleFS.hostWrite("/uids.txt", "AA:BB:CC:02,Bob,U\n"
+                                  "AA:BB:CC:07,Erin,U\n");
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_EQUAL_STRING("Bob\nErin\n", LittleFS.hostRead("/names.txt").c_str());
+  TEST_ASSERT_EQUAL_STRING("Erin", nameOf("AA:BB:CC:07"));
+  TEST_ASSERT_EQUAL_STRING("(none)", nameOf("AA:BB:CC:01"));
+}
+
+void test_damaged_name_table_is_rebuilt() {
+  TEST_ASSERT_TRUE(loadCredentials());
+  LittleFS.hostWrite("/names.txt", "Alice\nBib\nCarol\n"); // same size, other bytes
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_EQUAL_STRING("Bob", nameOf("AA:BB:CC:02"));
+
+  LittleFS.remove("/names.txt");
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_EQUAL_STRING("Carol", nameOf("04:3A:7F:92:11:22:33"));
+}
+
+void test_no_uid_file_loads_an_empty_table() {
+  LittleFS.remove("/uids.txt");
+  LittleFS.hostWrite("/names.txt", "Stale\n");
+  TEST_ASSERT_TRUE(loadCredentials());
+  TEST_ASSERT_EQUAL_UINT32(0, credentialCount());
+  TEST_ASSERT_EQUAL_STRING("", LittleFS.hostRead("/names.txt").c_str());
+}
+
+// 20,000 cards sharing 5,000 names: the load stays linear in the file
+void test_large_list_loads() {
+  std::string uids;
+  char line[64];
+  for (uint32_t i = 0; i < 20000; i++) {
+    snprintf(line, sizeof(line), "%02X:%02X:%02X:%02X,Name %lu,U\n", (unsigned)(i >> 24),
+             (unsigned)(i >> 16 & 0xFF), (unsigned)(i >> 8 & 0xFF), (unsigned)(i & 0xFF),
+             (unsigned long)(i % 5000));
+    uids += line;
+  }
+  LittleFS.hostWrite("/uids.txt", uids);
+
+  uint32_t start = ESP.getCycleCount();
+  TEST_ASSERT_TRUE(loadCredentials());
+  uint32_t ms = (ESP.getCycleCount() - start) / 1000000;
+  snprintf(line, sizeof(line), "20,000 cards, 5,000 names loaded in %lu ms", (unsigned long)ms);
+  TEST_MESSAGE(line);
+
+  TEST_ASSERT_EQUAL_UINT32(20000, credentialCount());
+  TEST_ASSERT_EQUAL_STRING("Name 4999", nameOf("00:00:4E:1F")); // card 19999
+  TEST_ASSERT_EQUAL_STRING("Name 19", nameOf("00:00:13:9B"));   // card 5019
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_names_are_stored_once_each);
+  RUN_TEST(test_boot_with_unchanged_files_writes_nothing);
+  RUN_TEST(test_registration_keeps_the_table_in_step);
+  RUN_TEST(test_roles_are_one_letter);
+  RUN_TEST(test_edited_uid_file_rebuilds_the_table);
+  RUN_TEST(test_damaged_name_table_is_rebuilt);
+  RUN_TEST(test_no_uid_file_loads_an_empty_table);
+  RUN_TEST(test_large_list_loads);
+  return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include "csvreader.h"
+
+static File openText(const std::string& text) {
+  LittleFS.hostWrite("/test.csv", text);
+  return LittleFS.open("/test.csv", "r");
+}
+
+void setUp() {}
+
+void tearDown() {
+  LittleFS.hostFormat();
+}
+
+void test_fields_split_at_first_and_last_comma() {
+  File file = openText("AA:BB:CC:DD, Smith, Jane ,U\n"
+                       "AA:BB:CC:DE,Bob\n"
+                       "single\n");
+  CsvReader reader(file);
+
+  TEST_ASSERT_TRUE(reader.next());
+  TEST_ASSERT_EQUAL_UINT8(3, reader.fieldCount());
+  TEST_ASSERT_EQUAL_STRING("AA:BB:CC:DD", reader.field(0));
+  TEST_ASSERT_EQUAL_STRING("Smith, Jane", reader.field(1));
+  TEST_ASSERT_EQUAL_STRING("U", reader.field(2));
+
+  TEST_ASSERT_TRUE(reader.next());
+  TEST_ASSERT_EQUAL_UINT8(2, reader.fieldCount());
+  TEST_ASSERT_EQUAL_STRING("Bob", reader.field(1));
+  TEST_ASSERT_EQUAL_STRING("", reader.field(2));
+
+  TEST_ASSERT_TRUE(reader.next());
+  TEST_ASSERT_EQUAL_UINT8(1, reader.fieldCount());
+  TEST_ASSERT_EQUAL_STRING("single", reader.field(0));
+
+  TEST_ASSERT_FALSE(reader.next());
+  TEST_ASSERT_FALSE(reader.next());
+}
+
+void test_blank_lines_crlf_and_missing_last_newline() {
+  File file = openText("\n  \r\n a , b , c \r\n\n\t\nlast,line,X");
+  CsvReader reader(file);
+
+  TEST_ASSERT_TRUE(reader.next());
+  TEST_ASSERT_EQUAL_STRING("a", reader.field(0));
+  TEST_ASSERT_EQUAL_STRING("b", reader.field(1));
+  TEST_ASSERT_EQUAL_STRING("c", reader.field(2));
+
+  TEST_ASSERT_TRUE(reader.next());
+  TEST_ASSERT_EQUAL_STRING("X", reader.field(2));
+  TEST_ASSERT_FALSE(reader.next());
+  TEST_ASSERT_EQUAL_UINT32(file.size(), reader.bytesRead());
+}
+
+void test_overlong_lines_are_skipped_whole() {
+  std::string text = "a,b,c\n" + std::string(CSV_MAX_LINE * 3, 'x') + ",y,z\n" +
+                     std::string(CSV_MAX_LINE - 1, 'w') + "\n" // just fits
+                     + std::string(CSV_MAX_LINE, 'v') + "\n"  // one too many
+                     + "d,e,f\n";
+  File file = openText(text);
+  CsvReader reader(file);
+
+  TEST_ASSERT_TRUE(reader.next());
+  TEST_ASSERT_EQUAL_STRING("a", reader.field(0));
+  TEST_ASSERT_TRUE(reader.next());
+  TEST_ASSERT_EQUAL_UINT32(CSV_MAX_LINE - 1, strlen(reader.field(0)));
+  TEST_ASSERT_TRUE(reader.next());
+  TEST_ASSERT_EQUAL_STRING("d", reader.field(0));
+  TEST_ASSERT_FALSE(reader.next());
+  TEST_ASSERT_EQUAL_UINT32(2, reader.skippedLines());
+}
+
+// lines that straddle the refills of the chunk buffer, at every offset
+void test_lines_across_chunk_boundaries() {
+  for (size_t pad = 0; pad < CSV_CHUNK; pad++) {
+    std::string text = std::string(pad, ' ') + "\n";
+    for (int i = 0; i < 20; i++)
+      text += "04:3A:7F:" + std::to_string(10 + i) + ",Name " + std::to_string(i) + ",U\n";
+    File file = openText(text);
+    CsvReader reader(file);
+    for (int i = 0; i < 20; i++) {
+      TEST_ASSERT_TRUE(reader.next());
+      TEST_ASSERT_EQUAL_STRING(("Name " + std::to_string(i)).c_str(), reader.field(1));
+    }
+    TEST_ASSERT_FALSE(reader.next());
+  }
+}
+
+// the reader is meant to live on the stack: a whole file is parsed without one allocation
+void test_parsing_allocates_nothing_and_throughput() {
+  std::string text;
+  char line[64];
+  for (uint32_t i = 0; text.size() < 1024 * 1024; i++) {
+    snprintf(line, sizeof(line), "04:%02X:%02X:%02X,Employee number %lu,U\n",
+             (unsigned)(i >> 16 & 0xFF), (unsigned)(i >> 8 & 0xFF), (unsigned)(i & 0xFF),
+             (unsigned long)i);
+    text += line;
+  }
+  File file = openText(text);
+
+  uint32_t allocations = hostHeapAllocations();
+  uint32_t start = ESP.getCycleCount();
+  CsvReader reader(file);
+  uint32_t lines = 0;
+  while (reader.next())
+    lines += reader.fieldCount() == 3;
+  uint32_t ns = ESP.getCycleCount() - start;
+
+  TEST_ASSERT_EQUAL_UINT32(allocations, hostHeapAllocations());
+  TEST_ASSERT_EQUAL_UINT32(text.size(), reader.bytesRead());
+  TEST_ASSERT_GREATER_THAN_UINT32(25000, lines);
+
+  char message[80];
+  snprintf(message, sizeof(message), "%lu lines, %lu us per MB on the host", (unsigned long)lines,
+           (unsigned long)(ns / 1000 * (1024.0 * 1024) / text.size()));
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fields_split_at_first_and_last_comma);
+  RUN_TEST(test_blank_lines_crlf_and_missing_last_newline);
+  RUN_TEST(test_overlong_lines_are_skipped_whole);
+  RUN_TEST(test_lines_across_chunk_boundaries);
+  RUN_TEST(test_parsing_allocates_nothing_and_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+#include <unity.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "httpmetrics.h"
+
+static ESP8266WebServer server(80);
+static std::vector<std::string> lines;
+
+static void capture(const char* line, size_t length) {
+  std::string text(line, length);
+  for (size_t start = 0, end; start < text.size(); start = end + 1) {
+    end = text.find('\n', start);
+    lines.push_back(text.substr(start, end - start));
+  }
+}
+
+static std::vector<std::string> scrape() {
+  lines.clear();
+  writeMetrics(capture);
+  return lines;
+}
+
+// the family a sample line belongs to: its name, less a histogram's suffix
+static std::string family(const std::string& line) {
+  std::string name = line.substr(0, line.find_first_of("{ "));
+  for (const char* suffix : {"_bucket", "_sum", "_count"}) {
+    size_t at = name.size() - strlen(suffix);
+    if (name.size() > strlen(suffix) && name.compare(at, std::string::npos, suffix) == 0 &&
+        name.compare(0, at, "rfid_http_request_duration_ms") == 0)
+      return name.substr(0, at);
+  }
+  return name;
+}
+
+static bool served(const char* uri) {
+  if (!server.hostRequest(HTTP_GET, uri))
+    return false;
+  server.handleClient();
+  return server.hostResponse().code == 200;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_routes_are_metered() {
+  meteredOn(server, "/", HTTP_GET, []() { server.send(200, "text/plain", "home"); });
+  meteredOn(server, "/health", HTTP_GET, []() {
+    hostAdvanceMillis(3);
+    server.send(200, "text/plain", "ok");
+  });
+  meteredOn(server, "/idle", HTTP_GET, []() { server.send(200, "text/plain", ""); });
+  server.begin();
+
+  TEST_ASSERT_TRUE(served("/"));
+  TEST_ASSERT_TRUE(served("/health"));
+  TEST_ASSERT_TRUE(served("/health"));
+  hostAdvanceMillis(HEAP_SAMPLE_INTERVAL);
+  sampleHeap();
+}
+
+// strict parsers want each family as one group after its TYPE line, and each family once
+void test_every_family_is_one_contiguous_group() {
+  std::set<std::string> seen;
+  std::string current;
+  uint32_t samples = 0;
+  for (const std::string& line : scrape()) {
+    if (line.compare(0, 7, "# TYPE ") == 0) {
+      current = line.substr(7, line.find(' ', 7) - 7);
+      TEST_ASSERT_TRUE_MESSAGE(seen.insert(current).second, line.c_str());
+      continue;
+    }
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(current.c_str(), family(line).c_str(), line.c_str());
+    samples++;
+  }
+  TEST_ASSERT_EQUAL(11, seen.size());
+  TEST_ASSERT_GREATER_THAN(0, samples);
+}
+
+void test_samples_per_route() {
+  std::vector<std::string> out = scrape();
+  auto has = [&](const char* line) {
+    for (const std::string& text : out)
+      if (text == line)
+        return true;
+    return false;
+  };
+  TEST_ASSERT_TRUE(has("rfid_http_requests_total{route=\"/\",method=\"GET\"} 1"));
+  TEST_ASSERT_TRUE(has("rfid_http_requests_total{route=\"/health\",method=\"GET\"} 2"));
+  TEST_ASSERT_TRUE(has("rfid_http_requests_total{route=\"/idle\",method=\"GET\"} 0"));
+  TEST_ASSERT_TRUE(
+      has("rfid_http_request_duration_ms_bucket{route=\"/health\",method=\"GET\",le=\"2\"} 0"));
+  TEST_ASSERT_TRUE(
+      has("rfid_http_request_duration_ms_bucket{route=\"/health\",method=\"GET\",le=\"5\"} 2"));
+  TEST_ASSERT_TRUE(has("rfid_http_request_duration_ms_sum{route=\"/health\",method=\"GET\"} 6"));
+  TEST_ASSERT_TRUE(has("rfid_http_request_latency_p99_ms{route=\"/health\",method=\"GET\"} 5"));
+
+  // no quantiles or heap delta for a route that has not been asked for anything yet
+  for (const std::string& line : out) {
+    if (line.find("route=\"/idle\"") == std::string::npos)
+      continue;
+    TEST_ASSERT_TRUE_MESSAGE(line.find("_p50_") == std::string::npos &&
+                                 line.find("_p99_") == std::string::npos &&
+                                 line.find("heap_delta") == std::string::npos,
+                             line.c_str());
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_routes_are_metered);
+  RUN_TEST(test_every_family_is_one_contiguous_group);
+  RUN_TEST(test_samples_per_route);
+  return UNITY_END();
+}
@@ -0,0 +1,194 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "modefsm.h"
+
+// a table shaped like MODE_TABLE in main.cpp, whose actions record what ran
+const unsigned long TIMEOUT_MS = 60000;
+
+static unsigned long enteredAt = 0;
+static char actions[64];
+
+static void note(const char* action) {
+  strncat(actions, action, sizeof(actions) - strlen(actions) - 1);
+}
+
+static bool expired() {
+  return millis() - enteredAt >= TIMEOUT_MS;
+}
+
+static void enter() {
+  enteredAt = millis();
+  note("enter;");
+}
+
+static void leave() {
+  note("leave;");
+}
+
+static void expire() {
+  note("expire;");
+}
+
+static void authorize() {
+  enteredAt = millis();
+  note("authorize;");
+}
+
+static void reject() {
+  note("reject;");
+}
+
+static void extend() {
+  enteredAt = millis();
+  note("extend;");
+}
+
+const ModeTable TABLE = {
+    {{nullptr, enter, STATE_ADD_WAIT_ADMIN},
+     stay(STATE_DOOR_LOCK),
+     stay(STATE_DOOR_LOCK),
+     stay(STATE_DOOR_LOCK),
+     stay(STATE_DOOR_LOCK),
+     stay(STATE_DOOR_LOCK)},
+    {{nullptr, leave, STATE_DOOR_LOCK},
+     {nullptr, authorize, STATE_ADD_REGISTER},
+     {nullptr, reject, STATE_ADD_WAIT_ADMIN},
+     {nullptr, extend, STATE_ADD_WAIT_ADMIN},
+     {expired, expire, STATE_DOOR_LOCK},
+     stay(STATE_ADD_WAIT_ADMIN)},
+    {{nullptr, leave, STATE_DOOR_LOCK},
+     {nullptr, extend, STATE_ADD_REGISTER},
+     {nullptr, extend, STATE_ADD_REGISTER},
+     {nullptr, extend, STATE_ADD_REGISTER},
+     {expired, expire, STATE_DOOR_LOCK},
+     {nullptr, extend, STATE_ADD_REGISTER}},
+};
+
+struct Expected {
+  bool taken;
+  SystemState next;
+  const char* actions;
+};
+
+// every cell, with the timeout guard not yet satisfied
+const Expected EXPECTED[STATE_COUNT][EVENT_COUNT] = {
+    {{true, STATE_ADD_WAIT_ADMIN, "enter;"},
+     {false, STATE_DOOR_LOCK, ""},
+     {false, STATE_DOOR_LOCK, ""},
+     {false, STATE_DOOR_LOCK, ""},
+     {false, STATE_DOOR_LOCK, ""},
+     {false, STATE_DOOR_LOCK, ""}},
+    {{true, STATE_DOOR_LOCK, "leave;"},
+     {true, STATE_ADD_REGISTER, "authorize;"},
+     {true, STATE_ADD_WAIT_ADMIN, "reject;"},
+     {true, STATE_ADD_WAIT_ADMIN, "extend;"},
+     {false, STATE_ADD_WAIT_ADMIN, ""},
+     {false, STATE_ADD_WAIT_ADMIN, ""}},
+    {{true, STATE_DOOR_LOCK, "leave;"},
+     {true, STATE_ADD_REGISTER, "extend;"},
+     {true, STATE_ADD_REGISTER, "extend;"},
+     {true, STATE_ADD_REGISTER, "extend;"},
+     {false, STATE_ADD_REGISTER, ""},
+     {true, STATE_ADD_REGISTER, "extend;"}},
+};
+
+void setUp() {
+  actions[0] = '\0';
+  hostAdvanceMillis(1000);
+  enteredAt = millis();
+}
+
+void tearDown() {}
+
+void test_every_cell_of_the_table() {
+  char where[48];
+  for (uint8_t state = 0; state < STATE_COUNT; state++) {
+    for (uint8_t event = 0; event < EVENT_COUNT; event++) {
+      const Expected& expected = EXPECTED[state][event];
+      ModeMachine machine(TABLE, (SystemState)state);
+      actions[0] = '\0';
+      snprintf(where, sizeof(where), "state %u, event %u", state, event);
+
+      TEST_ASSERT_EQUAL_MESSAGE(expected.taken, machine.dispatch((ModeEvent)event), where);
+      TEST_ASSERT_EQUAL_MESSAGE(expected.next, machine.state(), where);
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(expected.actions, actions, where);
+    }
+  }
+}
+
+void test_timeout_on_the_fake_clock() {
+  for (SystemState state : {STATE_ADD_WAIT_ADMIN, STATE_ADD_REGISTER}) {
+    ModeMachine machine(TABLE, state);
+    enteredAt = millis();
+    hostAdvanceMillis(TIMEOUT_MS - 1);
+    TEST_ASSERT_FALSE(machine.dispatch(EVENT_TICK));
+    TEST_ASSERT_EQUAL(state, machine.state());
+
+    hostAdvanceMillis(1);
+    TEST_ASSERT_TRUE(machine.dispatch(EVENT_TICK));
+    TEST_ASSERT_EQUAL(STATE_DOOR_LOCK, machine.state());
+  }
+  TEST_ASSERT_EQUAL_STRING("expire;expire;", actions);
+}
+
+void test_activity_restarts_the_timeout() {
+  ModeMachine machine(TABLE, STATE_DOOR_LOCK);
+  TEST_ASSERT_TRUE(machine.dispatch(EVENT_BUTTON));
+  hostAdvanceMillis(TIMEOUT_MS - 10);
+  TEST_ASSERT_TRUE(machine.dispatch(EVENT_ADMIN_CARD));
+  hostAdvanceMillis(TIMEOUT_MS - 10);
+  TEST_ASSERT_TRUE(machine.dispatch(EVENT_HTTP_ACTIVITY));
+  hostAdvanceMillis(TIMEOUT_MS - 10);
+  TEST_ASSERT_FALSE(machine.dispatch(EVENT_TICK));
+  TEST_ASSERT_EQUAL(STATE_ADD_REGISTER, machine.state());
+
+  hostAdvanceMillis(10);
+  TEST_ASSERT_TRUE(machine.dispatch(EVENT_TICK));
+  TEST_ASSERT_EQUAL(STATE_DOOR_LOCK, machine.state());
+  TEST_ASSERT_EQUAL_STRING("enter;authorize;extend;expire;", actions);
+}
+
+void test_state_names() {
+  TEST_ASSERT_EQUAL_STRING("door lock", ModeMachine::stateName(STATE_DOOR_LOCK));
+  TEST_ASSERT_EQUAL_STRING("add mode, registering", ModeMachine::stateName(STATE_ADD_REGISTER));
+  TEST_ASSERT_EQUAL_STRING("?", ModeMachine::stateName(STATE_COUNT));
+}
+
+void test_dispatch_cost() {
+  const uint32_t calls = 1000000;
+  ModeMachine machine(TABLE, STATE_DOOR_LOCK);
+  volatile uint32_t sink = 0;
+
+  // the common case: a tick in door lock mode, ignored by the table
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < calls; i++)
+    sink += machine.dispatch(EVENT_TICK);
+  uint32_t ignoredNs = (ESP.getCycleCount() - start) / calls;
+
+  // a guarded cell whose guard refuses: the table lookup plus one call
+  ModeMachine adding(TABLE, STATE_ADD_WAIT_ADMIN);
+  enteredAt = millis();
+  start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < calls; i++)
+    sink += adding.dispatch(EVENT_TICK);
+  uint32_t guardedNs = (ESP.getCycleCount() - start) / calls;
+
+  char message[80];
+  snprintf(message, sizeof(message), "ignored event: %lu ns, refused guard: %lu ns",
+           (unsigned long)ignoredNs, (unsigned long)guardedNs);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(0, sink);
+  TEST_ASSERT_LESS_THAN_UINT32(100, ignoredNs);
+  TEST_ASSERT_LESS_THAN_UINT32(100, guardedNs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_cell_of_the_table);
+  RUN_TEST(test_timeout_on_the_fake_clock);
+  RUN_TEST(test_activity_restarts_the_timeout);
+  RUN_TEST(test_state_names);
+  RUN_TEST(test_dispatch_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,220 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "perfecthash.h"
+#include "schedule.h"
+
+struct Card {
+  UidKey uid;
+  char role;
+  uint32_t nameOffset;
+};
+
+static void put16(std::string& out, uint16_t value) {
+  out += (char)(value & 0xFF);
+  out += (char)(value >> 8);
+}
+
+static void put32(std::string& out, uint32_t value) {
+  put16(out, value & 0xFFFF);
+  put16(out, value >> 16);
+}
+
+// the same hash-and-displace build as tools/mkphf.py, 4 keys per bucket
+static bool build(const std::vector<Card>& cards, uint32_t seed, std::vector<uint16_t>& disps,
+                  std::vector<int32_t>& slots) {
+  uint32_t n = cards.size();
+  uint32_t bucketCount = std::max<uint32_t>(1, (n + 3) / 4);
+  std::vector<std::vector<uint32_t>> buckets(bucketCount);
+  for (uint32_t i = 0; i < n; i++)
+    buckets[uidKeyHash(cards[i].uid, seed) % bucketCount].push_back(i);
+
+  std::vector<uint32_t> order(bucketCount);
+  for (uint32_t b = 0; b < bucketCount; b++)
+    order[b] = b;
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  disps.assign(bucketCount, 0);
+  slots.assign(n, -1);
+  for (uint32_t bucket : order) {
+    const std::vector<uint32_t>& members = buckets[bucket];
+    if (members.empty())
+      continue;
+    bool placed = false;
+    for (uint32_t d = 0; d <= 0xFFFF && !placed; d++) {
+      std::vector<uint32_t> positions;
+      for (uint32_t i : members) {
+        uint32_t p = uidKeyHash(cards[i].uid, seed + d + 1) % n;
+        if (slots[p] != -1 || std::find(positions.begin(), positions.end(), p) != positions.end())
+          break;
+        positions.push_back(p);
+      }
+      if (positions.size() != members.size())
+        continue;
+      disps[bucket] = d;
+      for (size_t k = 0; k < members.size(); k++)
+        slots[positions[k]] = members[k];
+      placed = true;
+    }
+    if (!placed)
+      return false;
+  }
+  return true;
+}
+
+// writes /creds.phf; every card is named "Card <index>"
+static std::vector<Card> writeImage(uint32_t count, uint8_t uidLength) {
+  std::vector<Card> cards;
+  std::string names;
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t bytes[UID_MAX_BYTES] = {0x04, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i, 0x5A};
+    cards.push_back({makeUidKey(bytes, uidLength), i % 10 == 0 ? 'A' : 'U',
+                     (uint32_t)names.size()});
+    names += "Card " + std::to_string(i) + "\n";
+  }
+
+  std::vector<uint16_t> disps;
+  std::vector<int32_t> slots;
+  uint32_t seed = 0;
+  while (!build(cards, seed, disps, slots))
+    seed++;
+
+  std::string image = "PHF1";
+  put32(image, count);
+  put32(image, disps.size());
+  put32(image, seed);
+  put32(image, 20 + 2 * disps.size() + 16 * count);
+  for (uint16_t d : disps)
+    put16(image, d);
+  for (int32_t index : slots) {
+    uint8_t bytes[UID_MAX_BYTES] = {};
+    uidKeyBytes(cards[index].uid, bytes);
+    image.append((const char*)bytes, UID_MAX_BYTES);
+    image += (char)uidKeyLength(cards[index].uid);
+    image += cards[index].role;
+    put32(image, cards[index].nameOffset);
+  }
+  LittleFS.hostWrite("/creds.phf", image + names);
+  return cards;
+}
+
+void setUp() {
+  hostSerialQuiet(true);
+}
+
+void tearDown() {
+  LittleFS.hostFormat();
+  TEST_ASSERT_TRUE(loadPerfectHash()); // closes the image
+  hostSerialQuiet(false);
+}
+
+void test_no_image_is_not_an_error() {
+  TEST_ASSERT_TRUE(loadPerfectHash());
+  TEST_ASSERT_EQUAL_UINT32(0, perfectHashCount());
+  UidKey key = {};
+  parseUidKey("04:00:00:01", &key);
+  TEST_ASSERT_NULL(findInPerfectHash(key));
+}
+
+void test_every_card_is_found_and_others_are_not() {
+  for (uint8_t length : {4, 7, 10}) {
+    std::vector<Card> cards = writeImage(1000, length);
+    TEST_ASSERT_TRUE(loadPerfectHash());
+    TEST_ASSERT_EQUAL_UINT32(1000, perfectHashCount());
+    for (const Card& card : cards) {
+      const Credential* cred = findInPerfectHash(card.uid);
+      TEST_ASSERT_NOT_NULL(cred);
+      TEST_ASSERT_EQUAL_CHAR(card.role, cred->role);
+      TEST_ASSERT_EQUAL_UINT32(card.nameOffset, cred->nameOffset);
+      TEST_ASSERT_EQUAL_UINT8(CRED_FROM_IMAGE, cred->flags);
+    }
+    for (uint32_t i = 1000; i < 3000; i++) {
+      uint8_t bytes[UID_MAX_BYTES] = {0x04, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i,
+                                      0x5A};
+      TEST_ASSERT_NULL(findInPerfectHash(makeUidKey(bytes, length)));
+    }
+    UidKey shorter = cards[0].uid;
+    shorter.hi = (shorter.hi & ~(0xFFULL << 56)) | ((uint64_t)(length - 1) << 56);
+    TEST_ASSERT_NULL(findInPerfectHash(shorter));
+  }
+}
+
+void test_only_displacements_stay_in_ram() {
+  writeImage(10000, 4);
+  uint32_t before = hostHeapInUse();
+  TEST_ASSERT_TRUE(loadPerfectHash());
+  TEST_ASSERT_EQUAL_UINT32(2 * 2500, hostHeapInUse() - before); // 2 bytes per 4 cards
+
+  uint8_t bytes[4] = {0x04, 0x00, 0x12, 0x34};
+  uint32_t allocations = hostHeapAllocations();
+  TEST_ASSERT_NOT_NULL(findInPerfectHash(makeUidKey(bytes, 4)));
+  TEST_ASSERT_EQUAL_UINT32(allocations, hostHeapAllocations());
+}
+
+void test_own_schedule_flag_follows_the_schedule_file() {
+  std::vector<Card> cards = writeImage(50, 7);
+  char uidText[UID_TEXT_SIZE];
+  formatUidKey(cards[7].uid, uidText);
+  LittleFS.hostWrite("/schedules.txt", std::string(uidText) + ",MTWTF--,08:00-18:00\n");
+  TEST_ASSERT_TRUE(loadSchedules());
+  TEST_ASSERT_TRUE(loadPerfectHash());
+
+  TEST_ASSERT_EQUAL_UINT8(CRED_FROM_IMAGE | CRED_OWN_SCHEDULE,
+                          findInPerfectHash(cards[7].uid)->flags);
+  TEST_ASSERT_EQUAL_UINT8(CRED_FROM_IMAGE, findInPerfectHash(cards[8].uid)->flags);
+
+  LittleFS.remove("/schedules.txt");
+  TEST_ASSERT_TRUE(loadSchedules());
+  TEST_ASSERT_EQUAL_UINT8(CRED_FROM_IMAGE, findInPerfectHash(cards[7].uid)->flags);
+}
+
+void test_bad_images_are_ignored() {
+  writeImage(100, 4);
+  std::string image = LittleFS.hostRead("/creds.phf");
+
+  LittleFS.hostWrite("/creds.phf", "PHF2" + image.substr(4));
+  TEST_ASSERT_FALSE(loadPerfectHash());
+  TEST_ASSERT_EQUAL_UINT32(0, perfectHashCount());
+
+  LittleFS.hostWrite("/creds.phf", image.substr(0, 20 + 2 * 25 + 16 * 50));
+  TEST_ASSERT_FALSE(loadPerfectHash());
+  TEST_ASSERT_EQUAL_UINT32(0, perfectHashCount());
+
+  LittleFS.hostWrite("/creds.phf", image.substr(0, 12));
+  TEST_ASSERT_FALSE(loadPerfectHash());
+}
+
+// displacements larger than the biggest free block would fail to allocate, or leave
+// nothing for the portal
+void test_image_larger_than_free_heap_is_refused() {
+  uint32_t buckets = HOST_HEAP_SIZE; // 2 bytes each: twice the heap
+  std::string image = "PHF1";
+  put32(image, 1);
+  put32(image, buckets);
+  put32(image, 0);
+  put32(image, 20 + 2 * buckets + 16);
+  image.resize(20 + 2 * buckets + 16, '\0');
+  LittleFS.hostWrite("/creds.phf", image);
+
+  uint32_t before = hostHeapInUse();
+  TEST_ASSERT_FALSE(loadPerfectHash());
+  TEST_ASSERT_EQUAL_UINT32(0, perfectHashCount());
+  TEST_ASSERT_EQUAL_UINT32(before, hostHeapInUse());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_image_is_not_an_error);
+  RUN_TEST(test_every_card_is_found_and_others_are_not);
+  RUN_TEST(test_only_displacements_stay_in_ram);
+  RUN_TEST(test_own_schedule_flag_follows_the_schedule_file);
+  RUN_TEST(test_bad_images_are_ignored);
+  RUN_TEST(test_image_larger_than_free_heap_is_refused);
+  return UNITY_END();
+}
@@ -0,0 +1,168 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "pn532reader.h"
+
+static Pn532Reader reader(1, "Exit reader", D4);
+
+static UidKey key(const char* text) {
+  UidKey uid = {};
+  parseUidKey(text, &uid);
+  return uid;
+}
+
+// one poll, a follow-up's worth of time after the last; 0xFF if a card came back verified
+static uint8_t pollOnce(UidKey* keys) {
+  hostAdvanceMillis(reader.answerDueMs() != 0 ? reader.answerDueMs() : 1);
+  uint8_t verified = 0xFF;
+  uint8_t count = reader.poll(keys, MAX_CARDS_PER_SCAN, &verified);
+  if (verified != 0)
+    return 0xFF; // PN532 cards never count as verified
+  return count;
+}
+
+// the cards a list sent now reports: one poll starts it, the follow-up reads its answer
+static uint8_t scan(UidKey* keys) {
+  while (reader.answerDueMs() != 0)
+    pollOnce(keys); // the answer to a list sent before the field changed
+  pollOnce(keys); // sends the list
+  return pollOnce(keys);
+}
+
+void setUp() {
+  hostSerialQuiet(true);
+  hostPn532ClearField();
+  hostPn532Responding(true);
+  TEST_ASSERT_TRUE(reader.begin());
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  scan(keys); // the empty field resets what the last test left
+}
+
+void tearDown() {
+  hostSerialQuiet(false);
+}
+
+void test_missing_pn532_fails_begin() {
+  hostPn532Responding(false);
+  TEST_ASSERT_FALSE(reader.begin());
+}
+
+void test_card_is_released_after_every_read() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  hostPn532AddCard("04:3A:7F:92");
+  uint32_t releases = hostPn532Releases();
+  TEST_ASSERT_EQUAL_UINT8(1, scan(keys));
+  TEST_ASSERT_TRUE(keys[0] == key("04:3A:7F:92"));
+  TEST_ASSERT_EQUAL_UINT8(0, hostPn532Listed());
+  TEST_ASSERT_EQUAL_UINT32(releases + 1, hostPn532Releases());
+}
+
+void test_held_card_is_reported_once() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  hostPn532AddCard("04:3A:7F:92:11:22:33");
+  TEST_ASSERT_EQUAL_UINT8(1, scan(keys));
+  for (int i = 0; i < 50; i++)
+    TEST_ASSERT_EQUAL_UINT8(0, pollOnce(keys));
+  TEST_ASSERT_EQUAL_UINT8(0, hostPn532Listed());
+}
+
+void test_card_is_reported_again_after_an_empty_poll() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  hostPn532AddCard("04:3A:7F:92");
+  TEST_ASSERT_EQUAL_UINT8(1, scan(keys));
+  TEST_ASSERT_EQUAL_UINT8(0, scan(keys));
+
+  TEST_ASSERT_TRUE(hostPn532RemoveCard("04:3A:7F:92"));
+  TEST_ASSERT_EQUAL_UINT8(0, scan(keys));
+  hostPn532AddCard("04:3A:7F:92");
+  TEST_ASSERT_EQUAL_UINT8(1, scan(keys));
+  TEST_ASSERT_TRUE(keys[0] == key("04:3A:7F:92"));
+}
+
+void test_other_card_is_reported_without_an_empty_poll() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  hostPn532AddCard("04:3A:7F:92");
+  TEST_ASSERT_EQUAL_UINT8(1, scan(keys));
+  hostPn532ClearField();
+  hostPn532AddCard("5C:01:9E:20");
+  TEST_ASSERT_EQUAL_UINT8(1, scan(keys));
+  TEST_ASSERT_TRUE(keys[0] == key("5C:01:9E:20"));
+}
+
+// no poll waits for the field: one sends the list, a later one reads the answer
+void test_polls_never_wait_for_the_field() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint8_t verified;
+  uint64_t start = hostMicros();
+  TEST_ASSERT_EQUAL_UINT8(0, reader.poll(keys, MAX_CARDS_PER_SCAN, &verified));
+  TEST_ASSERT_EQUAL_UINT32(HOST_PN532_COMMAND_US, (uint32_t)(hostMicros() - start));
+  TEST_ASSERT_TRUE(reader.answerDueMs() != 0);
+
+  // asked again before the two activation attempts are over: a status byte, nothing more
+  hostAdvanceMicros(HOST_PN532_RETRY_US);
+  start = hostMicros();
+  TEST_ASSERT_EQUAL_UINT8(0, reader.poll(keys, MAX_CARDS_PER_SCAN, &verified));
+  TEST_ASSERT_LESS_THAN_UINT32(100, (uint32_t)(hostMicros() - start));
+  TEST_ASSERT_TRUE(reader.answerDueMs() != 0);
+
+  hostAdvanceMicros(HOST_PN532_RETRY_US);
+  TEST_ASSERT_EQUAL_UINT8(0, reader.poll(keys, MAX_CARDS_PER_SCAN, &verified));
+  TEST_ASSERT_EQUAL(0, reader.answerDueMs());
+}
+
+// on the idle cadence a card is reported one follow-up after the poll that lists it
+void test_follow_up_poll_keeps_the_idle_latency() {
+  const unsigned long maxMs = 250;
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint8_t verified;
+  reader.cadence.begin(20, 0, maxMs);
+  for (int i = 0; i < 40; i++) { // back off to the idle rate, as loop() would
+    hostAdvanceMillis(reader.cadence.untilDue());
+    uint8_t count = reader.poll(keys, MAX_CARDS_PER_SCAN, &verified);
+    reader.cadence.polled(count > 0, reader.answerDueMs());
+  }
+  TEST_ASSERT_EQUAL(maxMs, reader.cadence.interval());
+
+  hostPn532AddCard("04:3A:7F:92");
+  unsigned long placed = millis();
+  uint8_t count = 0;
+  while (count == 0 && millis() - placed < 3 * maxMs) {
+    hostAdvanceMillis(max(reader.cadence.untilDue(), 1UL));
+    count = reader.poll(keys, MAX_CARDS_PER_SCAN, &verified);
+    reader.cadence.polled(count > 0, reader.answerDueMs());
+  }
+  TEST_ASSERT_EQUAL_UINT8(1, count);
+  TEST_ASSERT_LESS_OR_EQUAL(maxMs + 20, millis() - placed); // plus up to two follow-ups
+}
+
+// a list that is never answered is given up on, and the health check notices
+void test_silent_pn532_fails_its_health_check() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  pollOnce(keys);
+  TEST_ASSERT_TRUE(reader.answerDueMs() != 0);
+  hostPn532Responding(false);
+  for (int i = 0; i < 10; i++)
+    pollOnce(keys);
+  TEST_ASSERT_EQUAL(0, reader.answerDueMs());
+
+  hostAdvanceMillis(HEALTH_BACKOFF_MAX);
+  reader.checkHealth();
+  TEST_ASSERT_FALSE(reader.isHealthy());
+  hostPn532Responding(true);
+  for (int i = 0; i < 3; i++)
+    reader.checkHealth();
+  TEST_ASSERT_TRUE(reader.isHealthy());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_missing_pn532_fails_begin);
+  RUN_TEST(test_card_is_released_after_every_read);
+  RUN_TEST(test_held_card_is_reported_once);
+  RUN_TEST(test_card_is_reported_again_after_an_empty_poll);
+  RUN_TEST(test_other_card_is_reported_without_an_empty_poll);
+  RUN_TEST(test_polls_never_wait_for_the_field);
+  RUN_TEST(test_follow_up_poll_keeps_the_idle_latency);
+  RUN_TEST(test_silent_pn532_fails_its_health_check);
+  return UNITY_END();
+}
@@ -0,0 +1,343 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "reader.h"
+
+const uint8_t SS_PIN = D8;
+const uint8_t RST_PIN = D3;
+
+const uint8_t TIGHT_SS_PIN = D4;
+
+static Mfrc522Reader reader(0, "Front reader", SS_PIN, RST_PIN, 100000);
+static HostMfrc522Chip& chip = hostMfrc522Chip(SS_PIN);
+// a second reader whose multi-card budget runs out after the first card
+static Mfrc522Reader tightReader(1, "Tight reader", TIGHT_SS_PIN, RST_PIN, 1000);
+static HostMfrc522Chip& tightChip = hostMfrc522Chip(TIGHT_SS_PIN);
+
+static UidKey key(const char* text) {
+  UidKey uid = {};
+  parseUidKey(text, &uid);
+  return uid;
+}
+
+static uint8_t pollOnce(UidKey* keys) {
+  uint8_t verified;
+  return reader.poll(keys, MAX_CARDS_PER_SCAN, &verified);
+}
+
+static bool contains(const UidKey* keys, uint8_t count, const char* uid) {
+  UidKey wanted = key(uid);
+  for (uint8_t i = 0; i < count; i++)
+    if (keys[i] == wanted)
+      return true;
+  return false;
+}
+
+static bool printed(const char* text) {
+  return hostSerialOutput().find(text) != std::string::npos;
+}
+
+// the average the reader itself reports for one line of its stats
+static uint32_t reportedAverageUs(const char* line) {
+  hostClearSerialOutput();
+  reader.printStats();
+  const std::string& out = hostSerialOutput();
+  size_t at = out.find(line);
+  if (at == std::string::npos)
+    return 0;
+  at = out.find("avg ", at);
+  return strtoul(out.c_str() + at + 4, nullptr, 10);
+}
+
+// the remaining steps of a re-init, one per loop() pass a millisecond apart, up to its verdict
+static void finishReinit() {
+  for (int pass = 0; pass < 500; pass++) {
+    if (printed("recovered") || printed("failed the SPI self-test at every clock"))
+      return;
+    hostAdvanceMillis(1);
+    reader.checkHealth();
+  }
+  TEST_FAIL_MESSAGE("the re-init never finished");
+}
+
+void setUp() {
+  hostSerialQuiet(true);
+  chip.clearField();
+  chip.responding = true;
+  tightChip.clearField();
+  chip.maxClock = 10000000UL;
+  MFRC522::hostSpiClock = MFRC522_SPICLOCK;
+  hostAdvanceMillis(1000);
+  TEST_ASSERT_TRUE(reader.begin());
+}
+
+void tearDown() {
+  hostSerialQuiet(false);
+}
+
+void test_fastest_clock_that_passes_the_self_test() {
+  TEST_ASSERT_TRUE(printed("Reader SPI clock: 10000000 Hz"));
+  TEST_ASSERT_FALSE(printed("passed the SPI self-test only"));
+
+  hostClearSerialOutput();
+  chip.maxClock = 5000000UL;
+  TEST_ASSERT_TRUE(reader.begin());
+  TEST_ASSERT_TRUE(printed("Reader SPI clock: 5000000 Hz"));
+  // the library was built for 8 MHz: select would run on a bus that failed at that clock
+  TEST_ASSERT_TRUE(printed("passed the SPI self-test only up to 5000000 Hz"));
+}
+
+void test_dead_chip_fails_begin() {
+  chip.responding = false;
+  TEST_ASSERT_FALSE(reader.begin());
+  chip.responding = true;
+  TEST_ASSERT_TRUE(reader.begin());
+}
+
+void test_empty_field_poll_is_short() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint64_t start = hostMicros();
+  TEST_ASSERT_EQUAL_UINT8(0, pollOnce(keys));
+  TEST_ASSERT_LESS_THAN_UINT32(1000, (uint32_t)(hostMicros() - start));
+}
+
+void test_cards_of_every_uid_length_are_read_once() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  for (const char* uid : {"04:3A:7F:92", "04:3A:7F:92:11:22:33", "01:02:03:04:05:06:07:08:09:0A"}) {
+    chip.clearField();
+    chip.addCard(hostCard(uid));
+    TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys));
+    TEST_ASSERT_TRUE(keys[0] == key(uid));
+    TEST_ASSERT_EQUAL_UINT8(0, pollOnce(keys)); // halted while it stays in the field
+  }
+}
+
+void test_card_presented_again_is_read_again() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  HostCard card = hostCard("04:3A:7F:92");
+  chip.addCard(card);
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys));
+  chip.removeCard(card.uid, card.length);
+  TEST_ASSERT_EQUAL_UINT8(0, pollOnce(keys));
+  chip.addCard(card);
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys));
+}
+
+const char* const WALLET[] = {"04:3A:7F:92", "04:3A:7F:92:11:22:33", "5C:01:9E:20",
+                              "01:02:03:04:05:06:07:08:09:0A", "04:3A:7F:92:11:22:34"};
+
+void test_every_card_in_the_field_is_read_in_one_poll() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  char message[64];
+  for (uint8_t cards = 1; cards <= MAX_CARDS_PER_SCAN; cards++) {
+    chip.clearField();
+    for (uint8_t i = 0; i < cards; i++)
+      chip.addCard(hostCard(WALLET[i]));
+
+    uint64_t start = hostMicros();
+    TEST_ASSERT_EQUAL_UINT8(cards, pollOnce(keys));
+    uint32_t us = hostMicros() - start;
+    for (uint8_t i = 0; i < cards; i++)
+      TEST_ASSERT_TRUE(contains(keys, cards, WALLET[i]));
+    TEST_ASSERT_EQUAL_UINT8(0, pollOnce(keys)); // all halted
+
+    snprintf(message, sizeof(message), "%u card(s) in the field: %lu us", cards,
+             (unsigned long)us);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_UINT32(100000, us);
+  }
+}
+
+void test_cards_differing_in_the_last_bit_are_told_apart() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  chip.addCard(hostCard("04:3A:7F:92:11:22:33"));
+  chip.addCard(hostCard("04:3A:7F:92:11:22:32"));
+  TEST_ASSERT_EQUAL_UINT8(2, pollOnce(keys));
+  TEST_ASSERT_TRUE(contains(keys, 2, "04:3A:7F:92:11:22:33"));
+  TEST_ASSERT_TRUE(contains(keys, 2, "04:3A:7F:92:11:22:32"));
+}
+
+void test_cards_beyond_one_scan_are_read_by_the_next_poll() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  for (const char* uid : WALLET)
+    chip.addCard(hostCard(uid));
+  TEST_ASSERT_EQUAL_UINT8(MAX_CARDS_PER_SCAN, pollOnce(keys));
+  UidKey first[MAX_CARDS_PER_SCAN];
+  memcpy(first, keys, sizeof(keys));
+
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys));
+  for (const UidKey& seen : first)
+    TEST_ASSERT_FALSE(keys[0] == seen);
+  TEST_ASSERT_EQUAL_UINT8(0, pollOnce(keys));
+}
+
+void test_multi_card_budget_bounds_one_poll() {
+  TEST_ASSERT_TRUE(tightReader.begin());
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint8_t verified;
+  for (uint8_t i = 0; i < MAX_CARDS_PER_SCAN; i++)
+    tightChip.addCard(hostCard(WALLET[i]));
+
+  uint8_t total = 0;
+  for (int polls = 0; polls < MAX_CARDS_PER_SCAN; polls++) {
+    uint8_t count = tightReader.poll(keys, MAX_CARDS_PER_SCAN, &verified);
+    TEST_ASSERT_EQUAL_UINT8(1, count); // the budget is spent by the first select
+    total += count;
+  }
+  TEST_ASSERT_EQUAL_UINT8(MAX_CARDS_PER_SCAN, total);
+  TEST_ASSERT_EQUAL_UINT8(0, tightReader.poll(keys, MAX_CARDS_PER_SCAN, &verified));
+}
+
+// light sleep stops millis(): the reader is told how long it slept
+void test_health_check_runs_on_wall_clock_time_across_sleep() {
+  reader.checkHealth(); // healthy, next check in HEALTH_CHECK_INTERVAL
+  hostAdvanceMillis(HEALTH_CHECK_INTERVAL);
+  reader.checkHealth();
+  TEST_ASSERT_TRUE(reader.isHealthy());
+
+  chip.brownOut();
+  reader.slept(HEALTH_CHECK_INTERVAL - 100); // asleep, millis() did not move
+  hostAdvanceMillis(99);
+  hostClearSerialOutput();
+  reader.checkHealth();
+  TEST_ASSERT_FALSE(printed("not responding"));
+
+  hostAdvanceMillis(1);
+  reader.checkHealth();
+  TEST_ASSERT_TRUE(printed("not responding, re-initializing"));
+  finishReinit();
+  TEST_ASSERT_TRUE(printed("Front reader recovered"));
+  TEST_ASSERT_TRUE(reader.isHealthy());
+}
+
+// a reader that stays dead is retried after 1 s, then twice as long each time up to a minute
+void test_dead_reader_retries_back_off_to_a_minute() {
+  hostAdvanceMillis(HEALTH_CHECK_INTERVAL);
+  reader.checkHealth(); // healthy, next check in HEALTH_CHECK_INTERVAL
+  chip.responding = false;
+  hostAdvanceMillis(HEALTH_CHECK_INTERVAL);
+  hostClearSerialOutput();
+  reader.checkHealth();
+  TEST_ASSERT_TRUE(printed("not responding, re-initializing"));
+  finishReinit();
+
+  unsigned long backoff = HEALTH_BACKOFF_MIN;
+  const unsigned long expected[] = {1000, 2000, 4000, 8000, 16000, 32000, 60000, 60000};
+  for (unsigned long wait : expected) {
+    TEST_ASSERT_EQUAL_UINT32(wait, backoff);
+    hostAdvanceMillis(wait - 1);
+    hostClearSerialOutput();
+    reader.checkHealth();
+    TEST_ASSERT_FALSE(printed("not responding"));
+
+    hostAdvanceMillis(1);
+    reader.checkHealth();
+    TEST_ASSERT_TRUE(printed("not responding, re-initializing"));
+    finishReinit();
+    TEST_ASSERT_FALSE(reader.isHealthy());
+    backoff = min(backoff * 2, HEALTH_BACKOFF_MAX);
+  }
+
+  // the chip kept its registers while it was not answering, so the probe passes again
+  chip.responding = true;
+  hostAdvanceMillis(HEALTH_BACKOFF_MAX);
+  reader.checkHealth();
+  TEST_ASSERT_TRUE(reader.isHealthy());
+}
+
+// a re-init is spread over loop() passes instead of stalling one for PCD_Init()'s 50 ms waits
+void test_reinit_never_holds_up_a_pass() {
+  chip.brownOut();
+  hostAdvanceMillis(HEALTH_BACKOFF_MAX);
+  uint32_t passes = 0;
+  uint32_t worstUs = 0;
+  do {
+    uint64_t start = hostMicros();
+    reader.checkHealth();
+    worstUs = max(worstUs, (uint32_t)(hostMicros() - start));
+    passes++;
+  } while (!reader.isHealthy() && passes < 20);
+  TEST_ASSERT_TRUE(reader.isHealthy());
+  TEST_ASSERT_GREATER_THAN_UINT32(2, passes);
+  TEST_ASSERT_LESS_THAN_UINT32(5000, worstUs);
+
+  hostClearSerialOutput();
+  reader.printHealth(Serial);
+  TEST_ASSERT_TRUE(printed("longest re-init step "));
+}
+
+void test_time_since_the_last_read_counts_sleep() {
+  reader.noteRead();
+  hostAdvanceMillis(2000);
+  reader.slept(5000);
+  hostClearSerialOutput();
+  reader.printHealth(Serial);
+  TEST_ASSERT_TRUE(printed("last card read 7 s ago"));
+}
+
+// select runs in the library, at its own clock: MFRC522_SPICLOCK on the device
+void test_select_timing_at_4_and_8_mhz() {
+  uint32_t averages[2][2];
+  const uint32_t clocks[2] = {4000000UL, 8000000UL};
+  const char* uids[2] = {"04:3A:7F:92", "04:3A:7F:92:11:22:33"};
+  const char* lines[2] = {"select 4-byte", "select 7/10-byte"};
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  reader.printStats(); // drop what earlier tests recorded
+
+  for (int c = 0; c < 2; c++) {
+    MFRC522::hostSpiClock = clocks[c];
+    for (int u = 0; u < 2; u++) {
+      HostCard card = hostCard(uids[u]);
+      for (int i = 0; i < 20; i++) {
+        chip.clearField();
+        chip.addCard(card);
+        TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys));
+      }
+      averages[c][u] = reportedAverageUs(lines[u]);
+    }
+  }
+
+  char message[96];
+  for (int u = 0; u < 2; u++) {
+    snprintf(message, sizeof(message), "%s: %lu us at 4 MHz, %lu us at 8 MHz (simulated bus)",
+             lines[u], (unsigned long)averages[0][u], (unsigned long)averages[1][u]);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, averages[1][u]);
+    TEST_ASSERT_LESS_THAN_UINT32(averages[0][u], averages[1][u]);
+  }
+  TEST_ASSERT_LESS_THAN_UINT32(averages[0][1], averages[0][0]); // one cascade level less
+}
+
+void test_library_clock_above_what_the_bus_passes_breaks_select() {
+  chip.maxClock = 5000000UL;
+  TEST_ASSERT_TRUE(reader.begin());
+  MFRC522::hostSpiClock = 8000000UL;
+  chip.addCard(hostCard("04:3A:7F:92"));
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  TEST_ASSERT_EQUAL_UINT8(0, pollOnce(keys)); // the REQA is answered, the select garbled
+
+  MFRC522::hostSpiClock = 4000000UL;
+  chip.clearField();
+  chip.addCard(hostCard("04:3A:7F:92"));
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fastest_clock_that_passes_the_self_test);
+  RUN_TEST(test_dead_chip_fails_begin);
+  RUN_TEST(test_empty_field_poll_is_short);
+  RUN_TEST(test_cards_of_every_uid_length_are_read_once);
+  RUN_TEST(test_card_presented_again_is_read_again);
+  RUN_TEST(test_every_card_in_the_field_is_read_in_one_poll);
+  RUN_TEST(test_cards_differing_in_the_last_bit_are_told_apart);
+  RUN_TEST(test_cards_beyond_one_scan_are_read_by_the_next_poll);
+  RUN_TEST(test_multi_card_budget_bounds_one_poll);
+  RUN_TEST(test_health_check_runs_on_wall_clock_time_across_sleep);
+  RUN_TEST(test_dead_reader_retries_back_off_to_a_minute);
+  RUN_TEST(test_reinit_never_holds_up_a_pass);
+  RUN_TEST(test_time_since_the_last_read_counts_sleep);
+  RUN_TEST(test_select_timing_at_4_and_8_mhz);
+  RUN_TEST(test_library_clock_above_what_the_bus_passes_breaks_select);
+  return UNITY_END();
+}
@@ -0,0 +1,197 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include <stdlib.h>
+
+// the nodemcuv2_bench firmware: the "replay" command and its hooks come from main.cpp
+#include "main.cpp"
+
+const char* const USER_UID = "AA:BB:CC:02";
+const unsigned long DAY_MS = 86400000UL;
+const unsigned long DAY_TAP_EVERY_MS = 20000; // longer than the unlock window
+const uint8_t BURST_TAPS = CARD_QUEUE_SIZE + 1; // one more than the card queue holds
+
+static std::string report;
+
+// the number after `"field":` in the object that follows `object`, -1 if there is none
+static long field(const char* object, const char* name) {
+  char key[40];
+  snprintf(key, sizeof(key), "\"%s\":", name);
+  size_t at = report.find(object);
+  if (at == std::string::npos)
+    return -1;
+  at = report.find(key, at);
+  if (at == std::string::npos)
+    return -1;
+  return strtol(report.c_str() + at + strlen(key), nullptr, 10);
+}
+
+// sends "replay" as from the serial monitor and keeps the JSON report
+static void replay() {
+  hostSerialQuiet(true);
+  hostClearSerialOutput();
+  hostClearPinEvents();
+  hostSerialInput("replay\n");
+  hostAdvanceMillis(10);
+  loop();
+  hostSerialQuiet(false);
+
+  // the document ends on the first line break println() wrote
+  const std::string& output = hostSerialOutput();
+  size_t start = output.find("{\"");
+  size_t end = output.find("}\r\n", start);
+  TEST_ASSERT_TRUE(start != std::string::npos);
+  TEST_ASSERT_TRUE(end != std::string::npos);
+  report = output.substr(start, end + 3 - start);
+  printf("%s", report.c_str());
+}
+
+// the door, the radio and the relock timer were never touched
+static void assertLockUntouched() {
+  for (const HostPinEvent& event : hostPinEvents())
+    TEST_ASSERT_FALSE_MESSAGE(event.pin == LOCK_PIN, "lock pin written during the replay");
+  TEST_ASSERT_FALSE(hostTimer0Armed());
+  TEST_ASSERT_FALSE(WiFi.hostSoftApUp());
+  TEST_ASSERT_EQUAL_UINT32(0, relockCount);
+  TEST_ASSERT_FALSE(isUnlocked);
+  TEST_ASSERT_EQUAL(STATE_DOOR_LOCK, mode.state());
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_boot() {
+  hostSerialQuiet(true);
+  LittleFS.hostWrite("/uids.txt", "AA:BB:CC:01,Admin,A\n"
+                                  "AA:BB:CC:02,Alice,U\n");
+  hostMfrc522Chip(SS_PIN); // an empty field at the entry reader
+  hostTracePin(SS_PIN, false);
+  setup();
+  hostSerialQuiet(false);
+  TEST_ASSERT_EQUAL_UINT32(2, credentialCount());
+}
+
+void test_without_a_trace_nothing_runs() {
+  LittleFS.remove("/trace.csv");
+  replay();
+  TEST_ASSERT_EQUAL_STRING("{\"error\":\"no /trace.csv\"}\r\n", report.c_str());
+}
+
+// one of each event, with the add mode timeout and the auto-lock on the trace clock
+void test_every_event_on_the_trace_clock() {
+  LittleFS.hostWrite("/trace.csv", "# front door, recorded 2026-01-05\n"
+                                   "1000,tap,AA:BB:CC:02\n"
+                                   "10000,tap,11:22:33:44\n"
+                                   "20000,button,short\n"
+                                   "21000,tap,AA:BB:CC:01\n"
+                                   "22000,register,55:66:77:88\n"
+                                   "23000,register,AA:BB:CC:02\n"
+                                   "400000,register,99:99:99:99\n"
+                                   "401000,tap,55:66:77:88\n"
+                                   "500000,tap,AA:BB:CC:02\n"
+                                   "500000,tap,AA:BB:CC:02\n"
+                                   "500000,tap,AA:BB:CC:02\n");
+  replay();
+  assertLockUntouched();
+
+  TEST_ASSERT_EQUAL(12, field("{", "lines"));
+  TEST_ASSERT_EQUAL(1, field("{", "ignored"));
+  TEST_ASSERT_EQUAL(7, field("\"taps\"", "total"));
+  TEST_ASSERT_EQUAL(4, field("\"taps\"", "granted"));
+  TEST_ASSERT_EQUAL(1, field("\"taps\"", "denied"));
+  TEST_ASSERT_EQUAL(1, field("\"taps\"", "mode_events"));
+  TEST_ASSERT_EQUAL(1, field("\"taps\"", "missed")); // the burst overflowed the card queue
+  TEST_ASSERT_EQUAL(1, field("\"registrations\"", "ok"));
+  TEST_ASSERT_EQUAL(1, field("\"registrations\"", "duplicate"));
+  TEST_ASSERT_EQUAL(1, field("\"registrations\"", "missed")); // after the timeout
+
+  // the second card of the burst restarted the window one pass later
+  TEST_ASSERT_EQUAL(3, field("\"unlocks\"", "count"));
+  TEST_ASSERT_EQUAL(UNLOCK_DURATION, field("\"unlocks\"", "min_ms"));
+  TEST_ASSERT_EQUAL(UNLOCK_DURATION + REPLAY_TICK_MS, field("\"unlocks\"", "max_ms"));
+
+  // the registration restarted the timeout, the duplicate after it did not
+  TEST_ASSERT_EQUAL(1, field("\"add_mode\"", "entered"));
+  TEST_ASSERT_EQUAL(1, field("\"add_mode\"", "expired"));
+  TEST_ASSERT_EQUAL(ADD_MODE_TIMEOUT, field("\"add_mode\"", "idle_before_expiry_min_ms"));
+  TEST_ASSERT_EQUAL(ADD_MODE_TIMEOUT, field("\"add_mode\"", "idle_before_expiry_max_ms"));
+  TEST_ASSERT_EQUAL(3, field("\"transitions\"", "count"));
+  TEST_ASSERT_TRUE(report.find("{\"at_ms\":20000,\"from\":\"door lock\"") != std::string::npos);
+  TEST_ASSERT_TRUE(report.find("{\"at_ms\":21000,") != std::string::npos);
+  TEST_ASSERT_TRUE(report.find("{\"at_ms\":322000,") != std::string::npos);
+
+  // cards are decided in the pass they arrive in, the one queued behind another a pass later
+  TEST_ASSERT_GREATER_OR_EQUAL(REPLAY_TICK_MS * 1000, field("\"decision_latency_us\"", "max"));
+  TEST_ASSERT_LESS_THAN(2 * REPLAY_TICK_MS * 1000, field("\"decision_latency_us\"", "max"));
+
+  // the registration stayed in RAM and is gone again
+  UidKey registered;
+  parseUidKey("55:66:77:88", &registered);
+  TEST_ASSERT_NULL(findCredential(registered));
+  TEST_ASSERT_EQUAL_UINT32(2, credentialCount());
+}
+
+// a day of a user every 20 s, with a burst an hour, replays in seconds
+void test_a_day_of_bursty_traffic() {
+  std::string trace;
+  char line[48];
+  uint32_t taps = 0;
+  for (unsigned long at = DAY_TAP_EVERY_MS; at < DAY_MS; at += DAY_TAP_EVERY_MS) {
+    bool burst = at % 3600000UL == 0;
+    for (uint8_t i = 0; i < (burst ? BURST_TAPS : 1); i++) {
+      snprintf(line, sizeof(line), "%lu,tap,%s\n", at, USER_UID);
+      trace += line;
+      taps++;
+    }
+  }
+  LittleFS.hostWrite("/trace.csv", trace);
+  replay();
+  assertLockUntouched();
+
+  uint32_t bursts = DAY_MS / 3600000UL - 1;
+  TEST_ASSERT_EQUAL(taps, field("\"taps\"", "total"));
+  TEST_ASSERT_EQUAL(bursts * (BURST_TAPS - CARD_QUEUE_SIZE), field("\"taps\"", "missed"));
+  TEST_ASSERT_EQUAL(taps - bursts * (BURST_TAPS - CARD_QUEUE_SIZE), field("\"taps\"", "granted"));
+  TEST_ASSERT_EQUAL(0, field("\"taps\"", "denied"));
+  TEST_ASSERT_EQUAL(DAY_MS / DAY_TAP_EVERY_MS - 1, field("\"unlocks\"", "count"));
+  TEST_ASSERT_EQUAL(UNLOCK_DURATION, field("\"unlocks\"", "min_ms"));
+  TEST_ASSERT_EQUAL(UNLOCK_DURATION + REPLAY_TICK_MS, field("\"unlocks\"", "max_ms"));
+  TEST_ASSERT_EQUAL(0, field("\"transitions\"", "count"));
+}
+
+// the replay handed the door, the relock timer and the portal back
+void test_the_lock_drives_its_outputs_again() {
+  hostSerialQuiet(true);
+  hostClearPinEvents();
+  actuatorQueue.push({ACTUATOR_UNLOCK, (uint32_t)micros()});
+  actuatorStage();
+  TEST_ASSERT_TRUE(isUnlocked);
+  TEST_ASSERT_TRUE(hostTimer0Armed());
+  bool lockPinWritten = false;
+  for (const HostPinEvent& event : hostPinEvents())
+    lockPinWritten |= event.pin == LOCK_PIN;
+  TEST_ASSERT_TRUE(lockPinWritten);
+
+  actuatorQueue.push({ACTUATOR_LOCK, (uint32_t)micros()});
+  actuatorStage();
+  TEST_ASSERT_FALSE(isUnlocked);
+  TEST_ASSERT_FALSE(hostTimer0Armed());
+
+  startWebServer();
+  TEST_ASSERT_TRUE(WiFi.hostSoftApUp());
+  stopWebServer();
+  TEST_ASSERT_FALSE(WiFi.hostSoftApUp());
+  hostSerialQuiet(false);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_boot);
+  RUN_TEST(test_without_a_trace_nothing_runs);
+  RUN_TEST(test_every_event_on_the_trace_clock);
+  RUN_TEST(test_a_day_of_bursty_traffic);
+  RUN_TEST(test_the_lock_drives_its_outputs_again);
+  return UNITY_END();
+}
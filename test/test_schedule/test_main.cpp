@@ -0,0 +1,166 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include "schedule.h"
+#include "timekeeper.h"
+
+const uint32_t MONDAY = 1704067200UL; // 2024-01-01 00:00, a Monday
+const uint32_t MINUTE = 60;
+const uint32_t HOUR = 60 * MINUTE;
+const uint32_t DAY = 24 * HOUR;
+
+static UidKey uid(const char* text) {
+  UidKey key = {};
+  parseUidKey(text, &key);
+  return key;
+}
+
+static Credential credential(char role, uint8_t flags = 0) {
+  Credential cred = {};
+  cred.role = role;
+  cred.flags = flags;
+  return cred;
+}
+
+static void loadRules(const char* rules) {
+  LittleFS.hostWrite("/schedules.txt", rules);
+  TEST_ASSERT_TRUE(loadSchedules());
+}
+
+// sets the wall clock, then asks about a card with no schedule of its own
+static bool roleAllowedAt(char role, uint32_t localEpoch) {
+  setClock(localEpoch);
+  return scheduleAllows(uid("01:02:03:04"), credential(role));
+}
+
+void setUp() {
+  hostSerialQuiet(true);
+}
+
+void tearDown() {
+  LittleFS.hostFormat();
+  hostSerialQuiet(false);
+}
+
+// must run first: the clock cannot be unset again
+void test_unset_clock_denies_scheduled_cards() {
+  loadRules("U,MTWTF--,08:00-18:00\n");
+  TEST_ASSERT_FALSE(clockIsSet());
+  TEST_ASSERT_FALSE(scheduleAllows(uid("01:02:03:04"), credential('U')));
+  TEST_ASSERT_TRUE(scheduleAllows(uid("01:02:03:04"), credential('A'))); // no schedule
+}
+
+void test_weekday_window() {
+  loadRules("U,MTWTF--,08:00-18:00\n");
+  TEST_ASSERT_FALSE(roleAllowedAt('U', MONDAY + 8 * HOUR - 1));
+  TEST_ASSERT_TRUE(roleAllowedAt('U', MONDAY + 8 * HOUR));
+  TEST_ASSERT_TRUE(roleAllowedAt('U', MONDAY + 18 * HOUR - 1));
+  TEST_ASSERT_FALSE(roleAllowedAt('U', MONDAY + 18 * HOUR));
+  TEST_ASSERT_TRUE(roleAllowedAt('U', MONDAY + 4 * DAY + 12 * HOUR));  // Friday
+  TEST_ASSERT_FALSE(roleAllowedAt('U', MONDAY + 5 * DAY + 12 * HOUR)); // Saturday
+  TEST_ASSERT_TRUE(roleAllowedAt('A', MONDAY + 5 * DAY + 12 * HOUR));
+}
+
+void test_window_past_midnight_runs_into_next_day() {
+  loadRules("N,-----SS,22:00-06:00\n");
+  TEST_ASSERT_FALSE(roleAllowedAt('N', MONDAY + 5 * DAY + 22 * HOUR - 1));
+  TEST_ASSERT_TRUE(roleAllowedAt('N', MONDAY + 5 * DAY + 22 * HOUR));
+  TEST_ASSERT_TRUE(roleAllowedAt('N', MONDAY + 6 * DAY + 3 * HOUR)); // Saturday's night
+  TEST_ASSERT_TRUE(roleAllowedAt('N', MONDAY + 7 * DAY + 6 * HOUR - 1)); // Sunday's night
+  TEST_ASSERT_FALSE(roleAllowedAt('N', MONDAY + 7 * DAY + 6 * HOUR));
+  TEST_ASSERT_FALSE(roleAllowedAt('N', MONDAY + 4 * DAY + 23 * HOUR)); // Friday
+  TEST_ASSERT_FALSE(roleAllowedAt('N', MONDAY + 5 * DAY + 3 * HOUR));  // Friday's night
+}
+
+void test_times_off_the_quarter_hour_round_into_the_window() {
+  loadRules("U,MTWTF--,08:10-17:50\n");
+  TEST_ASSERT_FALSE(roleAllowedAt('U', MONDAY + 8 * HOUR + 10 * MINUTE));
+  TEST_ASSERT_TRUE(roleAllowedAt('U', MONDAY + 8 * HOUR + 15 * MINUTE));
+  TEST_ASSERT_TRUE(roleAllowedAt('U', MONDAY + 17 * HOUR + 45 * MINUTE - 1));
+  TEST_ASSERT_FALSE(roleAllowedAt('U', MONDAY + 17 * HOUR + 45 * MINUTE));
+}
+
+void test_window_inside_one_slot_allows_nothing() {
+  loadRules("U,MTWTFSS,08:05-08:10\n");
+  for (uint32_t t = MONDAY; t < MONDAY + 7 * DAY; t += 5 * MINUTE)
+    TEST_ASSERT_FALSE(roleAllowedAt('U', t));
+}
+
+void test_card_schedule_replaces_role_schedule() {
+  loadRules("U,MTWTF--,08:00-18:00\n"
+            "04:3A:7F:92,-----SS,10:00-12:00\n");
+  UidKey card = uid("04:3A:7F:92");
+  TEST_ASSERT_TRUE(hasUserSchedule(card));
+  TEST_ASSERT_FALSE(hasUserSchedule(uid("04:3A:7F:93")));
+
+  setClock(MONDAY + 9 * HOUR);
+  TEST_ASSERT_FALSE(scheduleAllows(card, credential('U', CRED_OWN_SCHEDULE)));
+  TEST_ASSERT_TRUE(scheduleAllows(uid("04:3A:7F:93"), credential('U')));
+  setClock(MONDAY + 5 * DAY + 11 * HOUR);
+  TEST_ASSERT_TRUE(scheduleAllows(card, credential('U', CRED_OWN_SCHEDULE)));
+  TEST_ASSERT_FALSE(scheduleAllows(uid("04:3A:7F:93"), credential('U')));
+}
+
+void test_bad_lines_are_ignored() {
+  loadRules("# comment\n"
+            "U,MTWTF,08:00-18:00\n"
+            "U,MTWTF--,25:00-26:00\n"
+            "U,MTWTF--,08:00\n"
+            "ZZ:ZZ,MTWTF--,08:00-18:00\n");
+  TEST_ASSERT_TRUE(roleAllowedAt('U', MONDAY + 5 * DAY + 3 * HOUR));
+}
+
+void test_slot_of_local_time() {
+  TEST_ASSERT_EQUAL_UINT16(0, scheduleSlotAt(MONDAY));
+  TEST_ASSERT_EQUAL_UINT16(SCHEDULE_SLOTS_PER_DAY + 4, scheduleSlotAt(MONDAY + DAY + HOUR));
+  TEST_ASSERT_EQUAL_UINT16(SCHEDULE_SLOTS - 1, scheduleSlotAt(MONDAY + 7 * DAY - 1));
+  TEST_ASSERT_EQUAL_UINT16(0, scheduleSlotAt(MONDAY + 7 * DAY));
+}
+
+void test_clock_follows_the_fake_millis() {
+  loadRules("U,MTWTF--,08:00-18:00\n");
+  setClock(MONDAY + 18 * HOUR - 2 * MINUTE);
+  TEST_ASSERT_TRUE(scheduleAllows(uid("01:02:03:04"), credential('U')));
+
+  hostAdvanceMillis(60 * 1000UL);
+  clockSlept(60 * 1000UL); // a light sleep: millis() stood still, the wall clock did not
+  TEST_ASSERT_EQUAL_UINT32(MONDAY + 18 * HOUR, clockNow());
+  TEST_ASSERT_FALSE(scheduleAllows(uid("01:02:03:04"), credential('U')));
+}
+
+void test_decision_cost() {
+  loadRules("U,MTWTF--,08:00-18:00\n"
+            "04:3A:7F:92,-----SS,10:00-12:00\n");
+  setClock(MONDAY + 9 * HOUR);
+  UidKey card = uid("04:3A:7F:92");
+  Credential cred = credential('U', CRED_OWN_SCHEDULE);
+
+  const uint32_t calls = 100000;
+  uint32_t allowed = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < calls; i++)
+    allowed += scheduleAllows(card, cred);
+  uint32_t meanNs = (ESP.getCycleCount() - start) / calls;
+
+  char message[64];
+  snprintf(message, sizeof(message), "scheduleAllows(): %lu ns per call", (unsigned long)meanNs);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(0, allowed);
+  TEST_ASSERT_LESS_THAN_UINT32(1000, meanNs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_unset_clock_denies_scheduled_cards);
+  RUN_TEST(test_weekday_window);
+  RUN_TEST(test_window_past_midnight_runs_into_next_day);
+  RUN_TEST(test_times_off_the_quarter_hour_round_into_the_window);
+  RUN_TEST(test_window_inside_one_slot_allows_nothing);
+  RUN_TEST(test_card_schedule_replaces_role_schedule);
+  RUN_TEST(test_bad_lines_are_ignored);
+  RUN_TEST(test_slot_of_local_time);
+  RUN_TEST(test_clock_follows_the_fake_millis);
+  RUN_TEST(test_decision_cost);
+  return UNITY_END();
+}
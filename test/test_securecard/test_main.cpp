@@ -0,0 +1,194 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include "reader.h"
+#include "securecard.h"
+
+const uint8_t SS_PIN = D8;
+const uint8_t RST_PIN = D3;
+const uint8_t SECTOR = 2;
+const uint8_t SITE_KEY[6] = {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5};
+
+static Mfrc522Reader reader(0, "Front reader", SS_PIN, RST_PIN, 100000);
+static HostMfrc522Chip& chip = hostMfrc522Chip(SS_PIN);
+
+static UidKey key(const char* text) {
+  UidKey uid = {};
+  parseUidKey(text, &uid);
+  return uid;
+}
+
+// a card issued for this site: key A of the credential sector set to the site key
+static HostCard siteCard(const char* uid) {
+  HostCard card = hostCard(uid);
+  memcpy(card.keyA[SECTOR], SITE_KEY, sizeof(SITE_KEY));
+  return card;
+}
+
+static HostCard provisionedCard(const char* uid) {
+  HostCard card = siteCard(uid);
+  secureCredentialBlock(key(uid), card.blocks[SECTOR * 4]);
+  return card;
+}
+
+static uint8_t pollOnce(UidKey* keys, uint8_t* verified) {
+  return reader.poll(keys, MAX_CARDS_PER_SCAN, verified);
+}
+
+// the average of one line of the reader's stats, 0 if it printed none
+static uint32_t average(const std::string& stats, const char* line) {
+  size_t at = stats.find(line);
+  if (at == std::string::npos)
+    return 0;
+  return strtoul(stats.c_str() + stats.find("avg ", at) + 4, nullptr, 10);
+}
+
+void setUp() {
+  hostSerialQuiet(true);
+  LittleFS.hostWrite("/secure.txt", "sector,2\n"
+                                    "key,A0A1A2A3A4A5\n"
+                                    "secret,00112233445566778899AABBCCDDEEFF\n"
+                                    "budget,50\n");
+  TEST_ASSERT_TRUE(loadSecureConfig());
+  chip.clearField();
+  TEST_ASSERT_TRUE(reader.begin());
+}
+
+void tearDown() {
+  LittleFS.hostFormat();
+  loadSecureConfig();
+  hostSerialQuiet(false);
+}
+
+void test_config_needs_key_and_secret() {
+  TEST_ASSERT_TRUE(secureCardsEnabled());
+  TEST_ASSERT_EQUAL_UINT8(8, secureDataBlock());
+  TEST_ASSERT_EQUAL_UINT8(11, secureTrailerBlock());
+  TEST_ASSERT_EQUAL_UINT32(50000, secureBudgetUs());
+  TEST_ASSERT_EQUAL_MEMORY(SITE_KEY, secureSiteKey()->keyByte, 6);
+
+  LittleFS.hostWrite("/secure.txt", "sector,16\nkey,A0A1A2A3A4A5\n");
+  TEST_ASSERT_FALSE(loadSecureConfig());
+  TEST_ASSERT_FALSE(secureCardsEnabled());
+
+  LittleFS.hostFormat();
+  TEST_ASSERT_FALSE(loadSecureConfig());
+}
+
+// HMAC-SHA256 of the UID bytes, first 16 bytes (checked against Python's hmac module)
+void test_credential_block_is_the_truncated_hmac_of_the_uid() {
+  const uint8_t expected4[16] = {0xb4, 0xbb, 0x99, 0x7b, 0xc5, 0x81, 0xfd, 0xab,
+                                 0xe0, 0xeb, 0x56, 0xab, 0x27, 0xbe, 0x4e, 0x15};
+  const uint8_t expected7[16] = {0x38, 0x64, 0x1b, 0x07, 0xf9, 0xcb, 0x94, 0xd0,
+                                 0x9c, 0x79, 0xbd, 0x64, 0x53, 0x7d, 0xd7, 0x4e};
+  uint8_t block[SECURE_BLOCK_SIZE];
+  secureCredentialBlock(key("04:3A:7F:92"), block);
+  TEST_ASSERT_EQUAL_MEMORY(expected4, block, 16);
+  secureCredentialBlock(key("04:3A:7F:92:11:22:33"), block);
+  TEST_ASSERT_EQUAL_MEMORY(expected7, block, 16);
+
+  TEST_ASSERT_TRUE(verifyCredentialBlock(key("04:3A:7F:92:11:22:33"), block));
+  block[15] ^= 0x01;
+  TEST_ASSERT_FALSE(verifyCredentialBlock(key("04:3A:7F:92:11:22:33"), block));
+}
+
+void test_provisioned_card_is_verified() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint8_t verified;
+  chip.addCard(provisionedCard("04:3A:7F:92"));
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys, &verified));
+  TEST_ASSERT_EQUAL_HEX8(0x01, verified);
+}
+
+void test_clone_without_the_block_is_refused() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint8_t verified;
+
+  chip.addCard(siteCard("04:3A:7F:92")); // right key, no credential block
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys, &verified));
+  TEST_ASSERT_EQUAL_HEX8(0x00, verified);
+
+  chip.clearField();
+  HostCard copy = provisionedCard("04:3A:7F:92"); // block copied, key unknown to the cloner
+  memset(copy.keyA[SECTOR], 0xFF, 6);
+  chip.addCard(copy);
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys, &verified));
+  TEST_ASSERT_EQUAL_HEX8(0x00, verified);
+  // the failed authentication dropped it to IDLE; it was selected again and halted
+  TEST_ASSERT_EQUAL_UINT8(0, pollOnce(keys, &verified));
+
+  chip.clearField();
+  copy = provisionedCard("04:3A:7F:92"); // block copied to a card with another UID
+  memcpy(copy.uid, "\x5C\x01\x9E\x20", 4);
+  chip.addCard(copy);
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys, &verified));
+  TEST_ASSERT_EQUAL_HEX8(0x00, verified);
+}
+
+void test_each_card_in_the_field_is_verified_on_its_own() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint8_t verified;
+  chip.addCard(siteCard("5C:01:9E:20"));
+  chip.addCard(provisionedCard("04:3A:7F:92:11:22:33"));
+  TEST_ASSERT_EQUAL_UINT8(2, pollOnce(keys, &verified));
+  for (uint8_t i = 0; i < 2; i++)
+    TEST_ASSERT_EQUAL(keys[i] == key("04:3A:7F:92:11:22:33"), (verified >> i) & 1);
+}
+
+void test_provisioning_writes_the_block_on_the_next_read() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint8_t verified;
+  HostCard card = siteCard("04:3A:7F:92");
+  chip.addCard(card);
+  requestProvisioning(key("04:3A:7F:92"));
+  TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys, &verified));
+  TEST_ASSERT_EQUAL_HEX8(0x01, verified);
+  TEST_ASSERT_FALSE(provisioningPending(key("04:3A:7F:92")));
+
+  uint8_t expected[SECURE_BLOCK_SIZE];
+  secureCredentialBlock(key("04:3A:7F:92"), expected);
+  TEST_ASSERT_EQUAL_MEMORY(expected, chip.card(card.uid, card.length)->blocks[8], 16);
+}
+
+void test_stage_timing_stays_inside_the_budget() {
+  UidKey keys[MAX_CARDS_PER_SCAN];
+  uint8_t verified;
+  hostAdvanceMillis(1);
+  reader.printStats(); // start from empty counters
+  for (int i = 0; i < 20; i++) {
+    chip.clearField();
+    chip.addCard(provisionedCard(i % 2 ? "04:3A:7F:92" : "04:3A:7F:92:11:22:33"));
+    TEST_ASSERT_EQUAL_UINT8(1, pollOnce(keys, &verified));
+    TEST_ASSERT_EQUAL_HEX8(0x01, verified);
+  }
+
+  hostClearSerialOutput();
+  reader.printStats();
+  std::string stats = hostSerialOutput();
+  const char* stages[] = {"select 4-byte", "select 7/10-byte", "sector auth", "block read",
+                          "MAC check", "select to verdict"};
+  char message[64];
+  // the fake clock does not move while the host computes the MAC: the device's stats have it
+  for (const char* stage : stages) {
+    snprintf(message, sizeof(message), "%s: avg %lu us", stage,
+             (unsigned long)average(stats, stage));
+    TEST_MESSAGE(message);
+  }
+  TEST_ASSERT_GREATER_THAN_UINT32(0, average(stats, "sector auth"));
+  TEST_ASSERT_LESS_THAN_UINT32(secureBudgetUs(), average(stats, "select to verdict"));
+  TEST_ASSERT_TRUE(stats.find("0 cards failed authentication, 0 over the 50 ms budget") !=
+                   std::string::npos);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_config_needs_key_and_secret);
+  RUN_TEST(test_credential_block_is_the_truncated_hmac_of_the_uid);
+  RUN_TEST(test_provisioned_card_is_verified);
+  RUN_TEST(test_clone_without_the_block_is_refused);
+  RUN_TEST(test_each_card_in_the_field_is_verified_on_its_own);
+  RUN_TEST(test_provisioning_writes_the_block_on_the_next_read);
+  RUN_TEST(test_stage_timing_stays_inside_the_budget);
+  return UNITY_END();
+}
@@ -0,0 +1,209 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+// the firmware as it is flashed: setup(), loop() and all of main.cpp's state
+#include "main.cpp"
+
+const uint32_t TAPS = 1000000;
+const uint32_t REQUESTS = 10000;
+const uint32_t WARM_UP = 1000; // taps or requests before the heap baseline is taken
+
+const char* const ADMIN_UID = "AA:BB:CC:01";
+const char* const USER_UIDS[] = {"AA:BB:CC:02", "04:3A:7F:92:11:22:33", "AA:BB:CC:03"};
+const uint8_t USERS = sizeof(USER_UIDS) / sizeof(USER_UIDS[0]);
+const uint16_t STRANGERS = 256;
+
+static HostMfrc522Chip& chip = hostMfrc522Chip(SS_PIN);
+static HostCard adminCard;
+static HostCard userCards[USERS];
+static HostCard strangerCards[STRANGERS];
+
+// one loop() pass after `ms` of awake time
+static void pass(uint32_t ms) {
+  hostAdvanceMillis(ms);
+  loop();
+}
+
+static void passes(uint32_t count, uint32_t ms) {
+  for (uint32_t i = 0; i < count; i++)
+    pass(ms);
+}
+
+// unlock commands the lock pin has seen since the last call: each starts with a full-power HIGH
+static uint32_t unlocksSeen() {
+  uint32_t unlocks = 0;
+  for (const HostPinEvent& event : hostPinEvents())
+    unlocks += event.pin == LOCK_PIN && !event.pwm && event.value > 0;
+  hostClearPinEvents();
+  return unlocks;
+}
+
+// a card held to the entry reader until the lock beeps (at most 200 ms), then a second until
+// the next one: three reader polls per tap
+static void tap(const HostCard& card) {
+  while (buzzerBusy())
+    pass(20);
+  chip.addCard(card);
+  for (int i = 0; i < 10 && !buzzerBusy(); i++)
+    pass(20);
+  chip.clearField();
+  passes(2, 500);
+}
+
+static void pressModeButton() {
+  hostSetPin(MODE_BUTTON, LOW);
+  passes(10, 10);
+  hostSetPin(MODE_BUTTON, HIGH);
+  passes(10, 50); // past the double-press window
+}
+
+// serves one request through loop(); the response code, 0 if the portal was not listening
+static int request(HTTPMethod method, const char* uri, const char* form = "") {
+  if (!server.hostRequest(method, uri, form))
+    return 0;
+  pass(5);
+  return server.hostPending() ? 0 : server.hostResponse().code;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_boot() {
+  hostSerialQuiet(true);
+  LittleFS.hostWrite("/uids.txt", "AA:BB:CC:01,Admin,A\n"
+                                  "AA:BB:CC:02,Alice,U\n"
+                                  "04:3A:7F:92:11:22:33,Bob,U\n"
+                                  "AA:BB:CC:03,Carol,U\n");
+  adminCard = hostCard(ADMIN_UID);
+  for (uint8_t i = 0; i < USERS; i++)
+    userCards[i] = hostCard(USER_UIDS[i]);
+  char uid[UID_TEXT_SIZE];
+  for (uint16_t i = 0; i < STRANGERS; i++) {
+    const char* format = i % 2 ? "5C:01:%02X:%02X" : "08:11:22:%02X:%02X:33:44";
+    snprintf(uid, sizeof(uid), format, i, ~i & 0xFF);
+    strangerCards[i] = hostCard(uid);
+  }
+
+  hostTracePin(SS_PIN, false); // thousands of frames per tap, and only the lock pin is checked
+  setup();
+  passes(10, 100);
+  TEST_ASSERT_EQUAL_UINT32(4, credentialCount());
+  TEST_ASSERT_TRUE(entryReader.isHealthy());
+  TEST_ASSERT_FALSE(WiFi.hostSoftApUp());
+  TEST_ASSERT_FALSE(hostTimer0Armed());
+  hostClearPinEvents();
+}
+
+// every fourth tap is a registered card; the rest are strangers, which also lock an open door
+void test_a_million_taps_without_heap_churn() {
+  uint32_t heapBase = 0;
+  uint32_t allocationsBase = 0;
+  uint32_t granted = 0;
+  uint32_t unlocks = 0;
+  uint64_t startUs = hostRtcMicros();
+  for (uint32_t i = 0; i < TAPS; i++) {
+    if (i == WARM_UP) {
+      heapBase = hostHeapInUse();
+      allocationsBase = hostHeapAllocations();
+    }
+    bool user = i % 4 == 0;
+    tap(user ? userCards[(i / 4) % USERS] : strangerCards[i % STRANGERS]);
+    granted += user;
+    unlocks += unlocksSeen();
+  }
+  passes(20, 500); // the last unlock window runs out
+
+  char message[160];
+  snprintf(message, sizeof(message),
+           "%lu taps over %lu s: heap %lu -> %lu bytes, %lu allocations, %lu s asleep",
+           (unsigned long)TAPS, (unsigned long)((hostRtcMicros() - startUs) / 1000000),
+           (unsigned long)heapBase, (unsigned long)hostHeapInUse(),
+           (unsigned long)(hostHeapAllocations() - allocationsBase),
+           (unsigned long)(hostSleptMicros() / 1000000));
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(heapBase, hostHeapInUse());
+  TEST_ASSERT_EQUAL_UINT32(allocationsBase, hostHeapAllocations());
+  TEST_ASSERT_EQUAL_UINT32(granted, unlocks);
+  TEST_ASSERT_EQUAL_UINT32(0, cardQueue.dropped() + logQueue.dropped() + buzzerQueue.dropped());
+  TEST_ASSERT_FALSE(isUnlocked);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, hostSleptMicros());
+  TEST_ASSERT_EQUAL_UINT32(0, hostArmedSleeps()); // never asleep inside an unlock window
+}
+
+// the portal, opened with the MODE button and an admin card, serving every read-only route
+// and duplicate registrations; each request must give back all the heap it took
+void test_ten_thousand_requests_without_heap_growth() {
+  pressModeButton();
+  TEST_ASSERT_EQUAL(STATE_ADD_WAIT_ADMIN, mode.state());
+  tap(adminCard);
+  TEST_ASSERT_EQUAL(STATE_ADD_REGISTER, mode.state());
+  TEST_ASSERT_TRUE(WiFi.hostSoftApUp());
+
+  TEST_ASSERT_EQUAL(200, request(HTTP_POST, "/settime", "epoch=1767225600"));
+  TEST_ASSERT_EQUAL(200, request(HTTP_POST, "/schedules", "rules=U%2CMTWTFSS%2C00%3A00-23%3A59"));
+
+  struct Route {
+    HTTPMethod method;
+    const char* uri;
+    const char* form;
+    int code;
+  };
+  const Route ROUTES[] = {
+      {HTTP_GET, "/", "", 200},
+      {HTTP_GET, "/getuid", "", 200},
+      {HTTP_GET, "/health", "", 200},
+      {HTTP_GET, "/metrics", "", 200},
+      {HTTP_GET, "/export", "", 200},
+      {HTTP_GET, "/audit", "from=1767225600", 200},
+      {HTTP_GET, "/schedules", "", 200},
+      {HTTP_POST, "/register", "uid=AA%3ABB%3ACC%3A02&name=Alice&role=U", 200},
+      {HTTP_POST, "/register", "uid=&name=Nobody&role=U", 400},
+      {HTTP_POST, "/settime", "epoch=1767225600", 200},
+      {HTTP_GET, "/missing", "", 404},
+  };
+  const uint8_t ROUTE_COUNT = sizeof(ROUTES) / sizeof(ROUTES[0]);
+
+  uint32_t heapBase = 0;
+  uint32_t allocationsBase = 0;
+  uint32_t worstGrowth = 0;
+  for (uint32_t i = 0; i < REQUESTS; i++) {
+    if (i == WARM_UP) {
+      heapBase = hostHeapInUse();
+      allocationsBase = hostHeapAllocations();
+    }
+    const Route& route = ROUTES[i % ROUTE_COUNT];
+    uint32_t heapBefore = hostHeapInUse();
+    TEST_ASSERT_EQUAL_MESSAGE(route.code, request(route.method, route.uri, route.form), route.uri);
+    if (i >= WARM_UP && hostHeapInUse() > heapBefore)
+      worstGrowth = max(worstGrowth, hostHeapInUse() - heapBefore);
+    if (i % 100 == 99)
+      tap(strangerCards[i % STRANGERS]); // keeps add mode alive, as a visitor would
+  }
+
+  // only net growth is checked: the real library parses every request into heap Strings,
+  // which the stand-in server does not count, so the allocations are the firmware's alone
+  char message[128];
+  snprintf(message, sizeof(message),
+           "%lu requests: heap %lu -> %lu bytes, worst request +%lu, %lu firmware allocations",
+           (unsigned long)REQUESTS, (unsigned long)heapBase, (unsigned long)hostHeapInUse(),
+           (unsigned long)worstGrowth, (unsigned long)(hostHeapAllocations() - allocationsBase));
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(heapBase, hostHeapInUse());
+  TEST_ASSERT_EQUAL_UINT32(0, worstGrowth);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(REQUEST_ARENA_SIZE, arenaHighWater());
+
+  pressModeButton();
+  TEST_ASSERT_EQUAL(STATE_DOOR_LOCK, mode.state());
+  TEST_ASSERT_FALSE(WiFi.hostSoftApUp());
+  TEST_ASSERT_EQUAL(0, request(HTTP_GET, "/"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_boot);
+  RUN_TEST(test_a_million_taps_without_heap_churn);
+  RUN_TEST(test_ten_thousand_requests_without_heap_growth);
+  return UNITY_END();
+}
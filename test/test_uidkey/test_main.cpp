@@ -0,0 +1,215 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "uidkey.h"
+
+static UidKey uid(const char* text) {
+  UidKey key = {};
+  parseUidKey(text, &key);
+  return key;
+}
+
+// mean host nanoseconds per call of `body` over `calls` calls
+template <typename Body> static uint32_t meanNs(uint32_t calls, Body body) {
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < calls; i++)
+    body(i);
+  return (ESP.getCycleCount() - start) / calls;
+}
+
+static void report(const char* what, uint32_t ns) {
+  char message[80];
+  snprintf(message, sizeof(message), "%s: %lu ns per call", what, (unsigned long)ns);
+  TEST_MESSAGE(message);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_packing_round_trips() {
+  const uint8_t bytes[UID_MAX_BYTES] = {0x01, 0x02, 0x03, 0x04, 0x05,
+                                        0x06, 0x07, 0x08, 0x09, 0x0A};
+  for (uint8_t length : {4, 7, 10}) {
+    UidKey key = makeUidKey(bytes, length);
+    TEST_ASSERT_EQUAL_UINT8(length, uidKeyLength(key));
+    uint8_t out[UID_MAX_BYTES] = {};
+    uidKeyBytes(key, out);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(bytes, out, length);
+  }
+  UidKey key = makeUidKey(bytes, 4);
+  TEST_ASSERT_EQUAL_UINT64(0x04030201ULL, key.lo);
+  TEST_ASSERT_EQUAL_UINT64(4ULL << 56, key.hi);
+}
+
+void test_length_tells_keys_apart() {
+  const uint8_t zeros[UID_MAX_BYTES] = {};
+  UidKey four = makeUidKey(zeros, 4);
+  UidKey seven = makeUidKey(zeros, 7);
+  TEST_ASSERT_TRUE(four != seven);
+  TEST_ASSERT_TRUE(four < seven);
+  TEST_ASSERT_FALSE(seven < four);
+  TEST_ASSERT_TRUE(four == makeUidKey(zeros, 4));
+  TEST_ASSERT_EQUAL_UINT8(UID_MAX_BYTES, uidKeyLength(makeUidKey(zeros, 12))); // truncated
+}
+
+void test_order_is_total() {
+  UidKey a = uid("01:00:00:00");
+  UidKey b = uid("02:00:00:00");
+  UidKey c = uid("00:00:00:01");
+  TEST_ASSERT_TRUE(a < b);
+  TEST_ASSERT_TRUE(b < c); // bytes pack little-endian, the last byte is most significant
+  TEST_ASSERT_FALSE(a < a);
+}
+
+// the same values tools/mkphf.py computes; images built offline depend on it
+void test_hash_matches_the_offline_tool() {
+  TEST_ASSERT_EQUAL_HEX32(0x7AB954E3, uidKeyHash(uid("04:3A:7F:92"), 0));
+  TEST_ASSERT_EQUAL_HEX32(0x3ACFE41F, uidKeyHash(uid("04:3A:7F:92:11:22:33"), 7));
+  TEST_ASSERT_EQUAL_HEX32(0xB3BB31C5, uidKeyHash(uid("01:02:03:04:05:06:07:08:09:0A"), 12345));
+}
+
+void test_hash_spreads_sequential_uids() {
+  const uint32_t buckets = 64;
+  const uint32_t keys = 64 * 256;
+  uint32_t counts[buckets] = {};
+  for (uint32_t i = 0; i < keys; i++) {
+    uint8_t bytes[4] = {0x04, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i};
+    counts[uidKeyHash(makeUidKey(bytes, 4), 0) % buckets]++;
+  }
+  for (uint32_t bucket = 0; bucket < buckets; bucket++) {
+    TEST_ASSERT_GREATER_THAN_UINT32(256 * 3 / 4, counts[bucket]);
+    TEST_ASSERT_LESS_THAN_UINT32(256 * 5 / 4, counts[bucket]);
+  }
+}
+
+// what the packed key replaced: comparing the formatted UID strings
+void test_compare_and_hash_cost() {
+  const uint32_t calls = 1000000;
+  UidKey keys[2] = {uid("04:3A:7F:92:11:22:33"), uid("04:3A:7F:92:11:22:34")};
+  char texts[2][UID_TEXT_SIZE];
+  formatUidKey(keys[0], texts[0]);
+  formatUidKey(keys[1], texts[1]);
+
+  volatile uint32_t sink = 0;
+  uint32_t packed = meanNs(calls, [&](uint32_t i) { sink += keys[0] == keys[i & 1]; });
+  uint32_t text = meanNs(calls, [&](uint32_t i) { sink += strcmp(texts[0], texts[i & 1]) == 0; });
+  uint32_t hash = meanNs(calls, [&](uint32_t i) { sink += uidKeyHash(keys[i & 1], i); });
+  report("packed key ==", packed);
+  report("strcmp() of the text", text);
+  report("uidKeyHash()", hash);
+  TEST_ASSERT_LESS_THAN_UINT32(100, packed);
+  TEST_ASSERT_LESS_THAN_UINT32(100, hash);
+}
+
+// what formatUidKey() replaced: the String building scanTag() used to do
+static String legacyFormat(const uint8_t* bytes, uint8_t length) {
+  String text = "";
+  for (uint8_t i = 0; i < length; i++) {
+    if (bytes[i] < 0x10)
+      text += "0";
+    text += String(bytes[i], HEX);
+    if (i < length - 1)
+      text += ":";
+  }
+  text.toUpperCase();
+  return text;
+}
+
+// what the table lookup in parseUidKey() replaced
+static int legacyHexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+static bool legacyParse(const char* text, UidKey* key) {
+  uint8_t bytes[UID_MAX_BYTES];
+  uint8_t length = 0;
+  while (*text != '\0') {
+    int high = legacyHexValue(text[0]);
+    int low = high == -1 ? -1 : legacyHexValue(text[1]);
+    if (low == -1 || length == UID_MAX_BYTES)
+      return false;
+    bytes[length++] = (high << 4) | low;
+    text += 2;
+    if (*text == ':')
+      text++;
+  }
+  *key = makeUidKey(bytes, length);
+  return length > 0;
+}
+
+void test_format_and_parse_agree_with_the_string_code() {
+  const uint8_t bytes[UID_MAX_BYTES] = {0x04, 0x3a, 0x7f, 0x92, 0x00, 0x0b, 0xff, 0x10, 0xa5, 0x5a};
+  char text[UID_TEXT_SIZE];
+  for (uint8_t length : {4, 7, 10}) {
+    UidKey key = makeUidKey(bytes, length);
+    TEST_ASSERT_EQUAL_UINT8(length * 3 - 1, formatUidKey(key, text));
+    TEST_ASSERT_EQUAL_STRING(legacyFormat(bytes, length).c_str(), text);
+
+    UidKey parsed = {};
+    TEST_ASSERT_TRUE(parseUidKey(text, &parsed));
+    TEST_ASSERT_TRUE(parsed == key);
+    for (char* c = text; *c != '\0'; c++)
+      *c = tolower(*c);
+    TEST_ASSERT_TRUE(parseUidKey(text, &parsed));
+    TEST_ASSERT_TRUE(parsed == key);
+  }
+  UidKey untouched = uid("01:02:03:04");
+  TEST_ASSERT_FALSE(parseUidKey("04:3G:7F:92", &untouched));
+  TEST_ASSERT_FALSE(parseUidKey("04:3\xC1:7F:92", &untouched)); // not 7-bit
+  TEST_ASSERT_TRUE(untouched == uid("01:02:03:04"));
+}
+
+void test_hex_cost_against_the_string_code() {
+  const uint32_t calls = 200000;
+  const uint8_t bytes[UID_MAX_BYTES] = {0x04, 0x3A, 0x7F, 0x92, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+  volatile uint32_t sink = 0;
+  char message[96];
+  for (uint8_t length : {4, 7, 10}) {
+    UidKey key = makeUidKey(bytes, length);
+    char text[UID_TEXT_SIZE];
+    formatUidKey(key, text);
+
+    uint32_t allocations = hostHeapAllocations();
+    uint32_t format = meanNs(calls, [&](uint32_t) { sink += formatUidKey(key, text); });
+    uint32_t formatAllocations = hostHeapAllocations() - allocations;
+    allocations = hostHeapAllocations();
+    uint32_t string =
+        meanNs(calls, [&](uint32_t) { sink += legacyFormat(bytes, length).length(); });
+    uint32_t stringAllocations = hostHeapAllocations() - allocations;
+
+    UidKey parsed;
+    uint32_t parse = meanNs(calls, [&](uint32_t) { sink += parseUidKey(text, &parsed); });
+    uint32_t branchy = meanNs(calls, [&](uint32_t) { sink += legacyParse(text, &parsed); });
+
+    snprintf(message, sizeof(message),
+             "%u-byte UID: format %lu ns (String code %lu ns, %lu allocations per call)", length,
+             (unsigned long)format, (unsigned long)string,
+             (unsigned long)(stringAllocations / calls));
+    TEST_MESSAGE(message);
+    snprintf(message, sizeof(message), "%u-byte UID: parse %lu ns (branchy digits %lu ns)", length,
+             (unsigned long)parse, (unsigned long)branchy);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32(0, formatAllocations);
+    TEST_ASSERT_LESS_THAN_UINT32(string, format);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_packing_round_trips);
+  RUN_TEST(test_length_tells_keys_apart);
+  RUN_TEST(test_order_is_total);
+  RUN_TEST(test_hash_matches_the_offline_tool);
+  RUN_TEST(test_hash_spreads_sequential_uids);
+  RUN_TEST(test_compare_and_hash_cost);
+  RUN_TEST(test_format_and_parse_agree_with_the_string_code);
+  RUN_TEST(test_hex_cost_against_the_string_code);
+  return UNITY_END();
+}
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Builds a minimal perfect hash credential image for the door lock.
+
+Reads a card list in the /uids.txt format (UID,Name,Role per line) and writes
+an image the firmware loads from LittleFS as /creds.phf. Every listed UID maps
+to its own slot, so a lookup on the lock is two hashes and one compare.
+
+Usage:
+    python3 tools/mkphf.py badges.csv data/creds.phf
+
+Image layout (little-endian):
+    header   magic "PHF1", u32 count, u32 buckets, u32 seed, u32 names offset
+    buckets  u16 displacement per bucket
+    slots    count x 16 bytes: uid[10], u8 uid length, u8 role, u32 name offset
+    names    newline-terminated names, offsets relative to the names section
+"""
+
+import argparse
+import struct
+import sys
+
+MASK64 = (1 << 64) - 1
+KEYS_PER_BUCKET = 4
+MAX_DISPLACEMENT = 0xFFFF
+MAX_SEEDS = 64
+
+
+def parse_uid(text):
+    text = text.strip().replace(":", "")
+    if not text or len(text) % 2 or len(text) > 20:
+        return None
+    try:
+        return bytes.fromhex(text)
+    except ValueError:
+        return None
+
+
+def pack_key(uid):
+    lo = 0
+    hi = len(uid) << 56
+    for i, b in enumerate(uid):
+        if i < 8:
+            lo |= b << (8 * i)
+        else:
+            hi |= b << (8 * (i - 8))
+    return lo, hi
+
+
+def uid_key_hash(key, seed):
+    """Exact copy of uidKeyHash() in src/uidkey.cpp."""
+    lo, hi = key
+    h = lo ^ ((hi * 0x9E3779B97F4A7C15) & MASK64) ^ seed
+    h ^= h >> 33
+    h = (h * 0xFF51AFD7ED558CCD) & MASK64
+    h ^= h >> 33
+    h = (h * 0xC4CEB9FE1A85EC53) & MASK64
+    h ^= h >> 33
+    return h & 0xFFFFFFFF
+
+
+def read_cards(path):
+    cards = []
+    seen = set()
+    with open(path, encoding="utf-8") as f:
+        for number, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            first = line.find(",")
+            last = line.rfind(",")
+            if first == -1 or first == last:
+                continue
+            uid = parse_uid(line[:first])
+            if uid is None:
+                print(f"{path}:{number}: ignoring bad UID line: {line}", file=sys.stderr)
+                continue
+            if uid in seen:  # like the firmware, the first line for a UID wins
+                continue
+            seen.add(uid)
+            name = line[first + 1:last].strip()
+            role = line[last + 1:].strip()
+            if len(role) != 1 or not role.isalpha():  # like the firmware: no role, no admin
+                if role:
+                    print(f"{path}:{number}: role {role!r} is not one letter", file=sys.stderr)
+                role = "?"
+            role = role.upper()
+            cards.append((uid, name, role))
+    return cards
+
+
+def build(keys, seed):
+    """Hash-and-displace: returns per-bucket displacements and slot order, or None."""
+    n = len(keys)
+    bucket_count = max(1, (n + KEYS_PER_BUCKET - 1) // KEYS_PER_BUCKET)
+    buckets = [[] for _ in range(bucket_count)]
+    for index, key in enumerate(keys):
+        buckets[uid_key_hash(key, seed) % bucket_count].append(index)
+
+    displacements = [0] * bucket_count
+    slots = [None] * n
+    for bucket in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+        members = buckets[bucket]
+        if not members:
+            continue
+        for d in range(MAX_DISPLACEMENT + 1):
+            positions = [uid_key_hash(keys[i], seed + d + 1) % n for i in members]
+            if len(set(positions)) == len(positions) and all(slots[p] is None for p in positions):
+                break
+        else:
+            return None
+        displacements[bucket] = d
+        for i, p in zip(members, positions):
+            slots[p] = i
+    return displacements, slots
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("csv", help="card list in /uids.txt format")
+    parser.add_argument("image", help="output image, e.g. data/creds.phf")
+    args = parser.parse_args()
+
+    cards = read_cards(args.csv)
+    keys = [pack_key(uid) for uid, _, _ in cards]
+
+    for seed in range(MAX_SEEDS):
+        result = build(keys, seed) if keys else ([0], [])
+        if result is not None:
+            break
+    else:
+        sys.exit("failed to build a perfect hash, try a smaller list")
+    displacements, slots = result
+
+    names = bytearray()
+    name_offsets = {}
+    for _, name, _ in cards:
+        if name not in name_offsets:
+            name_offsets[name] = len(names)
+            names += name.encode("utf-8") + b"\n"
+    if len(names) >= 1 << 20:
+        sys.exit("names section exceeds 1 MB")
+
+    header_size = 20
+    names_offset = header_size + 2 * len(displacements) + 16 * len(cards)
+    image = bytearray(b"PHF1")
+    image += struct.pack("<IIII", len(cards), len(displacements), seed, names_offset)
+    image += struct.pack(f"<{len(displacements)}H", *displacements)
+    for index in slots:
+        uid, name, role = cards[index]
+        image += uid.ljust(10, b"\0") + struct.pack("<BBI", len(uid), ord(role), name_offsets[name])
+    image += names
+
+    with open(args.image, "wb") as f:
+        f.write(image)
+
+    ram = 2 * len(displacements)
+    print(f"{len(cards)} cards, {len(name_offsets)} distinct names, seed {seed}")
+    print(f"image {len(image)} bytes, {ram} bytes of RAM on the lock for the displacements")
+
+
+if __name__ == "__main__":
+    main()
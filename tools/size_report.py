@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+"""Reports flash, IRAM and DRAM use of the firmware from the linker map.
+
+Runs after every link as a PlatformIO extra script (see platformio.ini), or by
+hand on a map file:
+    python3 tools/size_report.py .pio/build/nodemcuv2/firmware.map
+    python3 tools/size_report.py firmware.map --baseline old.json --save new.json
+
+Prints the totals per memory region and per output section, and the largest
+symbols of each region. PROGMEM data has no symbol in the map and shows up as
+"PROGMEM file:line" (the portal page is the big one in main.cpp).
+
+Budgets come from the environment's custom options and fail the build when a
+region goes over:
+    custom_size_budget_iram  = 31744   ; bytes of IRAM code
+    custom_size_budget_dram  = 45056   ; bytes of .data + .rodata + .bss
+    custom_size_budget_flash = 819200  ; bytes of the firmware image
+    custom_size_baseline     = sizes/release.json  ; optional, to diff against
+    custom_size_top          = 15      ; symbols listed per region
+
+Without a baseline the report is diffed against the previous build's, saved as
+size_report.json next to the map.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+# ESP8266 address ranges
+REGIONS = [
+    ("dram", 0x3FFE8000, 0x40000000),
+    ("iram", 0x40100000, 0x40110000),
+    ("flash", 0x40200000, 0x40500000),
+]
+NOLOAD_SECTIONS = (".bss", ".noinit")
+SYMBOL_PREFIXES = (
+    ".irom0.text.",
+    ".iram.text.",
+    ".text.",
+    ".literal.",
+    ".rodata.",
+    ".data.",
+    ".bss.",
+)
+PROGMEM_RE = re.compile(r"^\.irom\.text\.(.+)\.(\d+)\.\d+$")
+MERGED_STRINGS_RE = re.compile(r"^str\d+\.\d+$")  # .rodata.str1.1 and the like
+OUTPUT_RE = re.compile(r"^(\.\S+)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+))?")
+INPUT_RE = re.compile(r"^ (\.\S+|COMMON)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*))?$")
+CONTINUATION_RE = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+(\S.*))?$")
+SYMBOL_RE = re.compile(r"^\s+0x([0-9a-f]+)\s{2,}([^0\s].*)$")
+
+
+def region_of(address):
+    for name, start, end in REGIONS:
+        if start <= address < end:
+            return name
+    return None
+
+
+def object_name(path):
+    """libfoo.a(bar.o) stays as it is, paths are cut down to the file name."""
+    if "(" in path:
+        return os.path.basename(path.split("(")[0]) + "(" + path.split("(", 1)[1]
+    return os.path.basename(path)
+
+
+def symbol_key(section, obj):
+    match = PROGMEM_RE.match(section)
+    if match:
+        return "PROGMEM %s:%s" % (os.path.basename(match.group(1)), match.group(2))
+    for prefix in SYMBOL_PREFIXES:
+        rest = section[len(prefix):]
+        if section.startswith(prefix) and not MERGED_STRINGS_RE.match(rest):
+            return rest
+    return "%s (%s)" % (obj, section)
+
+
+def parse_map(path):
+    """Returns (sections, symbols): bytes per output section and per symbol.
+
+    Keys of both are "region section" and "region name"; literal pools are
+    counted with their function.
+    """
+    sections = {}
+    symbols = {}
+    names = {}  # symbol key -> the name the map gives that symbol
+    output = None
+    pending = None  # input section whose address and size are on the next line
+    last = None  # (address, key) of the last input section, to pick up its symbol name
+
+    def add_input(section, address, size, obj):
+        nonlocal last
+        region = region_of(address)
+        if region is None or size == 0 or output is None:
+            return
+        if region == "dram" and output.startswith(NOLOAD_SECTIONS):
+            region = "bss"
+        sections[region + " " + output] = sections.get(region + " " + output, 0) + size
+        key = region + " " + symbol_key(section, object_name(obj))
+        symbols[key] = symbols.get(key, 0) + size
+        last = (address, key)
+
+    with open(path, errors="replace") as f:
+        in_memory_map = False
+        for line in f:
+            line = line.rstrip("\n")
+            if not in_memory_map:
+                in_memory_map = line.startswith("Linker script and memory map")
+                continue
+
+            if pending is not None:
+                match = CONTINUATION_RE.match(line)
+                if match and match.group(3):
+                    add_input(pending, int(match.group(1), 16), int(match.group(2), 16),
+                              match.group(3))
+                pending = None
+                continue
+
+            if line.startswith("."):
+                match = OUTPUT_RE.match(line)
+                output = match.group(1)
+                last = None
+                continue
+
+            match = INPUT_RE.match(line)
+            if match:
+                if match.group(2) is None:
+                    pending = match.group(1)
+                else:
+                    add_input(match.group(1), int(match.group(2), 16),
+                              int(match.group(3), 16), match.group(4))
+                continue
+
+            match = SYMBOL_RE.match(line)
+            if match and last is not None and int(match.group(1), 16) == last[0]:
+                names.setdefault(last[1], match.group(2).strip())
+                last = None
+
+    # show mangled keys under the name the map gives their symbol
+    named = {}
+    for key, size in symbols.items():
+        region, _, suffix = key.partition(" ")
+        label = region + " " + names.get(key, suffix)
+        named[label] = named.get(label, 0) + size
+    return sections, named
+
+
+def summarize(sections, symbols):
+    regions = {"iram": 0, "dram": 0, "bss": 0, "flash": 0}
+    for key, size in sections.items():
+        regions[key.split(" ", 1)[0]] += size
+    image = regions["flash"] + regions["iram"] + regions["dram"]
+    totals = {
+        "iram": regions["iram"],
+        "dram": regions["dram"] + regions["bss"],
+        "flash": image,
+    }
+    return {"totals": totals, "sections": sections, "symbols": symbols}
+
+
+def print_report(report, top):
+    totals = report["totals"]
+    print("Memory use from the linker map:")
+    print("  IRAM  %8d bytes" % totals["iram"])
+    print("  DRAM  %8d bytes (data, rodata and bss; the heap gets the rest)" % totals["dram"])
+    print("  Flash %8d bytes (firmware image)" % totals["flash"])
+
+    print("Sections:")
+    for key, size in sorted(report["sections"].items(), key=lambda item: -item[1]):
+        print("  %-28s %8d" % (key, size))
+
+    for region in ("iram", "dram", "bss", "flash"):
+        largest = sorted(
+            ((key, size) for key, size in report["symbols"].items()
+             if key.startswith(region + " ")),
+            key=lambda item: -item[1])[:top]
+        if not largest:
+            continue
+        print("Largest in %s:" % region)
+        for key, size in largest:
+            print("  %8d  %s" % (size, key.split(" ", 1)[1]))
+
+
+def print_diff(report, baseline, top):
+    print("Change since the baseline:")
+    for region, size in report["totals"].items():
+        before = baseline.get("totals", {}).get(region, 0)
+        print("  %-5s %+8d bytes (%d -> %d)" % (region, size - before, before, size))
+
+    old = baseline.get("symbols", {})
+    new = report["symbols"]
+    deltas = [(key, new.get(key, 0) - old.get(key, 0)) for key in set(old) | set(new)]
+    deltas = sorted((d for d in deltas if d[1] != 0), key=lambda item: -abs(item[1]))[:top]
+    for key, delta in deltas:
+        print("  %+8d  %s" % (delta, key))
+
+
+def check_budgets(report, budgets):
+    """Returns the list of regions over budget."""
+    over = []
+    for region, budget in budgets.items():
+        if budget is None:
+            continue
+        used = report["totals"][region]
+        state = "OVER BUDGET" if used > budget else "ok"
+        print("Budget %-5s %8d / %8d bytes  %s" % (region, used, budget, state))
+        if used > budget:
+            over.append(region)
+    return over
+
+
+def run(map_path, baseline_path, save_path, budgets, top):
+    report = summarize(*parse_map(map_path))
+    print_report(report, top)
+
+    if baseline_path and os.path.exists(baseline_path):
+        with open(baseline_path) as f:
+            print_diff(report, json.load(f), top)
+    if save_path:
+        with open(save_path, "w") as f:
+            json.dump(report, f, indent=1, sort_keys=True)
+    return check_budgets(report, budgets)
+
+
+def setup_build(env):
+    """Hooks the report into a PlatformIO build."""
+    map_path = env.subst("$BUILD_DIR/${PROGNAME}.map")
+    env.Append(LINKFLAGS=["-Wl,-Map=" + map_path])
+
+    def option(name, default=None):
+        value = env.GetProjectOption("custom_size_" + name, "")
+        return value.strip() if value and value.strip() else default
+
+    def budget(region):
+        value = option("budget_" + region)
+        return int(value, 0) if value else None
+
+    def report_action(target, source, env):
+        save_path = env.subst("$BUILD_DIR/size_report.json")
+        baseline = option("baseline")
+        if baseline is None and os.path.exists(save_path):
+            # the previous build's report, moved aside before it is overwritten
+            baseline = save_path + ".prev"
+            os.replace(save_path, baseline)
+        elif baseline is not None:
+            baseline = os.path.join(env.subst("$PROJECT_DIR"), baseline)
+
+        budgets = {region: budget(region) for region in ("iram", "dram", "flash")}
+        over = run(map_path, baseline, save_path, budgets, int(option("top", "15")))
+        if over:
+            # remove the firmware so the next build links (and checks) it again
+            os.remove(target[0].get_abspath())
+            sys.stderr.write("Error: %s over budget\n" % ", ".join(over))
+            return 1
+        return 0
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report_action)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="linker map, e.g. .pio/build/nodemcuv2/firmware.map")
+    parser.add_argument("--baseline", help="report saved by an earlier build to diff against")
+    parser.add_argument("--save", help="write this build's report as JSON")
+    parser.add_argument("--top", type=int, default=15, help="symbols listed per region")
+    for region in ("iram", "dram", "flash"):
+        parser.add_argument("--budget-" + region, type=int, help="fail above this many bytes")
+    args = parser.parse_args()
+
+    budgets = {
+        "iram": args.budget_iram,
+        "dram": args.budget_dram,
+        "flash": args.budget_flash,
+    }
+    sys.exit(1 if run(args.map, args.baseline, args.save, budgets, args.top) else 0)
+
+
+try:
+    Import("env")  # noqa: F821 -- defined when PlatformIO runs this as an extra script
+except NameError:
+    env = None
+
+if env is not None:
+    setup_build(env)
+elif __name__ == "__main__":
+    main()